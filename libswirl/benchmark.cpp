@@ -0,0 +1,415 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#include "benchmark.h"
+#include "libswirl.h"
+#include "cfg/cfg.h"
+#include "oslib/oslib.h"
+#include "oslib/audiostream.h"
+#include "gui/gui_renderer.h"
+#include "hw/sh4/sh4_sched.h"
+#include "hw/sh4/dyna/blockmanager.h"
+#include "hw/pvr/Renderer_if.h"
+#include "rend/TexCache.h"
+#include "hw/gdrom/disc_common.h"
+#include "hw/arm7/arm7.h"
+#include "hw/bba/VirtualNetwork.h"
+#include "hw/maple/maple_if.h"
+#include <random>
+
+extern u16 kcode[4];
+extern u8 rt[4], lt[4];
+extern s8 joyx[4], joyy[4];
+extern u32 fskip;
+
+struct BenchInput
+{
+	u32 frame;
+	u16 buttons;		// pressed, kcode is active low
+	u8 lt, rt;
+	s8 joyx, joyy;
+};
+
+// totals since start, read at the first and the last frame
+struct BenchCounters
+{
+	u64 blocks;
+	u64 callbacks;
+	u64 vertices;
+	u64 textures;
+	u32 skipped;
+	GDReadStats gdrom;
+	Arm7JitStats arm7;
+	MapleStats maple;
+};
+
+bool bench_active;
+BenchTimes bench_times;
+
+static u32 frames_total;
+static u32 switch_packets;
+static u32 frame;
+static double start_time;
+static bool stopping;
+static BenchCounters start_counters;
+
+static string image;
+static string report_path;
+
+static vector<BenchInput> trace;
+static u32 trace_next;
+
+static bool load_trace(const string& path)
+{
+	FILE* f = fopen(path.c_str(), "r");
+
+	if (!f)
+		return false;
+
+	char line[256];
+
+	while (fgets(line, sizeof(line), f))
+	{
+		if (line[0] == '#')
+			continue;
+
+		BenchInput in = { };
+		unsigned int buttons;
+		int lt = 0, rt = 0, joyx = 0, joyy = 0;
+
+		int n = sscanf(line, "%u %x %d %d %d %d", &in.frame, &buttons, &lt, &rt, &joyx, &joyy);
+
+		if (n <= 0)
+			continue;
+
+		if (n < 2 || (!trace.empty() && in.frame < trace.back().frame))
+		{
+			printf("Benchmark: bad input trace line: %s", line);
+			fclose(f);
+			return false;
+		}
+
+		in.buttons = buttons;
+		in.lt = lt;
+		in.rt = rt;
+		in.joyx = joyx;
+		in.joyy = joyy;
+
+		trace.push_back(in);
+	}
+
+	fclose(f);
+
+	return true;
+}
+
+static void apply_input()
+{
+	while (trace_next < trace.size() && trace[trace_next].frame <= frame)
+	{
+		const BenchInput& in = trace[trace_next++];
+
+		kcode[0] = ~in.buttons;
+		lt[0] = in.lt;
+		rt[0] = in.rt;
+		joyx[0] = in.joyx;
+		joyy[0] = in.joyy;
+	}
+}
+
+static BenchCounters read_counters()
+{
+	BenchCounters c;
+
+	c.blocks = 0;
+#if FEAT_SHREC != DYNAREC_NONE
+	c.blocks = bm_compiled_blocks;
+#endif
+	c.callbacks = sh4_sched_callbacks;
+	c.vertices = VertexCountTotal;
+	c.textures = texture_updates;
+	c.skipped = fskip;
+	c.gdrom = gd_read_stats;
+	c.arm7 = arm7_jit_stats;
+	c.maple = maple_stats;
+
+	return c;
+}
+
+// Quoted and escaped, image paths on windows are full of backslashes
+static string json_string(const string& s)
+{
+	string out = "\"";
+
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += c;
+		}
+		else if ((u8)c < ' ')
+		{
+			char escaped[8];
+			sprintf(escaped, "\\u%04x", (u8)c);
+			out += escaped;
+		}
+		else
+			out += c;
+	}
+
+	return out + "\"";
+}
+
+static FILE* open_report()
+{
+	FILE* f = report_path.empty() ? stdout : fopen(report_path.c_str(), "w");
+
+	if (!f)
+	{
+		printf("Benchmark: cannot write %s, report goes to stdout\n", report_path.c_str());
+		f = stdout;
+	}
+
+	return f;
+}
+
+static void write_report()
+{
+	double wall = os_GetSeconds() - start_time;
+	// the clock starts at the first vblank, so it covers the frames after it
+	u32 timed = frame - 1;
+	double fps = wall > 0 ? timed / wall : 0;
+	double aica = bench_times.aica - bench_times.dsp;
+	// the sh4, and whatever else the emulation thread does or waits for: rendering, gd-rom reads
+	double other = wall - bench_times.arm7 - bench_times.aica;
+
+	BenchCounters c = read_counters();
+
+	FILE* f = open_report();
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"image\": %s,\n", json_string(image).c_str());
+	fprintf(f, "  \"renderer\": %s,\n", json_string(settings.pvr.backend).c_str());
+	fprintf(f, "  \"dynarec\": %s,\n", settings.dynarec.Enable ? "true" : "false");
+	fprintf(f, "  \"frames\": %u,\n", timed);
+	fprintf(f, "  \"wall_seconds\": %.3f,\n", wall);
+	fprintf(f, "  \"emulated_fps\": %.2f,\n", fps);
+	fprintf(f, "  \"seconds\": { \"other\": %.3f, \"arm7\": %.3f, \"aica\": %.3f, \"dsp\": %.3f },\n",
+		other, bench_times.arm7, aica, bench_times.dsp);
+	fprintf(f, "  \"blocks_compiled\": %llu,\n", (unsigned long long)(c.blocks - start_counters.blocks));
+	fprintf(f, "  \"sched_callbacks\": %llu,\n", (unsigned long long)(c.callbacks - start_counters.callbacks));
+	fprintf(f, "  \"ta_vertices\": %llu,\n", (unsigned long long)(c.vertices - start_counters.vertices));
+	fprintf(f, "  \"texture_uploads\": %llu,\n", (unsigned long long)(c.textures - start_counters.textures));
+	fprintf(f, "  \"frames_skipped\": %u,\n", c.skipped - start_counters.skipped);
+
+	u64 arm7_blocks = c.arm7.blocks - start_counters.arm7.blocks;
+	u64 arm7_linked = c.arm7.linked - start_counters.arm7.linked;
+
+	u64 arm7_flushes = c.arm7.flushes - start_counters.arm7.flushes;
+
+	fprintf(f, "  \"arm7_jit\": { \"blocks_per_second\": %.1f, \"linked_rate\": %.3f, \"page_invalidations_per_second\": %.1f, \"unlinks_per_second\": %.1f, \"flushes\": %llu, \"flushes_per_second\": %.2f },\n",
+		arm7_blocks / wall, arm7_blocks ? (double)arm7_linked / arm7_blocks : 0.0,
+		(c.arm7.pages - start_counters.arm7.pages) / wall, (c.arm7.unlinked - start_counters.arm7.unlinked) / wall,
+		(unsigned long long)arm7_flushes, arm7_flushes / wall);
+
+	u64 maple_dmas = c.maple.dmas - start_counters.maple.dmas;
+
+	fprintf(f, "  \"maple\": { \"dmas\": %llu, \"list_decode_rate\": %.3f },\n",
+		(unsigned long long)maple_dmas, maple_dmas ? (double)(c.maple.decodes - start_counters.maple.decodes) / maple_dmas : 0.0);
+
+	u64 reads = c.gdrom.reads - start_counters.gdrom.reads;
+	u64 hits = c.gdrom.prefetch_hits - start_counters.gdrom.prefetch_hits;
+	u64 late = c.gdrom.late_hits - start_counters.gdrom.late_hits;
+	double read_ms = c.gdrom.read_ms - start_counters.gdrom.read_ms;
+
+	fprintf(f, "  \"gdrom\": { \"reads\": %llu, \"prefetch_hit_rate\": %.3f, \"late_hits\": %llu, \"avg_read_ms\": %.3f, \"max_read_ms\": %.3f }\n",
+		(unsigned long long)reads, reads ? (double)hits / reads : 0.0, (unsigned long long)late,
+		reads ? read_ms / reads : 0.0, c.gdrom.max_ms);
+	fprintf(f, "}\n");
+
+	if (f != stdout)
+	{
+		fclose(f);
+		printf("Benchmark: %u frames in %.2f s, %.2f fps, report in %s\n", timed, wall, fps, report_path.c_str());
+	}
+}
+
+// Two ports of a private virtual switch, frames pushed from one to the other a batch at a time
+static void bench_switch()
+{
+	const int batch = 16;
+	const int sizes[] = { 64, 1514 };
+
+	char name[32];
+	sprintf(name, "bench%08x", (u32)std::random_device()());
+
+	VirtualNetwork* a = VirtualNetwork::CreateSwitchNetwork(name);
+	VirtualNetwork* b = VirtualNetwork::CreateSwitchNetwork(name);
+
+	mac_address mac_a, mac_b;
+	a->GetMacAddress(&mac_a);
+	b->GetMacAddress(&mac_b);
+
+	static u8 frames[batch][1520];
+	static u8 received[batch][1520];
+	const u8* ptrs[batch];
+	int lens[batch];
+	int rx_lens[batch];
+
+	FILE* f = open_report();
+
+	fprintf(f, "{\n  \"switch\": [\n");
+
+	for (int s = 0; s < 2; s++)
+	{
+		for (int i = 0; i < batch; i++)
+		{
+			memset(frames[i], i, sizeof(frames[i]));
+			memcpy(&frames[i][0], &mac_b, 6);
+			memcpy(&frames[i][6], &mac_a, 6);
+			frames[i][12] = 0x88;		// local experimental ethertype
+			frames[i][13] = 0xb5;
+			ptrs[i] = frames[i];
+			lens[i] = sizes[s];
+		}
+
+		// so the switch has learned where b is, from a frame b sent
+		u8 hello[64];
+		memcpy(hello, frames[0], sizeof(hello));
+		memcpy(&hello[0], &mac_a, 6);
+		memcpy(&hello[6], &mac_b, 6);
+
+		b->SendEthernetPacket(hello, sizeof(hello));
+		a->RecvEthernetPackets(&received[0][0], rx_lens, 1520, batch);
+
+		u32 got = 0;
+		double start = os_GetSeconds();
+
+		for (u32 sent = 0; sent < switch_packets; sent += batch)
+		{
+			a->SendEthernetPackets(ptrs, lens, batch);
+			got += b->RecvEthernetPackets(&received[0][0], rx_lens, 1520, batch);
+		}
+
+		double seconds = os_GetSeconds() - start;
+		u32 sent = (switch_packets + batch - 1) / batch * batch;
+
+		fprintf(f, "    { \"frame_bytes\": %d, \"packets\": %u, \"received\": %u, \"seconds\": %.3f, \"packets_per_second\": %.0f, \"megabytes_per_second\": %.1f }%s\n",
+			sizes[s], sent, got, seconds, got / seconds, (double)got * sizes[s] / seconds / 1000000, s == 0 ? "," : "");
+	}
+
+	fprintf(f, "  ]\n}\n");
+
+	if (f != stdout)
+	{
+		fclose(f);
+		printf("Benchmark: virtual switch report in %s\n", report_path.c_str());
+	}
+
+	delete a;
+	delete b;
+}
+
+bool bench_init()
+{
+	report_path = cfgLoadStr("bench", "report", "");
+	switch_packets = cfgLoadInt("bench", "switch", 0);
+
+	if (switch_packets != 0)
+	{
+		bench_active = true;
+		settings.pvr.backend = "none";
+		return true;
+	}
+
+	frames_total = cfgLoadInt("bench", "frames", 0);
+
+	if (frames_total == 0)
+		return false;
+
+	image = cfgLoadStr("config", "image", "");
+
+	if (image.empty())
+	{
+		printf("Benchmark: no image given, benchmark disabled\n");
+		return false;
+	}
+
+	string input = cfgLoadStr("bench", "input", "");
+
+	if (!input.empty() && !load_trace(input))
+	{
+		printf("Benchmark: cannot load input trace %s, benchmark disabled\n", input.c_str());
+		return false;
+	}
+
+	bench_active = true;
+
+	// as fast as it goes, the same way every run
+	settings.pvr.backend = cfgLoadStr("bench", "renderer", "none");
+	settings.pvr.SynchronousRender = false;
+	settings.aica.LimitFPS = false;
+	settings.audio.backend = "none";
+	settings.rewind.Enable = false;
+	settings.runahead.Enable = false;
+	audio_skip_samples = true;
+
+	printf("Benchmark: %s, %u frames, renderer %s, %u input changes\n",
+		image.c_str(), frames_total, settings.pvr.backend.c_str(), (u32)trace.size());
+
+	return settings.pvr.backend == "none";
+}
+
+void bench_main()
+{
+	if (switch_packets != 0)
+	{
+		bench_switch();
+		return;
+	}
+
+	virtualDreamcast.reset(VirtualDreamcast::Create());
+
+	virtualDreamcast->Init();
+
+	if (virtualDreamcast->StartGame(image) != 0)
+	{
+		printf("Benchmark: cannot start %s\n", image.c_str());
+		virtualDreamcast.reset();
+		return;
+	}
+
+	g_GUIRenderer->UILoop();
+
+	virtualDreamcast.reset();
+}
+
+void bench_vblank()
+{
+	if (!bench_active || stopping)
+		return;
+
+	// measured from the first frame, the boot up to there isn't part of the run
+	if (frame == 0)
+	{
+		start_time = os_GetSeconds();
+		start_counters = read_counters();
+		bench_times = BenchTimes();
+	}
+
+	apply_input();
+
+	if (++frame < frames_total)
+		return;
+
+	stopping = true;
+
+	virtualDreamcast->Stop([] {
+		write_report();
+		g_GUIRenderer->Stop();
+	});
+}
@@ -0,0 +1,45 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#pragma once
+#include "types.h"
+
+/*
+	Benchmark mode, started with -bench <frames> on the command line.
+
+	Boots the image without audio or frame limiting and with the rtc fixed. The renderer is "none"
+	and there is no window, unless another one is picked with -bench-renderer <slug> (refsw needs
+	the window to present). Input comes from an optional trace (-bench-input), one line per change
+	for port 0:
+
+		<frame> <pressed DC_BTN_* mask, hex> [lt rt joyx joyy]
+
+	After the given number of emulated frames a json report is written (-bench-report, or stdout)
+	and the emulator exits. Settings are not saved.
+
+	-bench-switch <packets> doesn't boot anything, it pushes that many frames of a couple of sizes
+	between two ports of a virtual switch (the bba network, see hw/bba/VirtualSwitch.cpp) and
+	writes their rate to the report.
+*/
+
+struct BenchTimes
+{
+	double arm7;		// seconds spent in the sound cpu
+	double aica;		// in the aica channels and dsp
+	double dsp;			// in the dsp alone
+};
+
+extern bool bench_active;
+extern BenchTimes bench_times;
+
+// After the settings are loaded. Returns true for a headless run, without a window or input
+bool bench_init();
+
+// Instead of the ui loop, when headless
+void bench_main();
+
+// Every vblank, applies the input trace and stops after the last frame
+void bench_vblank();
@@ -116,6 +116,14 @@ int showhelp(wchar** argv,int cl)
     printf("            The spaces between the values and ',' are needed.\n");
     printf("  -portable:\n");
     printf("      Look for data and discs in the current directory\n");
+    printf("  -bench frames [-bench-input trace] [-bench-report file.json] [-bench-renderer slug]\n");
+    printf("      Run the image unthrottled and without audio for that many frames, then\n");
+    printf("      write a performance report. Headless unless a renderer is given\n");
+    printf("  -bench-switch packets [-bench-report file.json]\n");
+    printf("      Measure the bba virtual switch with that many frames instead\n");
+    printf("  -input-latency file.json\n");
+    printf("      Measure the time from host input to the frame showing it and write\n");
+    printf("      the histograms when the emulator exits\n");
     printf("  -help:\n");
     printf("      Show the help info that you're reading now\n\n");
 
@@ -150,6 +158,22 @@ bool ParseCommandLine(int argc,wchar* argv[])
 			add_system_config_dir(".");
 			add_system_data_dir(".");
 		}
+		else if ((stricmp(*arg,"-bench")==0 || stricmp(*arg,"-bench-input")==0
+			|| stricmp(*arg,"-bench-report")==0 || stricmp(*arg,"-bench-renderer")==0
+			|| stricmp(*arg,"-bench-switch")==0) && cl>=1)
+		{
+			const char* key = stricmp(*arg,"-bench")==0 ? "frames" : *arg + strlen("-bench-");
+
+			cfgSetVirtual("bench", key, arg[1]);
+			arg++;
+			cl--;
+		}
+		else if (stricmp(*arg,"-input-latency")==0 && cl>=1)
+		{
+			cfgSetVirtual("input", "LatencyReport", arg[1]);
+			arg++;
+			cl--;
+		}
 		else
 		{
 			char* extension = strrchr(*arg, '.');
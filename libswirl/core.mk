@@ -121,6 +121,10 @@ ifdef USE_MODEM
 	RZDCY_MODULES += hw/modem/ gpl/deps/picotcp/modules/ gpl/deps/picotcp/stack/
 endif
 
+ifdef USE_BBA
+	RZDCY_CFLAGS += -DENABLE_BBA
+endif
+
 ifdef NO_REC
 	RZDCY_CFLAGS += -DTARGET_NO_REC
 else
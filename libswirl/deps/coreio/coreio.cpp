@@ -2,6 +2,11 @@
 #include "coreio.h"
 
 #include "utils/http.h"
+#include "stdclass.h"
+
+#if HOST_OS != OS_WINDOWS
+#include <sys/mman.h>
+#endif
 
 struct CoreFile
 {
@@ -11,12 +16,17 @@ struct CoreFile
 	virtual size_t read(void* buff, size_t len) = 0;
 	virtual size_t size() = 0;
 
+	virtual const void* map(size_t* len) { return nullptr; }
+	virtual void advise(size_t offs, size_t len) { }
+
 	virtual ~CoreFile() { }
 };
 
 struct CoreFileLocal: CoreFile
 {
 	FILE* f = nullptr;
+	void* mapping = nullptr;
+	size_t mapping_size = 0;
 
 	static CoreFile* open(const char* path)
 	{
@@ -53,7 +63,48 @@ struct CoreFileLocal: CoreFile
 		return rv;
 	}
 
+#if HOST_OS != OS_WINDOWS
+	const void* map(size_t* len)
+	{
+		if (mapping == nullptr)
+		{
+			size_t sz = size();
+			void* p = sz ? mmap(NULL, sz, PROT_READ, MAP_SHARED, fileno(f), 0) : MAP_FAILED;
+
+			if (p == MAP_FAILED)
+				return nullptr;
+
+			// disc images are mostly read front to back, in long runs
+			madvise(p, sz, MADV_SEQUENTIAL);
+
+			mapping = p;
+			mapping_size = sz;
+		}
+
+		*len = mapping_size;
+		return mapping;
+	}
+
+	void advise(size_t offs, size_t len)
+	{
+		if (mapping == nullptr || offs >= mapping_size)
+			return;
+
+		size_t page = offs & ~(size_t)REI_PAGE_MASK;
+		len = std::min(len + offs - page, mapping_size - page);
+
+		madvise((u8*)mapping + page, len, MADV_WILLNEED);
+	}
+
+	~CoreFileLocal()
+	{
+		if (mapping)
+			munmap(mapping, mapping_size);
+		fclose(f);
+	}
+#else
 	~CoreFileLocal() { fclose(f); }
+#endif
 };
 
 struct CoreFileHTTP: CoreFile
@@ -160,6 +211,20 @@ extern "C" int core_fclose(core_file* fc)
 	return 0;
 }
 
+extern "C" const void* core_fmap(core_file* fc, size_t* size)
+{
+	CoreFile* f = (CoreFile*)fc;
+
+	return f->map(size);
+}
+
+extern "C" void core_fadvise(core_file* fc, size_t offs, size_t len)
+{
+	CoreFile* f = (CoreFile*)fc;
+
+	f->advise(offs, len);
+}
+
 extern "C" size_t core_fsize(core_file* fc)
 {
 	CoreFile* f = (CoreFile*)fc;
@@ -15,6 +15,11 @@ extern "C"  {
     size_t core_fsize(core_file* fc);
     size_t core_ftell(core_file* fc);
 
+    // Read only mapping of the whole file, or NULL if the file system can't map it (remote files)
+    const void* core_fmap(core_file* fc, size_t* size);
+    // Mapped files only: the range is about to be read
+    void core_fadvise(core_file* fc, size_t offs, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -10,8 +10,6 @@
 #include "rend/rend.h"
 
 extern cResetEvent rs;
-extern cResetEvent frame_finished;
-extern TA_context* rqueue;
 
 void SetREP(TA_context* cntx);
 TA_context* read_frame(const char* file, u8* vram_ref = NULL);
@@ -48,8 +46,8 @@ void dc_run()
 		rend_context saved_rend = ctx->rend;
 		FillBGP(ctx);
 
-		if (rqueue)
-			frame_finished.Wait();
+		if (p_tastate->rqueue)
+			p_tastate->frame_finished.Wait();
 		if (QueueRender(ctx))  {
 			palette_update();
 #if !defined(TARGET_NO_THREADS)
@@ -0,0 +1,573 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#include "game_library.h"
+#include "stdclass.h"
+#include "oslib/oslib.h"
+#include "oslib/threading.h"
+#include "imgread/imgread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <set>
+#ifdef _MSC_VER
+#include "dirent/dirent.h"
+#define S_ISDIR(mode) (((mode) & _S_IFMT) == _S_IFDIR)
+#else
+#include <dirent.h>
+#endif
+#include <sys/stat.h>
+
+#define LIBRARY_HEADER "# reicast game library 1"
+#define SCAN_THREADS 4		// reading directories on network shares is mostly waiting
+
+struct LibraryDir
+{
+	u64 mtime;
+	vector<string> subdirs;
+	vector<GameMedia> games;
+};
+
+// By directory path
+typedef std::map<string, LibraryDir> LibraryIndex;
+
+static cMutex library_lock;
+static LibraryIndex library_index;		// of the last scan, only the scan thread changes it
+static vector<GameMedia> library_list;
+static bool library_changed;
+static bool index_loaded;
+
+static vector<string> scan_paths;
+static bool scan_pending;
+static std::atomic<bool> scan_running;
+static std::atomic<bool> scan_abort;
+
+static void* scan_main(void* param);
+
+#if !defined(HOST_NO_THREADS)
+static cThread scan_thread(scan_main, NULL);
+#endif
+
+static bool is_game_file(const string& name)
+{
+#if DC_PLATFORM == DC_PLATFORM_DREAMCAST
+	if (name.size() < 4)
+		return false;
+
+	const char* extension = name.c_str() + name.size() - 4;
+
+	return !stricmp(extension, ".cdi") || !stricmp(extension, ".gdi") || !stricmp(extension, ".chd") || !stricmp(extension, ".cue");
+#else
+	string::size_type dotpos = name.find_last_of(".");
+
+	if (dotpos == string::npos || dotpos == name.size() - 1)
+		return false;
+
+	const char* extension = name.c_str() + dotpos;
+
+	return !stricmp(extension, ".zip") || !stricmp(extension, ".7z") || !stricmp(extension, ".bin")
+		|| !stricmp(extension, ".lst") || !stricmp(extension, ".dat");
+#endif
+}
+
+const char* game_library_disc_name(u32 disc_type)
+{
+	switch (disc_type)
+	{
+	case GdRom: return "GD-ROM";
+	case CdRom: return "CD-ROM";
+	case CdRom_XA: return "CD-ROM XA";
+	case CdRom_Extra: return "CD-ROM Extra";
+	case CdRom_CDI: return "CD-i";
+	case CdDA: return "CD-DA";
+	default: return "unknown";
+	}
+}
+
+// Software name from the IP.BIN, at the start of the data area of the last session
+static string read_title(Disc* disc)
+{
+	if (disc->sessions.empty())
+		return "";
+
+	u8 ip[2352] = { 0 };
+	disc->ReadSectors(disc->type == GdRom ? 45150 : disc->sessions.back().StartFAD, 1, ip, 2048);
+
+	if (memcmp(ip, "SEGA SEGAKATANA", 15) != 0)
+		return "";
+
+	string title((const char*)ip + 128, 128);
+
+	for (char& c : title)
+	{
+		if ((u8)c < ' ')
+			c = ' ';
+	}
+
+	title.erase(title.find_last_not_of(' ') + 1);
+
+	return title;
+}
+
+// One scan of the content directories, the directories are read by several threads
+struct LibraryScan
+{
+	const LibraryIndex* old_index;
+	LibraryIndex index;
+
+	cMutex lock;
+	vector<string> queue;			// directories left to read
+	std::set<string> queued;
+	u32 busy = 0;					// threads reading one
+
+	u32 dirs_read = 0;
+	std::atomic<u32> probed { 0 };
+
+	void Queue(const vector<string>& paths)
+	{
+		for (const string& path : paths)
+		{
+			if (queued.insert(path).second)
+				queue.push_back(path);
+		}
+	}
+
+	void Probe(GameMedia& game)
+	{
+#if DC_PLATFORM == DC_PLATFORM_DREAMCAST
+		// quiet, a bad image is only left out of the list
+		Disc* disc = OpenDisc(game.path.c_str(), true);
+
+		if (disc != NULL)
+		{
+			game.disc_type = disc->type;
+			game.title = read_title(disc);
+			delete disc;
+		}
+
+		probed++;
+#endif
+	}
+
+	void ReadDir(const string& path)
+	{
+		struct stat st;
+
+		if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+			return;
+
+		auto known = old_index->find(path);
+
+		// nothing was added, removed or renamed in it since the last scan
+		if (known != old_index->end() && known->second.mtime == (u64)st.st_mtime)
+		{
+			lock.Lock();
+			index[path] = known->second;
+			Queue(known->second.subdirs);
+			lock.Unlock();
+			return;
+		}
+
+		DIR* dir = opendir(path.c_str());
+
+		if (dir == NULL)
+			return;
+
+		LibraryDir result;
+		result.mtime = st.st_mtime;
+
+		// what was there, images with the same size and mtime aren't opened again
+		std::map<string, const GameMedia*> before;
+
+		if (known != old_index->end())
+		{
+			for (const GameMedia& game : known->second.games)
+				before[game.name] = &game;
+		}
+
+		while (!scan_abort)
+		{
+			struct dirent* entry = readdir(dir);
+
+			if (entry == NULL)
+				break;
+
+			string name(entry->d_name);
+
+			if (name == "." || name == "..")
+				continue;
+
+			string child_path = path + "/" + name;
+			bool is_dir = false;
+			bool stated = false;
+#ifndef _WIN32
+			if (entry->d_type == DT_DIR)
+				is_dir = true;
+			if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+#endif
+			{
+				if (stat(child_path.c_str(), &st) != 0)
+					continue;
+				is_dir = S_ISDIR(st.st_mode);
+				stated = true;
+			}
+
+			if (is_dir)
+			{
+				result.subdirs.push_back(child_path);
+				continue;
+			}
+
+			if (!is_game_file(name) || (!stated && stat(child_path.c_str(), &st) != 0))
+				continue;
+
+			GameMedia game = { name, child_path, (u64)st.st_size, (u64)st.st_mtime, 0, "" };
+			auto old = before.find(name);
+
+			if (old != before.end() && old->second->size == game.size && old->second->mtime == game.mtime)
+			{
+				game.disc_type = old->second->disc_type;
+				game.title = old->second->title;
+			}
+			else
+				Probe(game);
+
+			result.games.push_back(game);
+		}
+
+		closedir(dir);
+
+		lock.Lock();
+		dirs_read++;
+		Queue(result.subdirs);
+		index[path] = std::move(result);
+		lock.Unlock();
+	}
+
+	static void* Worker(void* param)
+	{
+		LibraryScan* scan = (LibraryScan*)param;
+
+		for (;;)
+		{
+			scan->lock.Lock();
+
+			if (scan->queue.empty())
+			{
+				bool done = scan->busy == 0;
+				scan->lock.Unlock();
+
+				if (done)
+					return NULL;
+
+				SleepMs(1);
+				continue;
+			}
+
+			string path = scan->queue.back();
+			scan->queue.pop_back();
+			scan->busy++;
+			scan->lock.Unlock();
+
+			if (!scan_abort)
+				scan->ReadDir(path);
+
+			scan->lock.Lock();
+			scan->busy--;
+			scan->lock.Unlock();
+		}
+	}
+
+	void Run(const vector<string>& paths)
+	{
+		Queue(paths);
+
+#if !defined(HOST_NO_THREADS)
+		// the calling thread is one of them
+		vector<cThread*> started;
+
+		for (u32 i = 1; i < SCAN_THREADS; i++)
+		{
+			started.push_back(new cThread(&LibraryScan::Worker, this));
+			started.back()->Start();
+		}
+
+		Worker(this);
+
+		for (size_t i = 0; i < started.size(); i++)
+			delete started[i];	// waits for it
+#else
+		Worker(this);
+#endif
+	}
+};
+
+// The games of the directories reachable from paths, sorted by name
+static vector<GameMedia> list_from_index(const LibraryIndex& index, const vector<string>& paths)
+{
+	vector<GameMedia> list;
+	vector<string> pending(paths.begin(), paths.end());
+	std::set<string> seen;
+
+	while (!pending.empty())
+	{
+		string path = pending.back();
+		pending.pop_back();
+
+		auto it = index.find(path);
+
+		if (it == index.end() || !seen.insert(path).second)
+			continue;
+
+		list.insert(list.end(), it->second.games.begin(), it->second.games.end());
+		pending.insert(pending.end(), it->second.subdirs.begin(), it->second.subdirs.end());
+	}
+
+	std::stable_sort(list.begin(), list.end(), [](const GameMedia& left, const GameMedia& right) {
+		return left.name < right.name;
+	});
+
+	return list;
+}
+
+static string index_path()
+{
+	return get_writable_data_path(DATA_PATH "game_library.txt");
+}
+
+/*
+	One line per entry, tab separated, the subdirectories and games follow their directory
+		D	mtime	path
+		S	path
+		G	size	mtime	disc type	name	title
+*/
+static void load_index(LibraryIndex& index)
+{
+	FILE* f = fopen(index_path().c_str(), "r");
+
+	if (f == NULL)
+		return;
+
+	char line[4096];
+	LibraryDir* dir = NULL;
+
+	if (fgets(line, sizeof(line), f) == NULL || strncmp(line, LIBRARY_HEADER, strlen(LIBRARY_HEADER)) != 0)
+	{
+		printf("Game library: %s is from another version, ignoring it\n", index_path().c_str());
+		fclose(f);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), f))
+	{
+		line[strcspn(line, "\r\n")] = 0;
+
+		vector<string> fields;
+
+		for (char* p = line; ; )
+		{
+			char* tab = strchr(p, '\t');
+			fields.push_back(tab ? string(p, tab - p) : string(p));
+			if (tab == NULL)
+				break;
+			p = tab + 1;
+		}
+
+		if (fields[0] == "D" && fields.size() == 3)
+		{
+			dir = &index[fields[2]];
+			dir->mtime = strtoull(fields[1].c_str(), NULL, 10);
+		}
+		else if (fields[0] == "S" && fields.size() == 2 && dir != NULL)
+		{
+			dir->subdirs.push_back(fields[1]);
+		}
+		else if (fields[0] == "G" && fields.size() == 6 && dir != NULL)
+		{
+			GameMedia game;
+			game.size = strtoull(fields[1].c_str(), NULL, 10);
+			game.mtime = strtoull(fields[2].c_str(), NULL, 10);
+			game.disc_type = strtoul(fields[3].c_str(), NULL, 10);
+			game.name = fields[4];
+			game.title = fields[5];
+			dir->games.push_back(game);
+		}
+	}
+
+	fclose(f);
+
+	// the paths of the games aren't stored
+	for (auto& it : index)
+	{
+		for (GameMedia& game : it.second.games)
+			game.path = it.first + "/" + game.name;
+	}
+}
+
+// Names with tabs or line breaks aren't stored, their directory is then read again every time
+static bool storable(const string& name)
+{
+	return name.find_first_of("\t\r\n") == string::npos;
+}
+
+static void save_index(const LibraryIndex& index)
+{
+	string path = index_path();
+	FILE* f = fopen(path.c_str(), "w");
+
+	if (f == NULL)
+	{
+		printf("Game library: can't write %s\n", path.c_str());
+		return;
+	}
+
+	bool ok = fprintf(f, "%s\n", LIBRARY_HEADER) > 0;
+
+	for (const auto& it : index)
+	{
+		if (!storable(it.first))
+			continue;
+
+		bool complete = true;
+
+		for (const string& subdir : it.second.subdirs)
+			complete = complete && storable(subdir);
+
+		for (const GameMedia& game : it.second.games)
+			complete = complete && storable(game.name);
+
+		ok = fprintf(f, "D\t%llu\t%s\n", complete ? (unsigned long long)it.second.mtime : 0ull, it.first.c_str()) > 0 && ok;
+
+		for (const string& subdir : it.second.subdirs)
+		{
+			if (storable(subdir))
+				ok = fprintf(f, "S\t%s\n", subdir.c_str()) > 0 && ok;
+		}
+
+		for (const GameMedia& game : it.second.games)
+		{
+			if (storable(game.name))
+			{
+				ok = fprintf(f, "G\t%llu\t%llu\t%u\t%s\t%s\n", (unsigned long long)game.size, (unsigned long long)game.mtime,
+					game.disc_type, game.name.c_str(), game.title.c_str()) > 0 && ok;
+			}
+		}
+	}
+
+	ok = fclose(f) == 0 && ok;
+
+	if (!ok)
+	{
+		printf("Game library: can't write %s\n", path.c_str());
+		remove(path.c_str());
+	}
+}
+
+static void* scan_main(void* param)
+{
+	bool again = true;
+
+	while (again)
+	{
+		library_lock.Lock();
+		vector<string> paths = scan_paths;
+		scan_pending = false;
+		library_lock.Unlock();
+
+		double start = os_GetSeconds();
+
+		LibraryScan scan;
+		scan.old_index = &library_index;
+		scan.Run(paths);
+
+		if (scan_abort)
+		{
+			scan_running = false;
+			break;
+		}
+
+		vector<GameMedia> list = list_from_index(scan.index, paths);
+		save_index(scan.index);
+
+		printf("Game library: %d games, %u of %d directories read, %u images opened, in %.2f s\n",
+			(int)list.size(), scan.dirs_read, (int)scan.index.size(), (u32)scan.probed, os_GetSeconds() - start);
+
+		library_lock.Lock();
+		library_index.swap(scan.index);
+		library_list.swap(list);
+		library_changed = true;
+
+		again = scan_pending;
+		if (!again)
+			scan_running = false;
+		library_lock.Unlock();
+	}
+
+	return NULL;
+}
+
+void game_library_scan(const vector<string>& paths)
+{
+	library_lock.Lock();
+
+	if (!index_loaded)
+	{
+		index_loaded = true;
+		load_index(library_index);
+		library_list = list_from_index(library_index, paths);
+		library_changed = true;
+	}
+
+	scan_paths = paths;
+
+	bool start = !scan_running;
+	if (start)
+		scan_running = true;
+	else
+		scan_pending = true;
+
+	library_lock.Unlock();
+
+	if (!start)
+		return;
+
+#if !defined(HOST_NO_THREADS)
+	scan_thread.WaitToEnd();	// the last one is done, but not joined yet
+	scan_thread.Start();
+#else
+	scan_main(NULL);
+#endif
+}
+
+bool game_library_get(vector<GameMedia>& list)
+{
+	library_lock.Lock();
+
+	bool changed = library_changed;
+
+	if (changed)
+		list = library_list;
+
+	library_changed = false;
+	library_lock.Unlock();
+
+	return changed;
+}
+
+bool game_library_scanning()
+{
+	return scan_running;
+}
+
+void game_library_term()
+{
+#if !defined(HOST_NO_THREADS)
+	scan_abort = true;
+	scan_thread.WaitToEnd();
+	scan_abort = false;
+#endif
+}
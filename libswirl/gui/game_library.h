@@ -0,0 +1,37 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#pragma once
+#include "types.h"
+
+/*
+	The games found in the content directories. Scanning runs on threads of its own, and what it
+	found is kept in an index in the data directory so the list is there at once on the next start.
+	A directory whose mtime didn't change is taken from the index without being read, and only new
+	or changed images are opened for their IP.BIN.
+*/
+struct GameMedia
+{
+	std::string name;		// file name
+	std::string path;
+	u64 size;
+	u64 mtime;
+	u32 disc_type;			// DiscType, 0 if it isn't a disc or couldn't be read
+	std::string title;		// from IP.BIN, empty if there is none
+};
+
+// Loads the index, and scans the directories in the background. A scan asked for while one runs
+// is done after it
+void game_library_scan(const std::vector<std::string>& paths);
+
+// The list sorted by name, false if it didn't change since the last call
+bool game_library_get(std::vector<GameMedia>& list);
+bool game_library_scanning();
+
+// Stops the scan, without saving what it found so far
+void game_library_term();
+
+const char* game_library_disc_name(u32 disc_type);
@@ -44,6 +44,7 @@
 
 #include "libswirl.h"
 #include "gui/gui_renderer.h"
+#include "gui/game_library.h"
 
 bool game_started;
 
@@ -70,16 +71,6 @@ bool maple_devices_changed;
 ImVec2 normal_padding;
 int dynarec_enabled;
 
-struct GameMedia {
-    std::string name;
-    std::string path;
-};
-
-static bool operator<(const GameMedia& left, const GameMedia& right)
-{
-    return left.name < right.name;
-}
-
 static std::vector<GameMedia> game_list;
 
 static unique_ptr<OnlineRomsProvider> reicastCloudRoms(OnlineRomsProvider::CreateHttpProvider("http://cloudroms.reicast.com", "/homebrew.lst"));
@@ -438,6 +429,7 @@ struct ReicastUI_impl : GUI {
 
     ~ReicastUI_impl()
     {
+        game_library_term();
         virtualDreamcast.reset();
 
         inited = false;
@@ -668,73 +660,14 @@ struct ReicastUI_impl : GUI {
         }
     }
 
-    void add_game_directory(const std::string& path, std::vector<GameMedia>& game_list)
+    void fetch_game_list()
     {
-        //printf("Exploring %s\n", path.c_str());
-        DIR* dir = opendir(path.c_str());
-        if (dir == NULL)
-            return;
-        while (true)
+        if (!game_list_done)
         {
-            struct dirent* entry = readdir(dir);
-            if (entry == NULL)
-                break;
-        std:string name(entry->d_name);
-            if (name == "." || name == "..")
-                continue;
-            std::string child_path = path + "/" + name;
-            bool is_dir = false;
-#ifndef _WIN32
-            if (entry->d_type == DT_DIR)
-                is_dir = true;
-            if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
-#endif
-            {
-                struct stat st;
-                if (stat(child_path.c_str(), &st) != 0)
-                    continue;
-                if (S_ISDIR(st.st_mode))
-                    is_dir = true;
-            }
-            if (is_dir)
-            {
-                add_game_directory(child_path, game_list);
-            }
-            else
-            {
-#if DC_PLATFORM == DC_PLATFORM_DREAMCAST
-                if (name.size() >= 4)
-                {
-                    std::string extension = name.substr(name.size() - 4).c_str();
-                    //printf("  found game %s ext %s\n", entry->d_name, extension.c_str());
-                    if (stricmp(extension.c_str(), ".cdi") && stricmp(extension.c_str(), ".gdi") && stricmp(extension.c_str(), ".chd") && stricmp(extension.c_str(), ".cue"))
-                        continue;
-                    game_list.push_back({ name, child_path });
-                }
-#else
-                std::string::size_type dotpos = name.find_last_of(".");
-                if (dotpos == std::string::npos || dotpos == name.size() - 1)
-                    continue;
-                std::string extension = name.substr(dotpos);
-                if (stricmp(extension.c_str(), ".zip") && stricmp(extension.c_str(), ".7z") && stricmp(extension.c_str(), ".bin")
-                    && stricmp(extension.c_str(), ".lst") && stricmp(extension.c_str(), ".dat"))
-                    continue;
-                game_list.push_back({ name, child_path });
-#endif
-            }
+            game_library_scan(settings.dreamcast.ContentPath);
+            game_list_done = true;
         }
-        closedir(dir);
-    }
-
-    void fetch_game_list()
-    {
-        if (game_list_done)
-            return;
-        game_list.clear();
-        for (auto path : settings.dreamcast.ContentPath)
-            add_game_directory(path, game_list);
-        std::stable_sort(game_list.begin(), game_list.end());
-        game_list_done = true;
+        game_library_get(game_list);
     }
 
     void gui_render_demo()
@@ -986,9 +919,14 @@ struct ReicastUI_impl : GUI {
 
             ImGui::Text("%s", "");
             ImGui::TextColored(ImVec4(1, 1, 1, 0.7), "LOCAL ROMS");
+            if (game_library_scanning())
+            {
+                ImGui::SameLine();
+                ImGui::TextColored(ImVec4(1, 1, 1, 0.4), "(scanning)");
+            }
 
-            for (auto game : game_list)
-                if (filter.PassFilter(game.name.c_str()))
+            for (const auto& game : game_list)
+                if (filter.PassFilter(game.name.c_str()) || (!game.title.empty() && filter.PassFilter(game.title.c_str())))
                 {
                     ImGui::PushID(game.path.c_str());
                     if (ImGui::Selectable(game.name.c_str()))
@@ -996,6 +934,8 @@ struct ReicastUI_impl : GUI {
                         if (gui_start_game(game.path))
                             gui_state = Closed;
                     }
+                    if (!game.title.empty() && ImGui::IsItemHovered())
+                        ImGui::SetTooltip("%s (%s)", game.title.c_str(), game_library_disc_name(game.disc_type));
                     ImGui::PopID();
                 }
 
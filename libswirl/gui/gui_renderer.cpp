@@ -13,6 +13,7 @@
 #include "gui_renderer.h"
 #include "oslib/oslib.h"
 #include "input/gamepad.h"
+#include "input/input_latency.h"
 #include "gui/gui_partials.h"
 
 std::unique_ptr<GUIRenderer> g_GUIRenderer;
@@ -469,6 +470,7 @@ struct GUIRenderer_impl : GUIRenderer {
                 {
                     rv = false;
                 }
+                latency_frame_presented();
             }
         }
         else  if (g_GUI->IsOpen())
@@ -605,3 +607,83 @@ struct GUIRenderer_impl : GUIRenderer {
 GUIRenderer* GUIRenderer::Create(GUI* gui) {
     return new GUIRenderer_impl();
 };
+
+// GUIRenderer, headless
+
+struct GUIRenderer_headless : GUIRenderer {
+    std::atomic<bool> keepRunning;
+    std::atomic<bool> frameDone;
+    cMutex callback_mutex;
+    cResetEvent pendingCallback;
+    cResetEvent queueEmpty;
+
+    std::function<bool()> callback;
+
+    GUIRenderer_headless() {
+        keepRunning = true;
+        frameDone = true;
+    }
+
+    virtual void Stop() {
+        keepRunning = false;
+        pendingCallback.Set();
+    }
+
+    virtual void Start() {
+        keepRunning = true;
+    }
+
+    virtual void UIFrame() {
+        std::function<bool()> cb;
+
+        callback_mutex.Lock();
+        {
+            cb = callback;
+            callback = nullptr;
+        }
+        callback_mutex.Unlock();
+
+        // nothing to present, the renderer still processes the frame
+        if (cb && cb())
+            latency_frame_presented();
+
+        callback_mutex.Lock();
+        frameDone = callback == nullptr;
+        callback_mutex.Unlock();
+
+        if (frameDone)
+            queueEmpty.Set();
+    }
+
+    virtual bool CreateContext() {
+        return true;
+    }
+
+    virtual void UILoop() {
+        while (keepRunning) {
+            pendingCallback.Wait(10);
+            UIFrame();
+        }
+        // the emulator thread may wait for a last frame while stopping
+        UIFrame();
+    }
+
+    virtual void QueueEmulatorFrame(std::function<bool()> cb) {
+        callback_mutex.Lock();
+        frameDone = false;
+        callback = cb;
+        callback_mutex.Unlock();
+
+        pendingCallback.Set();
+    }
+
+    virtual void WaitQueueEmpty() {
+        // a Set left over from an earlier frame only means another look at frameDone
+        while (!frameDone)
+            queueEmpty.Wait();
+    }
+};
+
+GUIRenderer* GUIRenderer::CreateHeadless() {
+    return new GUIRenderer_headless();
+}
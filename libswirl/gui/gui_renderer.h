@@ -30,6 +30,9 @@ struct GUIRenderer {
     virtual ~GUIRenderer() { }
 
     static GUIRenderer* Create(GUI* gui);
+
+    // No window, context or ui. Runs the emulator frames without presenting them, for benchmarks
+    static GUIRenderer* CreateHeadless();
 };
 
 extern std::unique_ptr<GUIRenderer> g_GUIRenderer;
\ No newline at end of file
@@ -88,6 +88,57 @@ void gui_settings_advanced()
 			ImGui::Columns(1, NULL, false);
 		}
 		
+		if (ImGui::CollapsingHeader("Rewind", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::Checkbox("Enable Rewind", &settings.rewind.Enable);
+			ImGui::SameLine();
+			gui_ShowHelpMarker("Keep in-memory snapshots to step back in time while the Rewind button is held");
+
+			ImGui::SliderInt("Snapshot Interval", (int *)&settings.rewind.Interval, 1, 60);
+			ImGui::SameLine();
+			gui_ShowHelpMarker("Frames between two snapshots. Lower values rewind more smoothly but cost more CPU");
+
+			ImGui::SliderInt("Snapshots", (int *)&settings.rewind.MaxSnapshots, 1, 600);
+			ImGui::SameLine();
+			gui_ShowHelpMarker("Number of snapshots kept, older ones are dropped");
+		}
+
+		if (ImGui::CollapsingHeader("Run-Ahead", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::Checkbox("Enable Run-Ahead", &settings.runahead.Enable);
+			ImGui::SameLine();
+			gui_ShowHelpMarker("Emulate ahead with the current input and show that frame, to hide the game's own input lag. Disables rewind");
+
+			ImGui::SliderInt("Frames Ahead", (int *)&settings.runahead.Frames, 1, 6);
+			ImGui::SameLine();
+			gui_ShowHelpMarker("Set to the game's internal lag. Higher values cost a full frame of emulation each");
+		}
+
+		if (ImGui::CollapsingHeader("GD-ROM", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::Checkbox("Asynchronous Reads", &settings.imgread.AsyncRead);
+			ImGui::SameLine();
+			gui_ShowHelpMarker("Read the next sectors of a read command on a background thread while the drive transfers the current ones. Slow storage then doesn't stall the emulation");
+		}
+
+		if (ImGui::CollapsingHeader("CHD Images", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::SliderInt("Cached Hunks", (int *)&settings.imgread.ChdCacheHunks, 1, 256);
+			ImGui::SameLine();
+			gui_ShowHelpMarker("Decompressed hunks kept in memory, about 20 KB each. Applies to the next image opened");
+
+			ImGui::Checkbox("Read Ahead", &settings.imgread.ChdReadAhead);
+			ImGui::SameLine();
+			gui_ShowHelpMarker("Decompress the sectors a read command asks for on a background thread, before the game gets to them");
+		}
+
+		if (ImGui::CollapsingHeader("NAOMI", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			ImGui::Checkbox("Cache Decrypted GD-ROM Data", &settings.naomi.DecryptCache);
+			ImGui::SameLine();
+			gui_ShowHelpMarker("Save the decrypted DIMM data of GD-ROM games in the data folder, so they boot without decrypting it again");
+		}
+
 		if (ImGui::CollapsingHeader("Cloudroms", ImGuiTreeNodeFlags_DefaultOpen))
 	    {
 			ImGui::Checkbox("Hide Homebrew", &settings.cloudroms.HideHomebrew);
@@ -25,9 +25,15 @@ void gui_settings_audio()
 		ImGui::Checkbox("Enable DSP", &settings.aica.NoBatch);
         ImGui::SameLine();
         gui_ShowHelpMarker("Enable the Dreamcast Digital Sound Processor. Only recommended on fast and arm64 platforms");
+		ImGui::Checkbox("Vector Mixer", &settings.aica.VectorMixer);
+        ImGui::SameLine();
+        gui_ShowHelpMarker("Mix the sound channels in blocks of 32 samples that the compiler can vectorize. Same output, faster. Not used with the DSP");
 		ImGui::Checkbox("Limit FPS", &settings.aica.LimitFPS);
         ImGui::SameLine();
         gui_ShowHelpMarker("Use the sound output to limit the speed of the emulator. Recommended in most cases");
+		ImGui::Checkbox("Dynamic Rate Control", &settings.audio.RateControl);
+        ImGui::SameLine();
+        gui_ShowHelpMarker("Play the sound up to 0.5% faster or slower to keep the buffer level, so the sound keeps up with the video without gaps. Only for backends that pull the sound (SDL2, DirectSound)");
 
 		audiobackend_t* backend = NULL;;
 		std::string backend_name = settings.audio.backend;
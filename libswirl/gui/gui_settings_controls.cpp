@@ -75,10 +75,10 @@ static const char *maple_expansion_device_name(MapleDeviceType type)
 
 const char *maple_ports[] = { "None", "A", "B", "C", "D" };
 const DreamcastKey button_keys[] = { EMU_BTN_STICK_UP, EMU_BTN_STICK_DOWN, EMU_BTN_STICK_LEFT, EMU_BTN_STICK_RIGHT, DC_BTN_START, DC_BTN_A, DC_BTN_B, DC_BTN_X, DC_BTN_Y, DC_DPAD_UP, DC_DPAD_DOWN, DC_DPAD_LEFT, DC_DPAD_RIGHT,
-		EMU_BTN_MENU, EMU_BTN_SPEED_LIMIT, EMU_BTN_ESCAPE, EMU_BTN_TRIGGER_LEFT, EMU_BTN_TRIGGER_RIGHT,
+		EMU_BTN_MENU, EMU_BTN_SPEED_LIMIT, EMU_BTN_REWIND, EMU_BTN_ESCAPE, EMU_BTN_TRIGGER_LEFT, EMU_BTN_TRIGGER_RIGHT,
 		DC_BTN_C, DC_BTN_D, DC_BTN_Z, DC_DPAD2_UP, DC_DPAD2_DOWN, DC_DPAD2_LEFT, DC_DPAD2_RIGHT };
 const char *button_names[] = { "Stick Up", "Stick Down", "Stick Left", "Stick Right", "Start", "A", "B", "X", "Y", "DPad Up", "DPad Down", "DPad Left", "DPad Right",
-		"Menu", "Toggle Speed Limit", "Exit", "Left Trigger", "Right Trigger",
+		"Menu", "Toggle Speed Limit", "Rewind", "Exit", "Left Trigger", "Right Trigger",
 		"C", "D", "Z", "Right Dpad Up", "Right DPad Down", "Right DPad Left", "Right DPad Right" };
 const DreamcastKey axis_keys[] = { DC_AXIS_X, DC_AXIS_Y, DC_AXIS_LT, DC_AXIS_RT, EMU_AXIS_DPAD1_X, EMU_AXIS_DPAD1_Y, EMU_AXIS_DPAD2_X, EMU_AXIS_DPAD2_Y };
 const char *axis_names[] = { "Stick X", "Stick Y", "Left Trigger", "Right Trigger", "DPad X", "DPad Y", "Right DPad X", "Right DPad Y" };
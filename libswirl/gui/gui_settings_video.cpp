@@ -49,6 +49,9 @@ void gui_settings_video()
 	    	ImGui::Checkbox("Synchronous Rendering", &settings.pvr.SynchronousRender);
             ImGui::SameLine();
             gui_ShowHelpMarker("Reduce frame skipping by pausing the CPU when possible. Recommended for powerful devices");
+	    	ImGui::Checkbox("Shader Cache", &settings.rend.ShaderCache);
+            ImGui::SameLine();
+            gui_ShowHelpMarker("Save compiled shaders to disk and load them at startup to avoid stuttering when new effects appear");
 	    	ImGui::Checkbox("Clipping", &settings.rend.Clipping);
             ImGui::SameLine();
             gui_ShowHelpMarker("Enable clipping. May produce graphical errors when disabled");
@@ -85,6 +88,9 @@ void gui_settings_video()
 	    	ImGui::Checkbox("Copy to VRAM", &settings.rend.RenderToTextureBuffer);
             ImGui::SameLine();
             gui_ShowHelpMarker("Copy rendered-to textures back to VRAM. Slower but accurate");
+	    	ImGui::Checkbox("Deferred VRAM Copy", &settings.rend.RenderToTextureDeferred);
+            ImGui::SameLine();
+            gui_ShowHelpMarker("Copy to VRAM asynchronously, one frame later, without stalling the GPU. Turn off for games that read the copy right away");
 	    	ImGui::SliderInt("Render to Texture Upscaling", (int *)&settings.rend.RenderToTextureUpscale, 1, 8);
             ImGui::SameLine();
             gui_ShowHelpMarker("Upscale rendered-to textures. Should be the same as the screen or window upscale ratio, or lower for slow platforms");
@@ -35,6 +35,7 @@
 #include "hw/sh4/sh4_sched.h"
 
 #include "libswirl.h"
+#include "benchmark.h"
 #include <time.h>
 
 struct AICARTC_impl : MMIODevice
@@ -48,6 +49,9 @@ struct AICARTC_impl : MMIODevice
 		// The Dreamcast Epoch time is 1/1/50 00:00 but without support for time zone or DST.
 		// We compute the TZ/DST current time offset and add it to the result
 		// as if we were in the UTC time zone (as well as the DC Epoch)
+		if (bench_active)
+			return (50 * 365 + 12) * 24 * 60 * 60;	// 1/1/2000 00:00, benchmark runs are repeatable
+
 		time_t rawtime = time(NULL);
 		struct tm localtm, gmtm;
 		localtm = *localtime(&rawtime);
@@ -20,9 +20,25 @@ struct DSP_impl final : DSP {
 
 	unique_ptr<DSPBackend> backend;
 
+	// What the code in dsp.DynCode was compiled from. The backends read COEF and MADRS when the code
+	// runs, MPRO, RBL and RBP are baked in. A restored state with the same program keeps the code
+	struct {
+		u32 MPRO[128 * 4];
+		u32 RBL;
+		u32 RBP;
+		bool Stopped;
+		bool valid;
+	} compiled;
+
+	// the state is checked against it on the next step, the aica regs may be restored after the dsp
+	bool check_program;
+	u8 code_copy[sizeof(dsp.DynCode)];
+
 	DSP_impl(u8* aica_reg, u8* aica_ram, u32 aram_size) : aica_ram(aica_ram), aram_size(aram_size) {
 		
 		DSPData = (DSPData_struct*)&aica_reg[0x3000];
+		compiled.valid = false;
+		check_program = false;
 		
 		setBackend(DSPBE_INTERPRETER);
 
@@ -38,6 +54,7 @@ struct DSP_impl final : DSP {
 		dsp.Stopped = 1;
 		dsp.regs.MDEC_CT = 1;
 		dsp.dyndirty = true;
+		compiled.valid = false;
 
 
 		return true;
@@ -61,10 +78,30 @@ struct DSP_impl final : DSP {
 		}
 	}
 
+	bool SameProgram() {
+		return compiled.valid && compiled.RBL == dsp.RBL && compiled.RBP == dsp.RBP
+			&& memcmp(compiled.MPRO, DSPData->MPRO, sizeof(compiled.MPRO)) == 0;
+	}
+
 	void Step() {
+		if (check_program) {
+			check_program = false;
+
+			if (SameProgram())
+				dsp.Stopped = compiled.Stopped;
+			else
+				dsp.dyndirty = true;
+		}
+
 		if (dsp.dyndirty) {
 			backend->Recompile();
 			dsp.dyndirty = false;
+
+			memcpy(compiled.MPRO, DSPData->MPRO, sizeof(compiled.MPRO));
+			compiled.RBL = dsp.RBL;
+			compiled.RBP = dsp.RBP;
+			compiled.Stopped = dsp.Stopped;
+			compiled.valid = true;
 		}
 
 		backend->Step();
@@ -72,6 +109,7 @@ struct DSP_impl final : DSP {
 
 	bool setBackend(DspBackends type) {
 		dsp.dyndirty = true;
+		compiled.valid = false;
 
 		if (type == DSPBE_INTERPRETER) {
 			backend.reset(DSPBackend::CreateInterpreter(DSPData, &dsp, aica_ram, aram_size));
@@ -96,7 +134,16 @@ struct DSP_impl final : DSP {
 	}
 
 	void unserialize(void** data, unsigned int* total_size) {
+		// the saved code has this process' addresses in it only by chance, the compiled one is kept
+		memcpy(code_copy, dsp.DynCode, sizeof(code_copy));
+
 		REICAST_US(dsp);
+
+		memcpy(dsp.DynCode, code_copy, sizeof(code_copy));
+
+		// run-ahead and rewind restores mostly have the same program, it's only compiled again if not
+		dsp.dyndirty = !compiled.valid;
+		check_program = compiled.valid;
 	}
 };
 
@@ -0,0 +1,497 @@
+/*
+	This file is part of libswirl
+
+	AICA DSP recompiler for x86-64
+
+	Compiles the MPRO program to straight line code, one block per step with the fields decoded
+	at compile time. Follows the interpreter (dsp_interp.cpp) to the bit, including the per
+	sample reset of ACC, FRC_REG, Y_REG, ADRS_REG and MEMVAL. COEF and MADRS are read when the
+	code runs, so only MPRO, RBL and RBP changes need a recompile (dyndirty).
+*/
+#include "license/bsd"
+
+
+#include "build.h"
+
+#if HOST_CPU == CPU_X64 && FEAT_DSPREC == DYNAREC_JIT
+
+#if HOST_OS == OS_WINDOWS
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include <memory>
+#include "deps/xbyak/xbyak.h"
+
+#include "dsp_backend.h"
+#include "aica_mem.h"
+
+#define DSP_OFS(field) ((u32)offsetof(dsp_context_t, field))
+#define DSPDATA_OFS(field) ((u32)offsetof(DSPData_struct, field))
+
+class DSPAssemblerX64 : public Xbyak::CodeGenerator
+{
+public:
+	DSPAssemblerX64(u8* code_buffer, size_t size) : Xbyak::CodeGenerator(size, code_buffer) { }
+
+	void Compile(u8* aica_ram, u32 aram_mask, dsp_context_t* DSP, DSPData_struct* DSPData)
+	{
+		push(rbx);
+		push(rbp);
+
+		mov(rbx, (uintptr_t)DSP);
+		mov(rbp, (uintptr_t)DSPData);
+
+		//memset(DSPData->EFREG, 0, sizeof(DSPData->EFREG));
+		xorps(xmm0, xmm0);
+		for (u32 i = 0; i < sizeof(DSPData->EFREG); i += 16)
+			movups(ptr[rbp + DSPDATA_OFS(EFREG) + i], xmm0);
+
+		if (DSP->Stopped)
+		{
+			pop(rbp);
+			pop(rbx);
+			ret();
+			ready();
+			return;
+		}
+
+		// the rest only holds values within a step, except MDEC_CT
+		push(rsi);
+		push(rdi);
+		push(r12);
+		push(r13);
+		push(r14);
+		push(r15);
+
+		const Xbyak::Reg32& MDEC_CT = edi;
+		const Xbyak::Reg32& ACC = r12d;			// 26 bits
+		const Xbyak::Reg32& FRC_REG = r13d;		// 13 bits
+		const Xbyak::Reg32& Y_REG = r14d;		// 24 bits
+		const Xbyak::Reg32& ADRS_REG = r15d;	// 13 bits unsigned
+		const Xbyak::Reg32& INPUTS = esi;		// 24 bits
+		const Xbyak::Reg32& SHIFTED = r8d;		// 24 bits
+		const Xbyak::Reg32& X = r9d;			// 24 bits
+		const Xbyak::Reg32& Y = r10d;			// 13 bits
+		const Xbyak::Reg32& B = r11d;			// 26 bits
+
+		xor_(ACC, ACC);
+		xor_(FRC_REG, FRC_REG);
+		xor_(Y_REG, Y_REG);
+		xor_(ADRS_REG, ADRS_REG);
+		movups(ptr[rbx + DSP_OFS(MEMVAL)], xmm0);
+		mov(MDEC_CT, dword[rbx + DSP_OFS(regs.MDEC_CT)]);
+
+		// nothing after the last used step has a visible effect, ACC is reset every sample
+		int steps = 128;
+		while (steps > 0 && IsNop(&DSPData->MPRO[(steps - 1) * 4]))
+			steps--;
+
+		Xbyak::Label pack, unpack;
+
+		for (int step = 0; step < steps; step++)
+		{
+			_INST op;
+			DSPBackend::DecodeInst(&DSPData->MPRO[step * 4], &op);
+
+			bool mem_step = (step & 1) && (op.MRD || op.MWT);
+
+			if (op.XSEL || op.YRL || (op.ADRL && op.SHIFT != 3))
+			{
+				verify(op.IRA < 0x38);
+
+				if (op.IRA <= 0x1f)
+				{
+					//INPUTS = DSP->MEMS[op.IRA];
+					mov(INPUTS, dword[rbx + DSP_OFS(MEMS) + op.IRA * 4]);
+					SignExtend(INPUTS, 24);
+				}
+				else if (op.IRA <= 0x2F)
+				{
+					//INPUTS = DSP->MIXS[op.IRA - 0x20] << 4;		// MIXS is 20 bit
+					mov(INPUTS, dword[rbx + DSP_OFS(MIXS) + (op.IRA - 0x20) * 4]);
+					shl(INPUTS, 4);
+					SignExtend(INPUTS, 24);
+				}
+				else if (op.IRA <= 0x31)
+				{
+					//INPUTS = DSPData->EXTS[op.IRA - 0x30] << 8;	// EXTS is 16 bits
+					mov(INPUTS, dword[rbp + DSPDATA_OFS(EXTS) + (op.IRA - 0x30) * 4]);
+					shl(INPUTS, 8);
+					SignExtend(INPUTS, 24);
+				}
+				else
+					xor_(INPUTS, INPUTS);
+			}
+
+			if (op.IWT)
+			{
+				//DSP->MEMS[op.IWA] = MEMVAL[step & 3];	// MEMVAL was selected in previous MRD
+				mov(eax, dword[rbx + DSP_OFS(MEMVAL) + (step & 3) * 4]);
+				mov(dword[rbx + DSP_OFS(MEMS) + op.IWA * 4], eax);
+			}
+
+			// B
+			if (!op.ZERO)
+			{
+				if (op.BSEL)
+					mov(B, ACC);
+				else
+					LoadTemp(B, op.TRA);
+
+				if (op.NEGB)
+					neg(B);
+			}
+
+			// X
+			const Xbyak::Reg32& X_src = op.XSEL ? INPUTS : X;
+			if (!op.XSEL)
+				LoadTemp(X, op.TRA);
+
+			// Y
+			if (op.YSEL == 0)
+				mov(Y, FRC_REG);
+			else if (op.YSEL == 1)
+			{
+				//Y = DSPData->COEF[COEF] >> 3;	//COEF is 16 bits
+				mov(Y, dword[rbp + DSPDATA_OFS(COEF) + step * 4]);
+				shr(Y, 3);
+			}
+			else
+			{
+				//Y = (Y_REG >> 11) & 0x1FFF; or Y = (Y_REG >> 4) & 0x0FFF;
+				mov(Y, Y_REG);
+				sar(Y, op.YSEL == 2 ? 11 : 4);
+				and_(Y, op.YSEL == 2 ? 0x1FFF : 0x0FFF);
+			}
+			SignExtend(Y, 13);
+
+			if (op.YRL)
+				mov(Y_REG, INPUTS);
+
+			// Shifter, from the ACC of the previous step
+			if (op.TWT || op.FRCL || (mem_step && op.MWT) || (op.ADRL && op.SHIFT == 3) || op.EWT)
+			{
+				mov(SHIFTED, ACC);
+				sar(SHIFTED, op.SHIFT == 0 || op.SHIFT == 3 ? 2 : 1);
+
+				if (op.SHIFT <= 1)
+				{
+					// SHIFTED = clamp(SHIFTED, -0x80000, 0x7FFFF)
+					mov(eax, 0x0007FFFF);
+					cmp(SHIFTED, eax);
+					cmovg(SHIFTED, eax);
+					mov(eax, -0x00080000);
+					cmp(SHIFTED, eax);
+					cmovl(SHIFTED, eax);
+				}
+				else
+					SignExtend(SHIFTED, 24);
+			}
+
+			// ACCUM
+			//s64 v = ((s64)X * (s64)Y) >> 10;
+			//ACC = (s32)(v + B), 26 bits
+			movsxd(rax, X_src);
+			movsxd(rcx, Y);
+			imul(rax, rcx);
+			sar(rax, 10);
+			if (!op.ZERO)
+				add(eax, B);
+			SignExtend(eax, 26);
+			mov(ACC, eax);
+
+			if (op.TWT)
+			{
+				//DSP->TEMP[(op.TWA + DSP->regs.MDEC_CT) & 0x7F] = SHIFTED;
+				lea(eax, ptr[MDEC_CT + op.TWA]);
+				and_(eax, 0x7F);
+				mov(dword[rbx + rax * 4 + DSP_OFS(TEMP)], SHIFTED);
+			}
+
+			if (op.FRCL)
+			{
+				//FRC_REG = SHIFTED & 0x0FFF; or FRC_REG = (SHIFTED >> 11) & 0x1FFF;
+				mov(FRC_REG, SHIFTED);
+				if (op.SHIFT == 3)
+					and_(FRC_REG, 0x0FFF);
+				else
+				{
+					sar(FRC_REG, 11);
+					and_(FRC_REG, 0x1FFF);
+				}
+			}
+
+			// memory only on odd steps
+			if (mem_step)
+			{
+				const Xbyak::Reg32& ADDR = r9d;
+
+				CalculateADDR(ADDR, op, DSP, DSPData, aram_mask);
+				mov(r10, (uintptr_t)aica_ram);
+
+				if (op.MRD)
+				{
+					//MEMVAL[(step + 2) & 3] = UNPACK(*(u16*)&aica_ram[ADDR & aram_mask]);
+					movzx(eax, word[r10 + r9]);
+					call(unpack);
+					mov(dword[rbx + DSP_OFS(MEMVAL) + ((step + 2) & 3) * 4], eax);
+				}
+				if (op.MWT)
+				{
+					//*(u16*)&aica_ram[ADDR & aram_mask] = PACK(SHIFTED);
+					mov(eax, SHIFTED);
+					call(pack);
+					mov(word[r10 + r9], ax);
+				}
+			}
+
+			if (op.ADRL)
+			{
+				if (op.SHIFT == 3)
+				{
+					//ADRS_REG = (SHIFTED >> 12) & 0xFFF;
+					mov(ADRS_REG, SHIFTED);
+					sar(ADRS_REG, 12);
+					and_(ADRS_REG, 0xFFF);
+				}
+				else
+				{
+					//ADRS_REG = (INPUTS >> 16);
+					mov(ADRS_REG, INPUTS);
+					sar(ADRS_REG, 16);
+				}
+			}
+
+			if (op.EWT)
+			{
+				//DSPData->EFREG[op.EWA] += SHIFTED >> 4;
+				mov(eax, SHIFTED);
+				sar(eax, 4);
+				add(dword[rbp + DSPDATA_OFS(EFREG) + op.EWA * 4], eax);
+			}
+		}
+
+		//if (--DSP->regs.MDEC_CT == 0) DSP->regs.MDEC_CT = DSP->RBL + 1;
+		Xbyak::Label no_wrap;
+		sub(MDEC_CT, 1);
+		jnz(no_wrap);
+		mov(MDEC_CT, DSP->RBL + 1);
+		L(no_wrap);
+		mov(dword[rbx + DSP_OFS(regs.MDEC_CT)], MDEC_CT);
+
+		pop(r15);
+		pop(r14);
+		pop(r13);
+		pop(r12);
+		pop(rdi);
+		pop(rsi);
+		pop(rbp);
+		pop(rbx);
+		ret();
+
+		// shared by all the steps, a copy in each would not fit in DynCode
+		L(pack);
+		GenPack();
+		ret();
+
+		L(unpack);
+		GenUnpack();
+		ret();
+
+		ready();
+	}
+
+private:
+	static bool IsNop(u32* mpro)
+	{
+		return mpro[0] == 0 && mpro[1] == 0 && mpro[2] == 0 && mpro[3] == 0;
+	}
+
+	void SignExtend(const Xbyak::Reg32& reg, int bits)
+	{
+		shl(reg, 32 - bits);
+		sar(reg, 32 - bits);
+	}
+
+	//reg = sign extended DSP->TEMP[(TRA + DSP->regs.MDEC_CT) & 0x7F]
+	void LoadTemp(const Xbyak::Reg32& reg, u32 TRA)
+	{
+		lea(eax, ptr[edi + TRA]);
+		and_(eax, 0x7F);
+		mov(reg, dword[rbx + rax * 4 + DSP_OFS(TEMP)]);
+		SignExtend(reg, 24);
+	}
+
+	// RBL and RBP are constant for the program
+	void CalculateADDR(const Xbyak::Reg32& ADDR, const _INST& op, dsp_context_t* DSP, DSPData_struct* DSPData, u32 aram_mask)
+	{
+		//u32 ADDR = DSPData->MADRS[op.MASA];
+		mov(ADDR, dword[rbp + DSPDATA_OFS(MADRS) + op.MASA * 4]);
+		if (op.ADREB)
+		{
+			//ADDR += ADRS_REG & 0x0FFF;
+			mov(eax, r15d);
+			and_(eax, 0x0FFF);
+			add(ADDR, eax);
+		}
+		if (op.NXADR)
+			add(ADDR, 1);
+		if (!op.TABLE)
+		{
+			add(ADDR, edi);
+			and_(ADDR, DSP->RBL);
+		}
+		else
+			and_(ADDR, 0xFFFF);
+
+		//ADDR <<= 1; ADDR += DSP->RBP;
+		shl(ADDR, 1);
+		add(ADDR, DSP->RBP);
+		and_(ADDR, aram_mask);
+	}
+
+	// DSPBackend::PACK, eax in and out, uses ecx and edx
+	void GenPack()
+	{
+		Xbyak::Label exponent_12, packed;
+
+		//sign = (val >> 23) & 0x1;
+		mov(edx, eax);
+		shr(edx, 23);
+		and_(edx, 1);
+
+		//exponent = leading zeros of (val ^ (val << 1)) & 0xFFFFFF, at most 12
+		lea(ecx, ptr[eax + eax]);
+		xor_(ecx, eax);
+		and_(ecx, 0xFFFFFF);
+		or_(ecx, 0x800);
+		bsr(ecx, ecx);
+		neg(ecx);
+		add(ecx, 23);
+
+		cmp(ecx, 12);
+		jae(exponent_12);
+		//val = (val << exponent) & 0x3FFFFF;
+		shl(eax, cl);
+		and_(eax, 0x3FFFFF);
+		jmp(packed);
+		L(exponent_12);
+		//val <<= 11;
+		shl(eax, 11);
+		L(packed);
+
+		//val >>= 11; val |= sign << 15; val |= exponent << 11;
+		sar(eax, 11);
+		shl(edx, 15);
+		or_(eax, edx);
+		shl(ecx, 11);
+		or_(eax, ecx);
+		movzx(eax, ax);
+	}
+
+	// DSPBackend::UNPACK, eax in and out, uses ecx, edx and r11
+	void GenUnpack()
+	{
+		Xbyak::Label exponent_11, unpacked;
+
+		//sign = (val >> 15) & 0x1;
+		mov(edx, eax);
+		shr(edx, 15);
+		//exponent = (val >> 11) & 0xF;
+		mov(ecx, eax);
+		shr(ecx, 11);
+		and_(ecx, 0xF);
+		//uval = mantissa << 11;
+		and_(eax, 0x7FF);
+		shl(eax, 11);
+
+		cmp(ecx, 11);
+		ja(exponent_11);
+		//uval |= (sign ^ 1) << 22;
+		mov(r11d, edx);
+		xor_(r11d, 1);
+		shl(r11d, 22);
+		or_(eax, r11d);
+		jmp(unpacked);
+		L(exponent_11);
+		mov(ecx, 11);
+		L(unpacked);
+
+		//uval |= sign << 23;
+		shl(edx, 23);
+		or_(eax, edx);
+
+		SignExtend(eax, 24);
+		sar(eax, cl);
+	}
+};
+
+struct DSPJitX64 : DSPBackend {
+	u8* aica_ram;
+	u32 aram_size;
+	DSPData_struct* DSPData;
+	dsp_context_t* dsp;
+
+	// for the programs that don't fit in DynCode
+	unique_ptr<DSPBackend> interpreter;
+	bool interpreted;
+
+	DSPJitX64(DSPData_struct* DSPData, dsp_context_t* dsp, u8* aica_ram, u32 aram_size)
+		: DSPData(DSPData), dsp(dsp), aica_ram(aica_ram), aram_size(aram_size), interpreted(false) {
+#if HOST_OS == OS_WINDOWS
+		DWORD old;
+		VirtualProtect(dsp->DynCode, sizeof(dsp->DynCode), PAGE_EXECUTE_READWRITE, &old);
+#else
+		if (mprotect(dsp->DynCode, sizeof(dsp->DynCode), PROT_EXEC | PROT_READ | PROT_WRITE))
+		{
+			perror("Couldn't mprotect DSP code");
+			die("mprotect failed in x64 dsp");
+		}
+#endif
+	}
+
+	void Recompile()
+	{
+		dsp->Stopped = true;
+		for (int i = 127; i >= 0; --i)
+		{
+			u32* IPtr = DSPData->MPRO + i * 4;
+
+			if (IPtr[0] != 0 || IPtr[1] != 0 || IPtr[2] != 0 || IPtr[3] != 0)
+			{
+				dsp->Stopped = false;
+				break;
+			}
+		}
+
+		try
+		{
+			DSPAssemblerX64 assembler(&dsp->DynCode[0], sizeof(dsp->DynCode));
+			assembler.Compile(aica_ram, aram_size - 1, dsp, DSPData);
+			interpreted = false;
+		}
+		catch (const Xbyak::Error& e)
+		{
+			if (!interpreter)
+				interpreter.reset(DSPBackend::CreateInterpreter(DSPData, dsp, aica_ram, aram_size));
+
+			printf("DSP: %s, interpreting this program\n", e.what());
+			interpreted = true;
+		}
+	}
+
+	void Step()
+	{
+		if (interpreted)
+			interpreter->Step();
+		else
+			((void (*)())&dsp->DynCode[0])();
+	}
+};
+
+DSPBackend* DSPBackend::CreateJIT(DSPData_struct* DSPData, dsp_context_t* dsp, u8* aica_ram, u32 aram_size) {
+	return new DSPJitX64(DSPData, dsp, aica_ram, aram_size);
+}
+#endif
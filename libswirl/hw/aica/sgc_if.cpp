@@ -12,6 +12,8 @@
 #include <math.h>
 #include <algorithm>
 #include "serialize.h"
+#include "benchmark.h"
+#include "oslib/oslib.h"
 
 using namespace std;
 #undef FAR
@@ -422,8 +424,7 @@ struct ChannelEx
 			//*Att is up to 511
 			//logtable handles up to 1024, anything >=255 is mute
 
-			u32 ofsatt=lfo.alfo+(AEG.GetValue()>>2);
-			ofsatt = min(ofsatt, (u32)255); // make sure it never gets more 255 -- it can happen with some alfo/aeg combinations
+			u32 ofsatt=AttOffset();
 			u32 const max_att = ((16 << 4) - 1) - ofsatt;
 			
 			s32* logtable = ofsatt + tl_lut;
@@ -443,14 +444,42 @@ struct ChannelEx
 			clip_verify(sample*oRight>=0);
 			clip_verify(sample*oDsp>=0);
 
-			StepAEG(this);
-			StepFEG(this);
-			StepStream(this);
-			lfo.Step(this);
+			Advance();
 			return true;
 		}
 	}
 
+	__forceinline u32 AttOffset()
+	{
+		u32 ofsatt=lfo.alfo+(AEG.GetValue()>>2);
+		return min(ofsatt, (u32)255); // make sure it never gets more 255 -- it can happen with some alfo/aeg combinations
+	}
+
+	__forceinline void Advance()
+	{
+		StepAEG(this);
+		StepFEG(this);
+		StepStream(this);
+		lfo.Step(this);
+	}
+
+	//Steps up to count samples, keeping what Step mixes from in the arrays. Returns how many, less when the channel turns off
+	u32 Record(u32 count, s32* s0s, s32* s1s, s32* fps, s32* atts)
+	{
+		u32 i;
+		for (i = 0; i < count && enabled; i++)
+		{
+			s0s[i] = s0;
+			s1s[i] = s1;
+			fps[i] = step.fp;
+			atts[i] = AttOffset();
+
+			Advance();
+		}
+
+		return i;
+	}
+
 	__forceinline void Step(SampleType& mixl, SampleType& mixr)
 	{
 		SampleType oLeft,oRight,oDsp;
@@ -1028,6 +1057,206 @@ void FegStep(ChannelEx* ch)
 
 }
 
+/*
+	Mix kernels of MixChannels32, for the samples of one channel kept by ChannelEx::Record. Each does
+	the interpolation, the three attenuations and the dsp fallback of ChannelEx::Step with the same
+	integer math, lanes wrap like the scalar code, so the output is the same to the bit.
+	tests/aica-mixer checks them against StepChannels32.
+*/
+typedef void MixBlockFn(const s32* s0s, const s32* s1s, const s32* fps, const s32* atts, u32 count,
+	s32 dl, s32 dr, s32 ds, s32* mixl, s32* mixr);
+
+static void MixBlock_scalar(const s32* s0s, const s32* s1s, const s32* fps, const s32* atts, u32 count,
+	s32 dl, s32 dr, s32 ds, s32* mixl, s32* mixr)
+{
+	for (u32 i = 0; i < count; i++)
+	{
+		s32 sample = FPMul(s0s[i], (1024 - fps[i]), 10) + FPMul(s1s[i], fps[i], 10);
+
+		//ofsatt + min(att, 255 - ofsatt) in Step
+		s32 oLeft = FPMul(sample, tl_lut[min(atts[i] + dl, 255)], 15);
+		s32 oRight = FPMul(sample, tl_lut[min(atts[i] + dr, 255)], 15);
+		s32 oDsp = FPMul(sample, tl_lut[min(atts[i] + ds, 255)], 15);
+
+		bool to_dsp = (oLeft + oRight) == 0;
+
+		mixl[i] += to_dsp ? oDsp : oLeft;
+		mixr[i] += to_dsp ? oDsp : oRight;
+	}
+}
+
+#if (HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64) && BUILD_COMPILER != COMPILER_VC
+#include <immintrin.h>
+#define AICA_MIX_X86 1
+
+// no gathers before avx2
+__attribute__((target("sse4.1")))
+static __m128i tl_gather_sse41(__m128i idx)
+{
+	return _mm_setr_epi32(tl_lut[_mm_cvtsi128_si32(idx)], tl_lut[_mm_extract_epi32(idx, 1)],
+		tl_lut[_mm_extract_epi32(idx, 2)], tl_lut[_mm_extract_epi32(idx, 3)]);
+}
+
+__attribute__((target("sse4.1")))
+static void MixBlock_sse41(const s32* s0s, const s32* s1s, const s32* fps, const s32* atts, u32 count,
+	s32 dl, s32 dr, s32 ds, s32* mixl, s32* mixr)
+{
+	const __m128i one = _mm_set1_epi32(1024);
+	const __m128i max_att = _mm_set1_epi32(255);
+	const __m128i vdl = _mm_set1_epi32(dl), vdr = _mm_set1_epi32(dr), vds = _mm_set1_epi32(ds);
+
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i fp = _mm_loadu_si128((const __m128i*)&fps[i]);
+		__m128i s0 = _mm_srai_epi32(_mm_mullo_epi32(_mm_loadu_si128((const __m128i*)&s0s[i]), _mm_sub_epi32(one, fp)), 10);
+		__m128i s1 = _mm_srai_epi32(_mm_mullo_epi32(_mm_loadu_si128((const __m128i*)&s1s[i]), fp), 10);
+		__m128i sample = _mm_add_epi32(s0, s1);
+
+		__m128i att = _mm_loadu_si128((const __m128i*)&atts[i]);
+		__m128i vl = tl_gather_sse41(_mm_min_epi32(_mm_add_epi32(att, vdl), max_att));
+		__m128i vr = tl_gather_sse41(_mm_min_epi32(_mm_add_epi32(att, vdr), max_att));
+		__m128i vs = tl_gather_sse41(_mm_min_epi32(_mm_add_epi32(att, vds), max_att));
+
+		__m128i oLeft = _mm_srai_epi32(_mm_mullo_epi32(sample, vl), 15);
+		__m128i oRight = _mm_srai_epi32(_mm_mullo_epi32(sample, vr), 15);
+		__m128i oDsp = _mm_srai_epi32(_mm_mullo_epi32(sample, vs), 15);
+
+		__m128i to_dsp = _mm_cmpeq_epi32(_mm_add_epi32(oLeft, oRight), _mm_setzero_si128());
+
+		__m128i ml = _mm_loadu_si128((const __m128i*)&mixl[i]);
+		__m128i mr = _mm_loadu_si128((const __m128i*)&mixr[i]);
+		_mm_storeu_si128((__m128i*)&mixl[i], _mm_add_epi32(ml, _mm_blendv_epi8(oLeft, oDsp, to_dsp)));
+		_mm_storeu_si128((__m128i*)&mixr[i], _mm_add_epi32(mr, _mm_blendv_epi8(oRight, oDsp, to_dsp)));
+	}
+
+	MixBlock_scalar(s0s + i, s1s + i, fps + i, atts + i, count - i, dl, dr, ds, mixl + i, mixr + i);
+}
+
+__attribute__((target("avx2")))
+static void MixBlock_avx2(const s32* s0s, const s32* s1s, const s32* fps, const s32* atts, u32 count,
+	s32 dl, s32 dr, s32 ds, s32* mixl, s32* mixr)
+{
+	const __m256i one = _mm256_set1_epi32(1024);
+	const __m256i max_att = _mm256_set1_epi32(255);
+	const __m256i vdl = _mm256_set1_epi32(dl), vdr = _mm256_set1_epi32(dr), vds = _mm256_set1_epi32(ds);
+
+	u32 i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i fp = _mm256_loadu_si256((const __m256i*)&fps[i]);
+		__m256i s0 = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)&s0s[i]), _mm256_sub_epi32(one, fp)), 10);
+		__m256i s1 = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)&s1s[i]), fp), 10);
+		__m256i sample = _mm256_add_epi32(s0, s1);
+
+		__m256i att = _mm256_loadu_si256((const __m256i*)&atts[i]);
+		__m256i vl = _mm256_i32gather_epi32(tl_lut, _mm256_min_epi32(_mm256_add_epi32(att, vdl), max_att), 4);
+		__m256i vr = _mm256_i32gather_epi32(tl_lut, _mm256_min_epi32(_mm256_add_epi32(att, vdr), max_att), 4);
+		__m256i vs = _mm256_i32gather_epi32(tl_lut, _mm256_min_epi32(_mm256_add_epi32(att, vds), max_att), 4);
+
+		__m256i oLeft = _mm256_srai_epi32(_mm256_mullo_epi32(sample, vl), 15);
+		__m256i oRight = _mm256_srai_epi32(_mm256_mullo_epi32(sample, vr), 15);
+		__m256i oDsp = _mm256_srai_epi32(_mm256_mullo_epi32(sample, vs), 15);
+
+		__m256i to_dsp = _mm256_cmpeq_epi32(_mm256_add_epi32(oLeft, oRight), _mm256_setzero_si256());
+
+		__m256i ml = _mm256_loadu_si256((const __m256i*)&mixl[i]);
+		__m256i mr = _mm256_loadu_si256((const __m256i*)&mixr[i]);
+		_mm256_storeu_si256((__m256i*)&mixl[i], _mm256_add_epi32(ml, _mm256_blendv_epi8(oLeft, oDsp, to_dsp)));
+		_mm256_storeu_si256((__m256i*)&mixr[i], _mm256_add_epi32(mr, _mm256_blendv_epi8(oRight, oDsp, to_dsp)));
+	}
+
+	MixBlock_sse41(s0s + i, s1s + i, fps + i, atts + i, count - i, dl, dr, ds, mixl + i, mixr + i);
+}
+#elif HOST_CPU == CPU_ARM64
+#include <arm_neon.h>
+#define AICA_MIX_NEON 1
+
+static inline int32x4_t tl_gather_neon(int32x4_t idx)
+{
+	int32x4_t rv = vdupq_n_s32(tl_lut[vgetq_lane_s32(idx, 0)]);
+	rv = vsetq_lane_s32(tl_lut[vgetq_lane_s32(idx, 1)], rv, 1);
+	rv = vsetq_lane_s32(tl_lut[vgetq_lane_s32(idx, 2)], rv, 2);
+	return vsetq_lane_s32(tl_lut[vgetq_lane_s32(idx, 3)], rv, 3);
+}
+
+static void MixBlock_neon(const s32* s0s, const s32* s1s, const s32* fps, const s32* atts, u32 count,
+	s32 dl, s32 dr, s32 ds, s32* mixl, s32* mixr)
+{
+	const int32x4_t one = vdupq_n_s32(1024);
+	const int32x4_t max_att = vdupq_n_s32(255);
+	const int32x4_t vdl = vdupq_n_s32(dl), vdr = vdupq_n_s32(dr), vds = vdupq_n_s32(ds);
+
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		int32x4_t fp = vld1q_s32(&fps[i]);
+		int32x4_t s0 = vshrq_n_s32(vmulq_s32(vld1q_s32(&s0s[i]), vsubq_s32(one, fp)), 10);
+		int32x4_t s1 = vshrq_n_s32(vmulq_s32(vld1q_s32(&s1s[i]), fp), 10);
+		int32x4_t sample = vaddq_s32(s0, s1);
+
+		int32x4_t att = vld1q_s32(&atts[i]);
+		int32x4_t vl = tl_gather_neon(vminq_s32(vaddq_s32(att, vdl), max_att));
+		int32x4_t vr = tl_gather_neon(vminq_s32(vaddq_s32(att, vdr), max_att));
+		int32x4_t vs = tl_gather_neon(vminq_s32(vaddq_s32(att, vds), max_att));
+
+		int32x4_t oLeft = vshrq_n_s32(vmulq_s32(sample, vl), 15);
+		int32x4_t oRight = vshrq_n_s32(vmulq_s32(sample, vr), 15);
+		int32x4_t oDsp = vshrq_n_s32(vmulq_s32(sample, vs), 15);
+
+		uint32x4_t to_dsp = vceqq_s32(vaddq_s32(oLeft, oRight), vdupq_n_s32(0));
+
+		vst1q_s32(&mixl[i], vaddq_s32(vld1q_s32(&mixl[i]), vbslq_s32(to_dsp, oDsp, oLeft)));
+		vst1q_s32(&mixr[i], vaddq_s32(vld1q_s32(&mixr[i]), vbslq_s32(to_dsp, oDsp, oRight)));
+	}
+
+	MixBlock_scalar(s0s + i, s1s + i, fps + i, atts + i, count - i, dl, dr, ds, mixl + i, mixr + i);
+}
+#endif
+
+AicaMixKernel aica_mix_kernel = AMK_Scalar;
+
+static MixBlockFn* const MixBlock_LUT[AMK_Count] =
+{
+	&MixBlock_scalar,
+#ifdef AICA_MIX_X86
+	&MixBlock_sse41,
+	&MixBlock_avx2,
+#else
+	NULL,
+	NULL,
+#endif
+#ifdef AICA_MIX_NEON
+	&MixBlock_neon,
+#else
+	NULL,
+#endif
+};
+
+bool aica_mix_kernel_supported(AicaMixKernel kernel)
+{
+	if (kernel < 0 || kernel >= AMK_Count || MixBlock_LUT[kernel] == NULL)
+		return false;
+
+#ifdef AICA_MIX_X86
+	__builtin_cpu_init();
+
+	if (kernel == AMK_SSE41)
+		return __builtin_cpu_supports("sse4.1");
+	if (kernel == AMK_AVX2)
+		return __builtin_cpu_supports("avx2");
+#endif
+
+	return true;
+}
+
+const char* aica_mix_kernel_name(AicaMixKernel kernel)
+{
+	static const char* names[AMK_Count] = { "scalar", "sse4.1", "avx2", "neon" };
+
+	return kernel >= 0 && kernel < AMK_Count ? names[kernel] : "?";
+}
+
 struct SGC_impl : SGC {
 	DSP_OUT_VOL_REG* dsp_out_vol;
 	CommonData_struct* CommonData;
@@ -1085,6 +1314,14 @@ struct SGC_impl : SGC {
 		PLFOWS_CALC[1] = &CalcPlfo<1>;
 		PLFOWS_CALC[2] = &CalcPlfo<2>;
 		PLFOWS_CALC[3] = &CalcPlfo<3>;
+
+		// the widest mix kernel the host runs
+		aica_mix_kernel = AMK_Scalar;
+		for (int k = AMK_Scalar + 1; k < AMK_Count; k++)
+		{
+			if (aica_mix_kernel_supported((AicaMixKernel)k))
+				aica_mix_kernel = (AicaMixKernel)k;
+		}
 	}
 
 	ChannelEx Chans[64];
@@ -1144,6 +1381,10 @@ struct SGC_impl : SGC {
 			AEG_ATT_SPS[i] = CalcAegSteps(AEG_Attack_Time[i]);
 			AEG_DSR_SPS[i] = CalcAegSteps(AEG_DSR_Time[i]);
 		}
+		// zeroed, the state RegWrite and KEY_ON don't set (noise, lfo) doesn't depend on the heap
+		for (int i = 0; i < 64; i++)
+			Chans[i] = ChannelEx();
+
 		for (int i = 0; i < 64; i++)
 			Chans[i].Setup(i, aica_reg, aica_ram, Chans, dsp);
 
@@ -1213,14 +1454,8 @@ struct SGC_impl : SGC {
 
 	u32 samples_gen;
 
-	//no DSP for now in this version
-	void AICA_Sample32()
+	void StepChannels32()
 	{
-		if (settings.aica.NoBatch)
-		{
-			return;
-		}
-
 		memset(mxlr, 0, sizeof(mxlr));
 
 		//Generate 32 samples for each channel, before moving to next channel
@@ -1249,6 +1484,58 @@ struct SGC_impl : SGC {
 #if HOST_OS==OS_WINDOWS
 		samples_gen += sg;
 #endif
+	}
+
+	/*
+		Same mix as StepChannels32, in two passes per channel. The first steps the envelopes, lfo and
+		stream through the function pointers and keeps the state each sample is mixed from, the
+		second does the interpolation and volume for all the samples with the aica_mix_kernel
+		kernel (sse4.1, avx2 or neon).
+	*/
+	void MixChannels32()
+	{
+		MixBlockFn* mix_block = MixBlock_LUT[aica_mix_kernel];
+
+		alignas(32) s32 s0s[32], s1s[32], fps[32], atts[32];
+		alignas(32) s32 mixl[32] = { 0 }, mixr[32] = { 0 };
+
+		u32 sg = 0;
+		for (int ch = 0; ch < 64; ch++)
+		{
+			ChannelEx& chan = Chans[ch];
+
+			if (!chan.enabled)
+				continue;
+
+			u32 count = chan.Record(32, s0s, s1s, fps, atts);
+
+			sg += count;
+
+			mix_block(s0s, s1s, fps, atts, count, chan.VolMix.DLAtt, chan.VolMix.DRAtt, chan.VolMix.DSPAtt, mixl, mixr);
+		}
+#if HOST_OS==OS_WINDOWS
+		samples_gen += sg;
+#endif
+		for (int i = 0; i < 32; i++)
+		{
+			mxlr[i * 2 + 0] = mixl[i];
+			mxlr[i * 2 + 1] = mixr[i];
+		}
+	}
+
+	//no DSP for now in this version
+	void AICA_Sample32()
+	{
+		if (settings.aica.NoBatch)
+		{
+			return;
+		}
+
+		if (settings.aica.VectorMixer)
+			MixChannels32();
+		else
+			StepChannels32();
+
 		//OK , generated all Channels  , now DSP/ect + final mix ;p
 		//CDDA EXTS input
 
@@ -1375,7 +1662,14 @@ struct SGC_impl : SGC {
 		}
 		//if (settings.aica.DSPEnabled)
 		{
-			libDSP_Step();
+			if (unlikely(bench_active))
+			{
+				double start = os_GetSeconds();
+				libDSP_Step();
+				bench_times.dsp += os_GetSeconds() - start;
+			}
+			else
+				libDSP_Step();
 
 			for (int i = 0; i < 16; i++)
 			{
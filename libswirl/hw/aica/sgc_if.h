@@ -55,6 +55,21 @@ struct DSP_OUT_VOL_REG
 //#define SAMPLE_TYPE_SHIFT (8)
 typedef s32 SampleType;
 
+// Kernels of the batched vector mixer (settings.aica.VectorMixer). SGC::Create picks the widest one
+// the host supports, tests/aica-mixer switches between them
+enum AicaMixKernel
+{
+	AMK_Scalar,
+	AMK_SSE41,
+	AMK_AVX2,
+	AMK_NEON,
+	AMK_Count
+};
+
+extern AicaMixKernel aica_mix_kernel;
+bool aica_mix_kernel_supported(AicaMixKernel kernel);
+const char* aica_mix_kernel_name(AicaMixKernel kernel);
+
 #define clip(x,min,max) if ((x)<(min)) (x)=(min); if ((x)>(max)) (x)=(max);
 #define clip16(x) clip(x,-32768,32767)
 
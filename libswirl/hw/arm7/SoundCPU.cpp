@@ -14,6 +14,8 @@
 
 #include <memory>
 
+Arm7JitStats arm7_jit_stats;
+
 #define REG_L (0x2D00)
 #define REG_M (0x2D04)
 
@@ -121,7 +123,13 @@ static void DYNACALL scpu_WriteMemArm(u32 addr, T data, Arm7Context* ctx)
 	addr &= 0x00FFFFFF;
 	if (addr < 0x800000)
 	{
-		*(T*)&ctx->aica_ram[addr & (ctx->aram_mask - (sz - 1))] = data;
+		u32 offset = addr & (ctx->aram_mask - (sz - 1));
+		*(T*)&ctx->aica_ram[offset] = data;
+
+		// stores to code the jit compiled, a line never crosses a page
+		u32 line = offset >> ARM7_CODE_LINE_SHIFT;
+		if (ctx->code_lines != nullptr && (ctx->code_lines[line >> 3] & (1 << (line & 7))))
+			ctx->backend->InvalidateJitPages(offset, sz);
 	}
 	else
 	{
@@ -245,6 +253,10 @@ struct SoundCPU_impl : SoundCPU {
 		arm->InvalidateJitCache();
 	}
 
+	void InvalidateJitPages(u32 addr, u32 size) {
+		arm->InvalidateJitPages(addr, size);
+	}
+
 	void serialize(void** data, unsigned int* total_size)
 	{
 		REICAST_S(ctx.aica_interr);
@@ -22,6 +22,8 @@ struct SoundCPU : MMIODevice {
 	virtual void Update(u32 cycles) = 0;
 	virtual void InterruptChange(u32 bits, u32 L) = 0;
 	virtual void InvalidateJitCache() = 0;
+	// Sound ram was written from the sh4 side, drops the blocks compiled from those pages
+	virtual void InvalidateJitPages(u32 addr, u32 size) = 0;
 
 	virtual ~SoundCPU() { }
 
@@ -24,6 +24,8 @@ struct ARM7Backend {
     virtual void Run(u32 uNumCycles) = 0;
     virtual void UpdateInterrupts() = 0;
     virtual void InvalidateJitCache() = 0;
+    // Drops the blocks compiled from the pages of [addr, addr + size) of sound ram, if blocks were compiled from the range
+    virtual void InvalidateJitPages(u32 addr, u32 size) = 0;
     virtual void* GetEntrypointBase() = 0;
 
     virtual ~ARM7Backend() { }
@@ -32,6 +34,18 @@ struct ARM7Backend {
     static ARM7Backend* CreateJit(Arm7Context* ctx);
 };
 
+// Totals since start, for the benchmark report
+struct Arm7JitStats
+{
+    u64 blocks;         // compiled
+    u64 linked;         // of those, the ones that jump straight to the next block
+    u64 pages;          // entry table pages dropped, after a store to their code or a restore
+    u64 unlinked;       // links to the blocks of those pages undone
+    u64 flushes;        // whole cache drops
+};
+
+extern Arm7JitStats arm7_jit_stats;
+
 void libARM_SetResetState(bool Reset);
 void libARM_InterruptChange(u32 bits, u32 L);
 
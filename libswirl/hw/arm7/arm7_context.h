@@ -7,6 +7,11 @@
 #pragma once
 #include "types.h"
 
+// The jit entry table has a page per 4 KB of sound ram, stores are checked against 64 byte lines
+#define ARM7_ENTRY_PAGE_SHIFT 12
+#define ARM7_ENTRY_PAGE_SLOTS (1 << (ARM7_ENTRY_PAGE_SHIFT - 2))
+#define ARM7_CODE_LINE_SHIFT 6
+
 enum
 {
 	RN_CPSR = 16,
@@ -99,6 +104,9 @@ struct Arm7Context
 	u8* aica_ram;
 	u32 aram_mask;
 
+	// Set by the jit, a bit per line of sound ram that blocks were compiled from
+	u8* code_lines = nullptr;
+
 	bool armIrqEnable;
 	bool armFiqEnable;
 	//bool armState;
@@ -36,6 +36,10 @@ struct Arm7Interpreter_impl : ARM7Backend {
 
 	}
 
+	void InvalidateJitPages(u32 addr, u32 size) {
+
+	}
+
 	void* GetEntrypointBase() {
 		return nullptr;
 	}
@@ -152,7 +152,25 @@ struct Arm7JitVirt_impl : ARM7Backend {
     Arm7Context* ctx;
     Looppoints lps;
 
-    void* EntryPoints[ARAM_SIZE_MAX / 4];
+    //EntryPages[pc >> 12][(pc >> 2) & 1023], a page is allocated the first time a block is
+    //compiled in it. Until then it points to EmptyPage, which is all compilecode
+    void** EntryPages[ARAM_SIZE_MAX >> ARM7_ENTRY_PAGE_SHIFT];
+    void* EmptyPage[ARM7_ENTRY_PAGE_SLOTS];
+
+    enum { PAGE_CODE = 1, PAGE_SPILL = 2 };     //SPILL: blocks of the page before run into this one
+    u8 PageFlags[ARAM_SIZE_MAX >> ARM7_ENTRY_PAGE_SHIFT];
+    u8 CodeLines[ARAM_SIZE_MAX >> (ARM7_CODE_LINE_SHIFT + 3)];
+
+    //The jumps of linked blocks, kept with the page of the block they go to. They point to it
+    //while it's compiled and back to the dispatcher when its page is dropped. Jumps of blocks
+    //that were dropped themselves stay listed until the next flush, their code isn't reused before
+    struct LinkSite
+    {
+        void* site;
+        u32 pc;
+        bool direct;    //goes to the block, not the dispatcher
+    };
+    vector<LinkSite> Links[ARAM_SIZE_MAX >> ARM7_ENTRY_PAGE_SHIFT];
 
     vector<ArmDPOP> ops;
 
@@ -162,10 +180,30 @@ struct Arm7JitVirt_impl : ARM7Backend {
 
         armv->GenerateLooppoints(&lps);
 
+        for (u32 i = 0; i < ARRAY_SIZE(EmptyPage); i++)
+            EmptyPage[i] = lps.compilecode;
+
+        for (u32 i = 0; i < ARRAY_SIZE(EntryPages); i++)
+            EntryPages[i] = EmptyPage;
+
+        ctx->code_lines = CodeLines;
+
         InvalidateJitCache();
         armt_init();
     }
 
+    ~Arm7JitVirt_impl() {
+        //the backend that replaces this one is created first
+        if (ctx->code_lines == CodeLines)
+            ctx->code_lines = nullptr;
+
+        for (u32 i = 0; i < ARRAY_SIZE(EntryPages); i++)
+        {
+            if (EntryPages[i] != EmptyPage)
+                free(EntryPages[i]);
+        }
+    }
+
     void UpdateInterrupts()
     {
         ARM7Backend::UpdateInterrupts(ctx);
@@ -789,9 +827,14 @@ struct Arm7JitVirt_impl : ARM7Backend {
         void* rv = armv->armGetEmitPtr();
 
         //update the block table
-        verify(EntryPoints[(armNextPC & ctx->aram_mask) / 4] == lps.compilecode);
+        void** entry = EntrySlot(armNextPC);
+        verify(*entry == lps.compilecode);
+
+        *entry = rv;
 
-        EntryPoints[(armNextPC & ctx->aram_mask) / 4] = rv;
+        //set for blocks that end in a static jump, they go straight to the next block
+        bool linked = false;
+        u32 link_pc = 0;
 
         //the ops counter is used to terminate the block (max op count for a single block is 32 currently)
         //We don't want too long blocks for timing accuracy
@@ -806,6 +849,8 @@ struct Arm7JitVirt_impl : ARM7Backend {
             //Read opcode ...
             u32 opcd = CPUReadMemoryQuick(pc);
 
+            MarkCode(pc);
+
 #if HOST_CPU==CPU_X86
             //Sanity check: Stale cache
             armv->check_cache(opcd, pc);
@@ -894,6 +939,9 @@ struct Arm7JitVirt_impl : ARM7Backend {
                         armv->imm_to_reg(14, pc + 4);
 
                     armv->imm_to_reg(R15_ARM_NEXT, pc + 8 + offs);
+
+                    linked = true;
+                    link_pc = pc + 8 + offs;
                 }
             }
             break;
@@ -1123,6 +1171,9 @@ struct Arm7JitVirt_impl : ARM7Backend {
                 arm_printf("ARM: %06X: Block split %d\n", pc, ops);
 
                 armv->imm_to_reg(R15_ARM_NEXT, pc + 4);
+
+                linked = true;
+                link_pc = pc + 4;
                 break;
             }
 
@@ -1130,18 +1181,149 @@ struct Arm7JitVirt_impl : ARM7Backend {
             pc += 4;
         }
 
-        armv->end(&lps, (void*)rv, Cycles);
+        u32 first_page = (armNextPC & ctx->aram_mask) >> ARM7_ENTRY_PAGE_SHIFT;
+        u32 last_page = (pc & ctx->aram_mask) >> ARM7_ENTRY_PAGE_SHIFT;
+
+        PageFlags[first_page] |= PAGE_CODE;
+        if (last_page != first_page)
+            PageFlags[last_page] |= PAGE_SPILL;
+
+        arm7_jit_stats.blocks++;
+
+        void* site = armv->end(&lps, (void*)rv, Cycles, linked);
+
+        //the blocks linked to this one so far, then this one's link, it may be to itself
+        Relink(armNextPC, rv);
+
+        if (linked)
+        {
+            link_pc &= ctx->aram_mask;
+
+            void* next = EntryPages[link_pc >> ARM7_ENTRY_PAGE_SHIFT][(link_pc >> 2) & (ARM7_ENTRY_PAGE_SLOTS - 1)];
+            bool direct = next != lps.compilecode;
+            if (direct)
+                armv->relink(site, next);
+
+            Links[link_pc >> ARM7_ENTRY_PAGE_SHIFT].push_back({ site, link_pc, direct });
+
+            arm7_jit_stats.linked++;
+        }
+    }
+
+    //Points the jumps linked to pc at its new block
+    void Relink(u32 pc, void* code)
+    {
+        pc &= ctx->aram_mask;
+
+        for (auto& link : Links[pc >> ARM7_ENTRY_PAGE_SHIFT])
+        {
+            if (link.pc == pc)
+            {
+                armv->relink(link.site, code);
+                link.direct = true;
+            }
+        }
     }
 
+    //The entry of pc, allocates its page if needed
+    void** EntrySlot(u32 pc)
+    {
+        u32 page = (pc & ctx->aram_mask) >> ARM7_ENTRY_PAGE_SHIFT;
 
+        if (EntryPages[page] == EmptyPage)
+        {
+            EntryPages[page] = (void**)malloc(sizeof(EmptyPage));
+            memcpy(EntryPages[page], EmptyPage, sizeof(EmptyPage));
+        }
+
+        return &EntryPages[page][(pc >> 2) & (ARM7_ENTRY_PAGE_SLOTS - 1)];
+    }
+
+    void MarkCode(u32 pc)
+    {
+        u32 line = (pc & ctx->aram_mask) >> ARM7_CODE_LINE_SHIFT;
+
+        CodeLines[line >> 3] |= 1 << (line & 7);
+    }
+
+    //Blocks were compiled from a line of [addr, addr + size)
+    bool HasCode(u32 addr, u32 size)
+    {
+        u32 first = (addr & ctx->aram_mask) >> ARM7_CODE_LINE_SHIFT;
+        u32 last = ((addr + size - 1) & ctx->aram_mask) >> ARM7_CODE_LINE_SHIFT;
+
+        for (u32 line = first; line <= last; line++)
+        {
+            if (CodeLines[line >> 3] & (1 << (line & 7)))
+                return true;
+        }
+
+        return false;
+    }
+
+    //A page that had code likely gets it again, so it's reset rather than freed
+    void ResetPage(u32 page)
+    {
+        if (EntryPages[page] != EmptyPage)
+            memcpy(EntryPages[page], EmptyPage, sizeof(EmptyPage));
+
+        //the blocks linked to the ones dropped go back through the dispatcher
+        for (auto& link : Links[page])
+        {
+            if (link.direct)
+            {
+                armv->relink(link.site, lps.dispatch);
+                link.direct = false;
+                arm7_jit_stats.unlinked++;
+            }
+        }
+
+        PageFlags[page] = 0;
+
+        const u32 bytes = 1 << (ARM7_ENTRY_PAGE_SHIFT - ARM7_CODE_LINE_SHIFT - 3);
+        memset(&CodeLines[page * bytes], 0, bytes);
+    }
+
+    void InvalidateJitPages(u32 addr, u32 size)
+    {
+        //a restored page may only have data in it
+        if (!HasCode(addr, size))
+            return;
+
+        u32 first = (addr & ctx->aram_mask) >> ARM7_ENTRY_PAGE_SHIFT;
+        u32 last = ((addr + size - 1) & ctx->aram_mask) >> ARM7_ENTRY_PAGE_SHIFT;
+
+        for (u32 page = first; page <= last; page++)
+        {
+            u8 flags = PageFlags[page];
+
+            if (flags == 0)
+                continue;
+
+            ResetPage(page);
+            arm7_jit_stats.pages++;
+
+            if ((flags & PAGE_SPILL) && page > 0 && PageFlags[page - 1] != 0)
+            {
+                ResetPage(page - 1);
+                arm7_jit_stats.pages++;
+            }
+        }
+    }
 
     void InvalidateJitCache()
     {
         armv->InvalidateJitCache();
 
         printf("ARM7: Invalidating cache\n");
-        for (u32 i = 0; i < ARRAY_SIZE(EntryPoints); i++)
-            EntryPoints[i] = lps.compilecode;
+        for (u32 i = 0; i < ARRAY_SIZE(EntryPages); i++)
+        {
+            //the code of the links is gone
+            Links[i].clear();
+            ResetPage(i);
+        }
+
+        arm7_jit_stats.flushes++;
     }
 
     void armt_init()
@@ -1150,7 +1332,7 @@ struct Arm7JitVirt_impl : ARM7Backend {
     }
 
     void* GetEntrypointBase() {
-        return EntryPoints;
+        return EntryPages;
     }
 };
 
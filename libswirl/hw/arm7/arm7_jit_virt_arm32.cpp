@@ -147,26 +147,33 @@ struct Arm7VirtBackendArm32 : Arm7VirtBackend {
 #endif
 */
             assembler->Ldrd(r0, r1, MemOperand(r8, 184));
+            u32 ram_bits;
             if ((ctx->aram_mask + 1) == 2 * 1024 * 1024) {
-                assembler->Ubfx(r2, r0, 2, 19);
+                ram_bits = 21;
             }
             else if ((ctx->aram_mask + 1) == 8 * 1024 * 1024) {
-                assembler->Ubfx(r2, r0, 2, 21);
+                ram_bits = 23;
             }
             else {
                 die("Unsupported AICA RAM size");
             }
+            //r2 = entry page, r3 = entry in the page
+            assembler->Ubfx(r2, r0, ARM7_ENTRY_PAGE_SHIFT, ram_bits - ARM7_ENTRY_PAGE_SHIFT);
+            assembler->Ubfx(r3, r0, 2, ARM7_ENTRY_PAGE_SHIFT - 2);
 
             /*
 cmp r1, #0
 bne arm_dofiq
 
-ldr pc, [r4, r2, lsl #2]
+ldr r2, [r4, r2, lsl #2]
+ldr pc, [r2, r3, lsl #2]
 */
             Label arm_dofiq;
             assembler->Cmp(r1, 0);
             assembler->B(ne, &arm_dofiq);
             assembler->Add(r2, r4, Operand(r2, LSL, 2));
+            assembler->Ldr(r2, MemOperand(r2));
+            assembler->Add(r2, r2, Operand(r3, LSL, 2));
             assembler->Ldr(pc, MemOperand(r2));
 
 
@@ -357,7 +364,7 @@ ldr pc, [r4, r2, lsl #2]
     }
 
 
-    void end(Looppoints* lp, void* codestart, u32 cycl)
+    void* end(Looppoints* lp, void* codestart, u32 cycl, bool linked)
     {
         //Normal block end
         //cycle counter rv
@@ -372,8 +379,23 @@ ldr pc, [r4, r2, lsl #2]
         offset = reinterpret_cast<uintptr_t>(lp->dispatch) - assembler->GetBuffer()->GetStartAddress<uintptr_t>();
         Label arm_dispatch_label;
         assembler->BindToOffset(&arm_dispatch_label, offset);
+
+        void* site = NULL;
+        if (linked)
+        {
+            //straight to the next block once relinked, interrupts are taken in the dispatcher
+            assembler->Ldr(r1, arm_reg_operand(INTR_PEND));
+            assembler->Cmp(r1, 0);
+            assembler->B(ne, &arm_dispatch_label);
+        }
+
         assembler->B(&arm_dispatch_label);
 
+        //relink patches this B, the code cache is well within its range. Literal pools go
+        //before an instruction, so it's the last one emitted
+        if (linked)
+            site = assembler->GetCursorAddress<u8*>() - kA32InstructionSizeInBytes;
+
         assembler->FinalizeCode();
         verify(assembler->GetBuffer()->GetCursorOffset() <= assembler->GetBuffer()->GetCapacity());
         armFlushICache(codestart, assembler->GetCursorAddress<void*>());
@@ -396,6 +418,18 @@ ldr pc, [r4, r2, lsl #2]
 #endif
         delete assembler;
         assembler = NULL;
+
+        return site;
+    }
+
+    void relink(void* site, void* target)
+    {
+        u32* b = (u32*)site;
+
+        //B, cond AL, offset from the B + 8 in words
+        verify((*b & 0xFF000000) == 0xEA000000);
+        *b = 0xEA000000 | ((((u8*)target - (u8*)b - 8) >> 2) & 0x00FFFFFF);
+        armFlushICache(b, b + 1);
     }
 
     //Hook cus varm misses this, so x86 needs special code
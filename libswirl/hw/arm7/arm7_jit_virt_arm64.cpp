@@ -112,25 +112,26 @@ struct Arm7JitArm7VirtBackendArm64 : Arm7VirtBackend {
             //"arm_dispatch:							\n\t"
             //"ldp w0, w1, [x28, #184]			\n\t"	// load Next PC, interrupt
             assembler->Ldp(w0, w1, MemOperand(x28, 184));
+            u32 ram_bits;
             if ((ctx->aram_mask + 1) == 2 * 1024 * 1024) {
-                //"ubfx w2, w0, #2, #19				\n\t"	// w2 = pc >> 2. Note: assuming address space == 2 MB (21 bits)
-                assembler->Ubfx(w2, w0, 2, 19);
+                ram_bits = 21;
             }
             else if ((ctx->aram_mask + 1) == 8 * 1024 * 1024) {
-                //"ubfx w2, w0, #2, #21				\n\t"	// w2 = pc >> 2. Note: assuming address space == 8 MB (23 bits)
-                assembler->Ubfx(w2, w0, 2, 21);
+                ram_bits = 23;
             }
             else {
                 die("Unsupported AICA RAM size");
             }
+            //w2 = entry page, w3 = entry in the page
+            assembler->Ubfx(w2, w0, ARM7_ENTRY_PAGE_SHIFT, ram_bits - ARM7_ENTRY_PAGE_SHIFT);
+            assembler->Ubfx(w3, w0, 2, ARM7_ENTRY_PAGE_SHIFT - 2);
 
             Label arm_dofiq;
             //"cbnz w1, arm_dofiq					\n\t"	// if interrupt pending, handle it
             assembler->Cbnz(w1, &arm_dofiq);
-            //"add x2, x26, x2, lsl #3			\n\t"	// x2 = EntryPoints + pc << 1
-            assembler->Add(x2, x26, Operand(x2, LSL, 3));
-            //"ldr x3, [x2]						\n\t"
-            assembler->Ldr(x3, MemOperand(x2));
+            //x2 = EntryPages[page], x3 = x2[entry]
+            assembler->Ldr(x2, MemOperand(x26, x2, LSL, 3));
+            assembler->Ldr(x3, MemOperand(x2, x3, LSL, 3));
             //"br x3								\n"
             assembler->Br(x3);
 
@@ -317,8 +318,10 @@ struct Arm7JitArm7VirtBackendArm64 : Arm7VirtBackend {
         call((void*)&ARM7Backend::singleOp, 1, 1);
     }
 
-    void end(Looppoints* lp, void* codestart, u32 cycl)
+    void* end(Looppoints* lp, void* codestart, u32 cycl, bool linked)
     {
+        void* site = NULL;
+
         //Normal block end
         //cycle counter rv
 
@@ -332,8 +335,21 @@ struct Arm7JitArm7VirtBackendArm64 : Arm7VirtBackend {
         offset = reinterpret_cast<uintptr_t>(lp->dispatch) - assembler->GetBuffer()->GetStartAddress<uintptr_t>();
         Label arm_dispatch_label;
         assembler->BindToOffset(&arm_dispatch_label, offset);
+
+        if (linked)
+        {
+            //straight to the next block once relinked, interrupts are taken in the dispatcher
+            assembler->Ldr(w1, arm_reg_operand(INTR_PEND));
+            assembler->Cbnz(w1, &arm_dispatch_label);
+        }
+
         assembler->B(&arm_dispatch_label);
 
+        //relink patches this B, the code cache is well within its range. Literal pools go
+        //before an instruction, so it's the last one emitted
+        if (linked)
+            site = assembler->GetCursorAddress<u8*>() - kInstructionSize;
+
         assembler->FinalizeCode();
         verify(assembler->GetBuffer()->GetCursorOffset() <= assembler->GetBuffer()->GetCapacity());
         vmem_platform_flush_cache(
@@ -357,6 +373,17 @@ struct Arm7JitArm7VirtBackendArm64 : Arm7VirtBackend {
 #endif
         delete assembler;
         assembler = NULL;
+
+        return site;
+    }
+
+    void relink(void* site, void* target)
+    {
+        Instruction* b = reinterpret_cast<Instruction*>(site);
+
+        verify(b->IsUncondBranchImm());
+        b->SetImmPCOffsetTarget(reinterpret_cast<Instruction*>(target));
+        vmem_platform_flush_cache(b, b + kInstructionSize, b, b + kInstructionSize);
     }
 
     //Hook cus varm misses this, so x86 needs special code
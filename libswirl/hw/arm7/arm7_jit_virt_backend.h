@@ -104,7 +104,12 @@ struct Arm7VirtBackend {
 
     virtual void intpr(u32 opcd) = 0;
 
-    virtual void end(Looppoints* lp, void* codestart, u32 cycles) = 0;
+    //linked: the block ends in a static jump, the next block is only known to the caller. Returns
+    //the jump to patch for it, it goes to the dispatcher until relink points it somewhere else
+    virtual void* end(Looppoints* lp, void* codestart, u32 cycles, bool linked) = 0;
+
+    //points the jump end returned at target, the next block or back to lp->dispatch
+    virtual void relink(void* site, void* target) = 0;
 
     //sanity check: non branch doesn't set pc
     virtual void check_pc(u32 pc) = 0;
@@ -151,7 +151,12 @@ struct Arm7VirtBackendX86 : Arm7VirtBackend {
 
             x86_Label* dofiq = x86e->CreateLabel(false, 8);
             x86e->Emit(op_jne, dofiq);
-            x86e->Emit(op_jmp32, x86_mrm(EAX, arm->GetEntrypointBase()));
+            //edx = entry offset in the page, eax = entry page
+            x86e->Emit(op_mov32, EDX, EAX);
+            x86e->Emit(op_and32, EDX, (ARM7_ENTRY_PAGE_SLOTS - 1) * 4);
+            x86e->Emit(op_shr32, EAX, ARM7_ENTRY_PAGE_SHIFT);
+            x86e->Emit(op_mov32, EAX, x86_mrm(EAX, sib_scale_4, arm->GetEntrypointBase()));
+            x86e->Emit(op_jmp32, x86_mrm(EAX, EDX));
 
 
             x86e->MarkLabel(dofiq);
@@ -367,13 +372,28 @@ struct Arm7VirtBackendX86 : Arm7VirtBackend {
         x86e->Emit(op_call, x86_ptr_imm(&ARM7Backend::singleOp));
     }
 
-    void end(Looppoints* lp, void* codestart, u32 cycles)
+    void* end(Looppoints* lp, void* codestart, u32 cycles, bool linked)
     {
+        void* site = NULL;
+
         //Normal block end
         //Move counter to EAX for return, pop ESI, ret
         x86e->Emit(op_sub32, ESI, cycles);
-        x86e->Emit(op_jns, x86_ptr_imm(lp->dispatch));
-        x86e->Emit(op_jmp, x86_ptr_imm(lp->exit));
+        if (linked)
+        {
+            //straight to the next block once relinked, interrupts are taken in the dispatcher
+            x86e->Emit(op_js, x86_ptr_imm(lp->exit));
+            x86e->Emit(op_cmp32, &arm_reg[INTR_PEND].I, 0);
+            x86e->Emit(op_jne, x86_ptr_imm(lp->dispatch));
+            //always a jmp rel32, relink patches it
+            site = &x86e->x86_buff[x86e->x86_indx];
+            x86e->Emit(op_jmp, x86_ptr_imm(lp->dispatch));
+        }
+        else
+        {
+            x86e->Emit(op_jns, x86_ptr_imm(lp->dispatch));
+            x86e->Emit(op_jmp, x86_ptr_imm(lp->exit));
+        }
 
         //Fluch cache, move counter to EAX, pop, ret
         //this should never happen (triggers a breakpoint on x86)
@@ -397,6 +417,16 @@ struct Arm7VirtBackendX86 : Arm7VirtBackend {
         // reset global
         verify(virtBackend == this);
         virtBackend = nullptr;
+
+        return site;
+    }
+
+    void relink(void* site, void* target)
+    {
+        u8* jmp = (u8*)site;
+
+        verify(jmp[0] == 0xE9);
+        *(u32*)&jmp[1] = (u32)((u8*)target - (jmp + 5));
     }
 
     //sanity check: non branch doesn't set pc
@@ -7,7 +7,7 @@
 
 struct VirtualNetwork_null_impl: VirtualNetwork {
     virtual void GetMacAddress(mac_address* mac) {
-        memset(mac, 0x88, sizeof(mac));
+        memset(mac, 0x88, sizeof(*mac));
     }
 
     virtual void SendEthernetPacket(const void* packet, int len) {
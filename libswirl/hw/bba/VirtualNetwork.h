@@ -23,12 +23,37 @@ struct mac_address
 };
 
 struct VirtualNetwork {
+    virtual ~VirtualNetwork() { }
+
     virtual void GetMacAddress(mac_address* mac) = 0;
 
     virtual void SendEthernetPacket(const void* packet, int len) = 0;
     virtual int RecvEthernetPacket(void* packet, int max_len) = 0;
 
-    VirtualNetwork* CreatePcapNetwork(const char* adapter);
+    // Sends count packets at once, backends that can do better than one at a time override these
+    virtual void SendEthernetPackets(const u8* const* packets, const int* lens, int count) {
+        for (int i = 0; i < count; i++)
+            SendEthernetPacket(packets[i], lens[i]);
+    }
+
+    // Up to count packets, packet i goes to packets + i * max_len. Returns how many were received
+    virtual int RecvEthernetPackets(u8* packets, int* lens, int max_len, int count) {
+        int i;
+
+        for (i = 0; i < count; i++) {
+            lens[i] = RecvEthernetPacket(packets + i * max_len, max_len);
+
+            if (lens[i] <= 0)
+                break;
+        }
 
-    VirtualNetwork* CreateNullNetwork();
-};
\ No newline at end of file
+        return i;
+    }
+
+    static VirtualNetwork* CreatePcapNetwork(const char* adapter);
+
+    static VirtualNetwork* CreateNullNetwork();
+
+    // A port on the in-process / shared memory switch with that name, see VirtualSwitch.cpp
+    static VirtualNetwork* CreateSwitchNetwork(const char* name);
+};
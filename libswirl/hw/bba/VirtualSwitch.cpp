@@ -0,0 +1,506 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+/*
+	Virtual ethernet switch, for several instances to network on one host without a real nic.
+
+	The switch is a shared memory segment named after the switch. Every instance that opens it
+	claims one of the ports, instances in the same process (one per thread) work the same way.
+	Each pair of ports has its own ring, written only by the sending port and read only by the
+	receiving one, so nothing is locked. Every port remembers the source mac of what it sent,
+	unicast frames go to the port that has the destination mac and the others are flooded.
+
+	Claiming and freeing a port take the switch's lock, in the segment. The last port to go
+	removes the segment's name under it and marks the segment closed, an instance that mapped
+	it just before sees that once it has the lock and opens the switch again.
+*/
+
+#include "VirtualNetwork.h"
+#include "stdclass.h"
+#include <atomic>
+#include <thread>
+
+#if HOST_OS == OS_WINDOWS
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
+#define SWITCH_MAGIC 0x32435753		// "SWC2", changes with the layout
+#define SWITCH_PORTS 8
+#define SWITCH_RING_SIZE 32768
+#define SWITCH_MAX_FRAME 1520
+#define SWITCH_MAC_VALID (1ull << 48)
+
+// One direction between two ports, frames are a u32 length and the data, padded to 4 bytes
+struct SwitchRing
+{
+	std::atomic<u32> head;
+	std::atomic<u32> tail;
+	u8 data[SWITCH_RING_SIZE];
+};
+
+struct SwitchPort
+{
+	std::atomic<u32> owner;			// process id, 0 for a free port
+	std::atomic<u32> dropped;		// frames that didn't fit in this port's rings
+	std::atomic<u64> mac;			// last source mac sent from this port, | SWITCH_MAC_VALID
+	SwitchRing rx[SWITCH_PORTS];	// by sending port
+};
+
+struct SwitchSegment
+{
+	std::atomic<u32> magic;
+	std::atomic<u32> lock;			// process id of the holder, 0 when free
+	std::atomic<u32> closed;		// the last port was freed, the name is gone
+	SwitchPort ports[SWITCH_PORTS];
+};
+
+static u64 mac_to_u64(const u8* mac)
+{
+	u64 rv = 0;
+	memcpy(&rv, mac, 6);
+	return rv | SWITCH_MAC_VALID;
+}
+
+static u32 frame_size(u32 len)
+{
+	return 4 + ((len + 3) & ~3);
+}
+
+static void ring_copy_in(SwitchRing& ring, u32 pos, const void* src, u32 len)
+{
+	pos &= SWITCH_RING_SIZE - 1;
+	u32 first = std::min(len, SWITCH_RING_SIZE - pos);
+
+	memcpy(&ring.data[pos], src, first);
+	memcpy(ring.data, (const u8*)src + first, len - first);
+}
+
+static void ring_copy_out(SwitchRing& ring, u32 pos, void* dst, u32 len)
+{
+	pos &= SWITCH_RING_SIZE - 1;
+	u32 first = std::min(len, SWITCH_RING_SIZE - pos);
+
+	memcpy(dst, &ring.data[pos], first);
+	memcpy((u8*)dst + first, ring.data, len - first);
+}
+
+static u32 current_process()
+{
+#if HOST_OS == OS_WINDOWS
+	return GetCurrentProcessId();
+#else
+	return getpid();
+#endif
+}
+
+// A port whose process is gone can be claimed again
+static bool process_alive(u32 pid)
+{
+#if HOST_OS == OS_WINDOWS
+	HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+
+	// there, but another user's
+	if (process == NULL)
+		return GetLastError() == ERROR_ACCESS_DENIED;
+
+	DWORD code;
+	bool alive = !GetExitCodeProcess(process, &code) || code == STILL_ACTIVE;
+
+	CloseHandle(process);
+	return alive;
+#else
+	return kill(pid, 0) == 0 || errno != ESRCH;
+#endif
+}
+
+// Only held for a port claim or release. A holder that died with it is broken
+static void switch_lock(SwitchSegment* segment)
+{
+	u32 pid = current_process();
+
+	for (;;)
+	{
+		u32 holder = 0;
+
+		if (segment->lock.compare_exchange_weak(holder, pid))
+			return;
+
+		if (holder != 0 && !process_alive(holder))
+			segment->lock.compare_exchange_strong(holder, 0);
+		else
+			std::this_thread::yield();
+	}
+}
+
+static void switch_unlock(SwitchSegment* segment)
+{
+	segment->lock = 0;
+}
+
+struct VirtualNetwork_switch_impl : VirtualNetwork {
+	string name;
+	SwitchSegment* segment = nullptr;
+	u32 port = SWITCH_PORTS;	// claimed one
+	mac_address mac;
+
+	// how far the batch being sent got in each port's ring, the heads are stored once at the end
+	u32 pending_head[SWITCH_PORTS];
+
+	// the sender RecvEthernetPackets starts with, moves on every call
+	u32 rx_next = 0;
+
+#if HOST_OS == OS_WINDOWS
+	HANDLE mapping = NULL;
+#endif
+
+	bool Open(const char* switch_name)
+	{
+		name = switch_name;
+
+		// a closed segment is only seen once per instance that raced the last port's release
+		for (int tries = 0; ; tries++)
+		{
+			if (!MapSegment())
+				return false;
+
+			u32 expected = 0;
+
+			if (!segment->magic.compare_exchange_strong(expected, SWITCH_MAGIC) && expected != SWITCH_MAGIC)
+			{
+				printf("VirtualSwitch: %s is not a switch of this version\n", name.c_str());
+				return false;
+			}
+
+			switch_lock(segment);
+
+			if (!segment->closed)
+				break;
+
+			switch_unlock(segment);
+			UnmapSegment();
+
+			if (tries == 3)
+			{
+				printf("VirtualSwitch: %s keeps closing\n", name.c_str());
+				return false;
+			}
+		}
+
+		u32 pid = current_process();
+
+		for (u32 i = 0; i < SWITCH_PORTS && port == SWITCH_PORTS; i++)
+		{
+			u32 owner = segment->ports[i].owner;
+
+			if (owner == 0 || !process_alive(owner))
+			{
+				segment->ports[i].owner = pid;
+				port = i;
+			}
+		}
+
+		switch_unlock(segment);
+
+		if (port == SWITCH_PORTS)
+		{
+			printf("VirtualSwitch: all %d ports of %s are taken\n", SWITCH_PORTS, name.c_str());
+			return false;
+		}
+
+		SwitchPort& p = segment->ports[port];
+
+		// whatever was left for the previous owner is dropped
+		for (int i = 0; i < SWITCH_PORTS; i++)
+			p.rx[i].tail = p.rx[i].head.load();
+
+		p.mac = 0;
+		p.dropped = 0;
+
+		u8 hash = 0;
+		for (char c : name)
+			hash = hash * 31 + c;
+
+		mac = { { 0x02, 'r', 'e', 'i', hash, (u8)port } };
+
+		printf("VirtualSwitch: port %d of %s, mac %02X:%02X:%02X:%02X:%02X:%02X\n", port, name.c_str(),
+			mac.bytes[0], mac.bytes[1], mac.bytes[2], mac.bytes[3], mac.bytes[4], mac.bytes[5]);
+
+		return true;
+	}
+
+	~VirtualNetwork_switch_impl()
+	{
+		if (segment == nullptr)
+			return;
+
+		if (port < SWITCH_PORTS)
+		{
+			SwitchPort& p = segment->ports[port];
+
+			if (p.dropped)
+				printf("VirtualSwitch: port %d dropped %d frames\n", port, p.dropped.load());
+
+			switch_lock(segment);
+
+			p.mac = 0;
+			p.owner = 0;
+
+			// ports of processes that are gone don't keep the switch
+			bool last = true;
+			for (int i = 0; i < SWITCH_PORTS; i++)
+			{
+				u32 owner = segment->ports[i].owner;
+				last = last && (owner == 0 || !process_alive(owner));
+			}
+
+			if (last)
+			{
+				segment->closed = 1;
+				RemoveSegment();
+			}
+
+			switch_unlock(segment);
+		}
+
+		UnmapSegment();
+	}
+
+	bool MapSegment()
+	{
+#if HOST_OS == OS_WINDOWS
+		string path = "Local\\reicast_switch_" + name;
+
+		mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SwitchSegment), path.c_str());
+
+		if (mapping == NULL)
+		{
+			printf("VirtualSwitch: can't create %s\n", path.c_str());
+			return false;
+		}
+
+		segment = (SwitchSegment*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SwitchSegment));
+#else
+		string path = SegmentPath();
+
+#if HOST_OS == OS_LINUX && !defined(_ANDROID)
+		int fd = shm_open(path.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+#else
+		int fd = open(path.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+#endif
+
+		if (fd < 0)
+		{
+			printf("VirtualSwitch: can't open %s: %s\n", path.c_str(), strerror(errno));
+			return false;
+		}
+
+		// the new part reads as zeros, an empty switch
+		struct stat st;
+		if (fstat(fd, &st) != 0 || (st.st_size != sizeof(SwitchSegment) && ftruncate(fd, sizeof(SwitchSegment)) != 0))
+		{
+			printf("VirtualSwitch: can't size %s\n", path.c_str());
+			close(fd);
+			return false;
+		}
+
+		void* ptr = mmap(NULL, sizeof(SwitchSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+
+		segment = ptr == MAP_FAILED ? nullptr : (SwitchSegment*)ptr;
+#endif
+
+		if (segment == nullptr)
+		{
+			printf("VirtualSwitch: can't map %s\n", name.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+	void UnmapSegment()
+	{
+#if HOST_OS == OS_WINDOWS
+		UnmapViewOfFile(segment);
+		CloseHandle(mapping);
+#else
+		munmap(segment, sizeof(SwitchSegment));
+#endif
+		segment = nullptr;
+	}
+
+	// Removes the name, the next instance to open the switch gets a new one. Windows drops the
+	// mapping with its last handle
+	void RemoveSegment()
+	{
+#if HOST_OS != OS_WINDOWS
+#if HOST_OS == OS_LINUX && !defined(_ANDROID)
+		shm_unlink(SegmentPath().c_str());
+#else
+		unlink(SegmentPath().c_str());
+#endif
+#endif
+	}
+
+#if HOST_OS != OS_WINDOWS
+	string SegmentPath()
+	{
+#if HOST_OS == OS_LINUX && !defined(_ANDROID)
+		return "/reicast_switch_" + name;
+#else
+		return get_writable_data_path(DATA_PATH "switch_" + name);
+#endif
+	}
+#endif
+
+	virtual void GetMacAddress(mac_address* mac) {
+		*mac = this->mac;
+	}
+
+	// Copies the frame to port dst's ring, it is seen there after the head is stored
+	void Queue(u32 dst, const u8* packet, u32 len)
+	{
+		SwitchRing& ring = segment->ports[dst].rx[port];
+		u32 size = frame_size(len);
+
+		if (SWITCH_RING_SIZE - (pending_head[dst] - ring.tail.load(std::memory_order_acquire)) < size)
+		{
+			segment->ports[dst].dropped++;
+			return;
+		}
+
+		ring_copy_in(ring, pending_head[dst], &len, 4);
+		ring_copy_in(ring, pending_head[dst] + 4, packet, len);
+		pending_head[dst] += size;
+	}
+
+	void Forward(const u8* packet, u32 len)
+	{
+		if (len < 14 || len > SWITCH_MAX_FRAME)
+			return;
+
+		u64 src = mac_to_u64(packet + 6);
+
+		if (segment->ports[port].mac.load(std::memory_order_relaxed) != src)
+			segment->ports[port].mac.store(src, std::memory_order_relaxed);
+
+		// unicast goes where its mac was seen, unknown and group addresses are flooded
+		if ((packet[0] & 1) == 0)
+		{
+			u64 dst = mac_to_u64(packet);
+
+			for (u32 i = 0; i < SWITCH_PORTS; i++)
+			{
+				if (i != port && segment->ports[i].owner != 0 && segment->ports[i].mac.load(std::memory_order_relaxed) == dst)
+				{
+					Queue(i, packet, len);
+					return;
+				}
+			}
+		}
+
+		for (u32 i = 0; i < SWITCH_PORTS; i++)
+		{
+			if (i != port && segment->ports[i].owner != 0)
+				Queue(i, packet, len);
+		}
+	}
+
+	void SendEthernetPackets(const u8* const* packets, const int* lens, int count) override
+	{
+		for (u32 i = 0; i < SWITCH_PORTS; i++)
+			pending_head[i] = segment->ports[i].rx[port].head.load(std::memory_order_relaxed);
+
+		for (int i = 0; i < count; i++)
+			Forward(packets[i], lens[i]);
+
+		for (u32 i = 0; i < SWITCH_PORTS; i++)
+		{
+			std::atomic<u32>& head = segment->ports[i].rx[port].head;
+
+			if (head.load(std::memory_order_relaxed) != pending_head[i])
+				head.store(pending_head[i], std::memory_order_release);
+		}
+	}
+
+	virtual void SendEthernetPacket(const void* packet, int len) {
+		const u8* p = (const u8*)packet;
+		SendEthernetPackets(&p, &len, 1);
+	}
+
+	int RecvEthernetPackets(u8* packets, int* lens, int max_len, int count) override
+	{
+		int n = 0;
+		SwitchPort& p = segment->ports[port];
+
+		u32 first = rx_next;
+		rx_next = (rx_next + 1) % SWITCH_PORTS;
+
+		// round robin between the senders, starting at the next one every call and taking
+		// a share of what is left from each per pass, so one busy port doesn't starve the rest
+		bool more = true;
+		while (more && n < count)
+		{
+			more = false;
+			int share = max(1, (count - n) / (int)SWITCH_PORTS);
+
+			for (u32 k = 0; k < SWITCH_PORTS && n < count; k++)
+			{
+				SwitchRing& ring = p.rx[(first + k) % SWITCH_PORTS];
+				u32 tail = ring.tail.load(std::memory_order_relaxed);
+				u32 head = ring.head.load(std::memory_order_acquire);
+
+				for (int taken = 0; tail != head && n < count && taken < share; taken++)
+				{
+					u32 len;
+					ring_copy_out(ring, tail, &len, 4);
+
+					if ((int)len <= max_len)
+					{
+						ring_copy_out(ring, tail + 4, packets + n * max_len, len);
+						lens[n++] = len;
+					}
+
+					tail += frame_size(len);
+				}
+
+				if (tail != head)
+					more = true;
+
+				ring.tail.store(tail, std::memory_order_release);
+			}
+		}
+
+		return n;
+	}
+
+	virtual int RecvEthernetPacket(void* packet, int max_len) {
+		int len;
+
+		if (RecvEthernetPackets((u8*)packet, &len, max_len, 1) == 0)
+			return 0;
+
+		return len;
+	}
+};
+
+VirtualNetwork* VirtualNetwork::CreateSwitchNetwork(const char* name) {
+	VirtualNetwork_switch_impl* rv = new VirtualNetwork_switch_impl();
+
+	if (!rv->Open(name))
+	{
+		delete rv;
+		return CreateNullNetwork();
+	}
+
+	return rv;
+}
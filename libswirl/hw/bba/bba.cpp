@@ -8,6 +8,7 @@
 #include "ethernet.h"
 #include "rtl8139c.h"
 #include "hw/holly/holly_intc.h"
+#include "hw/sh4/sh4_sched.h"
 
 const char* chip_id="GAPSPCI_BRIDGE_2";
 
@@ -243,48 +244,67 @@ default_config:
 }
 
 
-void ExaminePacket(const u8* p,u32 proto)
+// Frames go to and come from the network a batch at a time, from bba_periodical
+#define BBA_BATCH 16
+#define BBA_MAX_FRAME 1520
+#define BBA_PERIOD_US 250
+
+static u8 rx_batch[BBA_BATCH][BBA_MAX_FRAME];
+static int rx_lens[BBA_BATCH];
+static int rx_count, rx_next;
+
+static u8 tx_batch[BBA_BATCH][BBA_MAX_FRAME];
+static const u8* tx_ptrs[BBA_BATCH];
+static int tx_lens[BBA_BATCH];
+static int tx_count;
+
+BBAStats bba_stats;
+
+static void bba_flush_tx()
 {
-	if (proto==0x0800) //IP ?
-	{
-		const ip_header* ip=(const ip_header*)(p+14);
-		printf("SRC : %d.%d.%d.%d, DST : %d.%d.%d.%d Len : %d\n",ip->ip_src.bytes[0],ip->ip_src.bytes[1],ip->ip_src.bytes[2],ip->ip_src.bytes[3]
-																,ip->ip_dst.bytes[0],ip->ip_dst.bytes[1],ip->ip_dst.bytes[2],ip->ip_dst.bytes[3]
-																,ip->ip_len/256 + (u8)ip->ip_len*256);
-	}
+	if (tx_count == 0)
+		return;
+
+	virtualNetwork->SendEthernetPackets(tx_ptrs, tx_lens, tx_count);
+	tx_count = 0;
 }
 
 void bba_periodical()
 {
-	while(ncrc(opaq))
-	{
-		u8 p[1520];
-		// FIXME
-		
-		int len=virtualNetwork->RecvEthernetPacket(p, 1520);
+	bba_flush_tx();
 
-		if (len>0)
+	while (ncrc(opaq))
+	{
+		if (rx_next == rx_count)
 		{
-			u32 fromaddr=nrc(opaq,p,len);
-			printf("Got Packet to %02X:%02X:%02X:%02X:%02X:%02X from %02X:%02X:%02X:%02X:%02X:%02X, proto 0x%04X, to addr 0x%04X sz %d bytes\n",
-				p[0],p[1],p[2],p[3],p[4],p[5],p[6],p[7],p[8],p[9],p[10],p[11],p[12]*256+p[13],fromaddr,len);
-			
-			ExaminePacket(p,p[12]*256+p[13]);
+			rx_count = virtualNetwork->RecvEthernetPackets(&rx_batch[0][0], rx_lens, BBA_MAX_FRAME, BBA_BATCH);
+			rx_next = 0;
+
+			if (rx_count == 0)
+				break;
 		}
-		else
-			break;
+
+		// what the nic has no room for stays in rx_batch until the next time
+		nrc(opaq, rx_batch[rx_next], rx_lens[rx_next]);
+		bba_stats.rx_packets++;
+		bba_stats.rx_bytes += rx_lens[rx_next];
+		rx_next++;
 	}
 }
 
-
 void qemu_send_packet(VLANClientState*,const uint8_t* p, int sz,u32 fromaddr)
 {
-	//FIXME
-	virtualNetwork->SendEthernetPacket(p, sz);
-	printf("Sent Packet to %02X:%02X:%02X:%02X:%02X:%02X from %02X:%02X:%02X:%02X:%02X:%02X, proto 0x%04X, from addr 0x%04X sz %d bytes\n",
-		p[0],p[1],p[2],p[3],p[4],p[5],p[6],p[7],p[8],p[9],p[10],p[11],p[12]*256+p[13],fromaddr,sz);
-	
-	ExaminePacket(p,p[12]*256+p[13]);
+	if (sz > BBA_MAX_FRAME)
+		sz = BBA_MAX_FRAME;
+
+	memcpy(tx_batch[tx_count], p, sz);
+	tx_ptrs[tx_count] = tx_batch[tx_count];
+	tx_lens[tx_count] = sz;
+	bba_stats.tx_packets++;
+	bba_stats.tx_bytes += sz;
+
+	if (++tx_count == BBA_BATCH)
+		bba_flush_tx();
 }
 
 VLANClientState *qemu_new_vlan_client(void* ,net_receive* rc,net_can_receive* cr,void* opa)
@@ -349,6 +369,8 @@ void pci_register_io_region(PCIDevice *pci_dev, int region_num,
 
 
 struct BBA_impl : MMIODevice {
+	int bba_sched;
+
 	BBA_impl(ASIC* asic, VirtualNetwork* virtualNetwork)
 	{
 		::asic = asic;
@@ -360,6 +382,29 @@ struct BBA_impl : MMIODevice {
 		opaq=0;//(((u8*)pcidev)+sizeof(PCIDevice));
 		pcidev=pci_rtl8139_init(0,&nd,0);
 	}
+
+	int bba_sched_func(int tag, int c, int j)
+	{
+		bba_periodical();
+
+		return SH4_MAIN_CLOCK / 1000000 * BBA_PERIOD_US;
+	}
+
+	bool Init()
+	{
+		rx_count = rx_next = tx_count = 0;
+		bba_sched = sh4_sched_register(this, 0, STATIC_FORWARD(BBA_impl, bba_sched_func));
+		sh4_sched_request(bba_sched, SH4_MAIN_CLOCK / 1000000 * BBA_PERIOD_US);
+
+		return true;
+	}
+
+	void Term()
+	{
+		delete ::virtualNetwork;
+		::virtualNetwork = NULL;
+	}
+
 	u32 Read(u32 addr,u32 sz)
 	{
 		u32 rv=0;
@@ -7,6 +7,17 @@
 #pragma once
 #include "types.h"
 
+// Frames to and from the network since start
+struct BBAStats
+{
+	u64 rx_packets;
+	u64 rx_bytes;
+	u64 tx_packets;
+	u64 tx_bytes;
+};
+
+extern BBAStats bba_stats;
+
 struct ASIC;
 struct VirtualNetwork;
 
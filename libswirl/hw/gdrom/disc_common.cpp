@@ -5,8 +5,15 @@
 
 
 #include "disc_common.h"
+#include "oslib/threading.h"
+#include "oslib/oslib.h"
+#include "hw/StaticForward.h"
+
+// sectors per read ahead chunk, the same as the drive's read buffer
+#define GD_READ_CHUNK 32
 
 u8 q_subchannel[96];		//latest q subcode
+GDReadStats gd_read_stats;
 
 u32 NullDriveDiscType;
 static Disc* disc;
@@ -51,13 +58,11 @@ static void PatchRegion_6(u8* sector,int size)
 }
 
 static void DiscTerm();
+static void DiscOpen(wchar* fn);
 
 static bool DiscInit_(wchar* fn)
 {
-	DiscTerm();
-
-	//try all drivers
-	disc = OpenDisc(fn);
+	DiscOpen(fn);
 
 	if (disc!=0)
 	{
@@ -179,13 +184,7 @@ static bool DiscSwap()
 }
 
 
-static void DiscTerm()
-{
-	if (disc!=0)
-		delete disc;
-
-	disc=0;
-}
+static void DiscTerm();
 
 
 //
@@ -212,12 +211,12 @@ static u32 CreateTrackInfo_se(u32 ctrl,u32 addr,u32 tracknum)
 }
 
 
-static void DiscGetDriveSector(u8 * buff,u32 StartSector,u32 SectorCount,u32 secsz)
+static void DiscGetDriveSector(u8 * buff,u32 StartSector,u32 SectorCount,u32 secsz,u8* q)
 {
 	//printf("GD: read %08X, %d\n",StartSector,SectorCount);
 	if (disc)
 	{
-		disc->ReadSectors(StartSector,SectorCount,buff,secsz, q_subchannel);
+		disc->ReadSectors(StartSector,SectorCount,buff,secsz, q);
 		if (disc->type == GdRom && StartSector==45150 && SectorCount==7)
 		{
 			PatchRegion_0(buff,secsz);
@@ -310,6 +309,290 @@ void printtoc(TocInfo* toc,SessionInfo* ses)
 }
 
 
+/*
+	The next chunks of a read command are read on a thread, into two buffers, while the drive is
+	still transferring the current one. The drive timing doesn't change, a chunk that isn't there
+	yet is waited for, and one that wasn't asked for is read right away.
+*/
+struct GDReadSlot
+{
+	u32 start;
+	u32 count;
+	u32 secsz;
+	u32 seq;			// requests are read in order
+	bool valid;
+	bool ready;
+	bool reading;
+	u8 q[96];			// q subcode after the last sector
+	u8 data[GD_READ_CHUNK * 2448];
+};
+
+struct GDReadPipeline
+{
+	GDReadSlot slots[2];
+	u32 seq;
+
+	cMutex lock;		// slots
+	cMutex disc_lock;	// disc and its reads, taken before lock
+	cResetEvent wake;
+	cResetEvent done;
+
+	cThread thread;
+	bool running;
+	bool exit;
+
+	GDReadPipeline() : thread(STATIC_FORWARD(GDReadPipeline, loop), this)
+	{
+		memset(slots, 0, sizeof(slots));
+		seq = 0;
+		running = false;
+		exit = false;
+	}
+
+	void Start()
+	{
+		if (running)
+			return;
+
+		exit = false;
+		running = true;
+		thread.Start();
+	}
+
+	void Stop()
+	{
+		if (!running)
+			return;
+
+		lock.Lock();
+		exit = true;
+		lock.Unlock();
+		wake.Set();
+		thread.WaitToEnd();
+
+		running = false;
+		Invalidate();
+	}
+
+	// With disc_lock held, nothing is being read then
+	void Invalidate()
+	{
+		lock.Lock();
+		for (u32 i = 0; i < ARRAY_SIZE(slots); i++)
+			slots[i].valid = false;
+		lock.Unlock();
+	}
+
+	GDReadSlot* find(u32 start, u32 count, u32 secsz)
+	{
+		for (u32 i = 0; i < ARRAY_SIZE(slots); i++)
+		{
+			GDReadSlot& s = slots[i];
+
+			if (s.valid && s.start == start && s.count == count && s.secsz == secsz)
+				return &s;
+		}
+
+		return nullptr;
+	}
+
+	// The chunks the drive reads next, for a read command at start
+	void Request(u32 start, u32 count, u32 secsz)
+	{
+		if (!running || !settings.imgread.AsyncRead || secsz > 2448)
+			return;
+
+		u32 chunk_start[ARRAY_SIZE(slots)];
+		u32 chunk_count[ARRAY_SIZE(slots)];
+		u32 chunks = 0;
+
+		while (chunks < ARRAY_SIZE(slots) && count)
+		{
+			chunk_start[chunks] = start;
+			chunk_count[chunks] = std::min(count, (u32)GD_READ_CHUNK);
+
+			start += chunk_count[chunks];
+			count -= chunk_count[chunks];
+			chunks++;
+		}
+
+		lock.Lock();
+
+		bool queued = false;
+
+		for (u32 c = 0; c < chunks; c++)
+		{
+			if (find(chunk_start[c], chunk_count[c], secsz))
+				continue;
+
+			// a slot that isn't being read and doesn't hold one of the wanted chunks
+			for (u32 i = 0; i < ARRAY_SIZE(slots); i++)
+			{
+				GDReadSlot& s = slots[i];
+				bool wanted = false;
+
+				for (u32 k = 0; k < chunks; k++)
+					wanted |= s.valid && s.start == chunk_start[k] && s.count == chunk_count[k] && s.secsz == secsz;
+
+				if (s.reading || wanted)
+					continue;
+
+				s.start = chunk_start[c];
+				s.count = chunk_count[c];
+				s.secsz = secsz;
+				s.seq = ++seq;
+				s.valid = true;
+				s.ready = false;
+				memcpy(s.q, q_subchannel, sizeof(s.q));
+
+				queued = true;
+				break;
+			}
+		}
+
+		lock.Unlock();
+
+		if (queued)
+			wake.Set();
+	}
+
+	void Read(u8* buff, u32 start, u32 count, u32 secsz)
+	{
+		double begin = os_GetSeconds();
+
+		lock.Lock();
+
+		GDReadSlot* slot = find(start, count, secsz);
+		bool waited = false;
+
+		if (slot)
+		{
+			// only this thread gives slots away, it stays the same
+			while (!slot->ready && slot->valid)
+			{
+				waited = true;
+				lock.Unlock();
+				done.Wait();
+				lock.Lock();
+			}
+
+			// the disc changed while waiting, what the slot holds isn't of this disc
+			if (!slot->valid)
+				slot = nullptr;
+		}
+
+		if (slot)
+		{
+			memcpy(buff, slot->data, count * secsz);
+			memcpy(q_subchannel, slot->q, sizeof(q_subchannel));
+			slot->valid = false;
+
+			if (waited)
+				gd_read_stats.late_hits++;
+			else
+				gd_read_stats.prefetch_hits++;
+
+			lock.Unlock();
+		}
+		else
+		{
+			lock.Unlock();
+
+			disc_lock.Lock();
+			DiscGetDriveSector(buff, start, count, secsz, q_subchannel);
+			disc_lock.Unlock();
+		}
+
+		double ms = (os_GetSeconds() - begin) * 1000;
+
+		gd_read_stats.reads++;
+		gd_read_stats.read_ms += ms;
+		gd_read_stats.max_ms = std::max(gd_read_stats.max_ms, ms);
+	}
+
+	void* loop()
+	{
+		for (;;)
+		{
+			wake.Wait();
+
+			for (;;)
+			{
+				lock.Lock();
+
+				if (exit)
+				{
+					lock.Unlock();
+					done.Set();
+					return NULL;
+				}
+
+				GDReadSlot* slot = nullptr;
+
+				for (u32 i = 0; i < ARRAY_SIZE(slots); i++)
+				{
+					GDReadSlot& s = slots[i];
+
+					if (s.valid && !s.ready && (!slot || s.seq < slot->seq))
+						slot = &s;
+				}
+
+				if (slot)
+					slot->reading = true;
+
+				lock.Unlock();
+
+				if (!slot)
+					break;
+
+				disc_lock.Lock();
+				DiscGetDriveSector(slot->data, slot->start, slot->count, slot->secsz, slot->q);
+				disc_lock.Unlock();
+
+				lock.Lock();
+				slot->reading = false;
+				slot->ready = true;
+				lock.Unlock();
+
+				done.Set();
+			}
+		}
+	}
+};
+
+static GDReadPipeline read_pipeline;
+
+static void DiscTerm()
+{
+	read_pipeline.disc_lock.Lock();
+
+	read_pipeline.Invalidate();
+
+	if (disc!=0)
+		delete disc;
+
+	disc=0;
+
+	read_pipeline.disc_lock.Unlock();
+}
+
+// Swaps the disc in one go, the read thread never sees it missing. Chunks requested during the swap
+// were for the old disc, so they are dropped with the rest.
+static void DiscOpen(wchar* fn)
+{
+	read_pipeline.disc_lock.Lock();
+
+	if (disc!=0)
+		delete disc;
+
+	//try all drivers
+	disc = OpenDisc(fn);
+
+	read_pipeline.Invalidate();
+
+	read_pipeline.disc_lock.Unlock();
+}
+
 struct GDRomDisc_impl : GDRomDisc {
 	void ReadSubChannel(u8* buff, u32 format, u32 len)
 	{
@@ -321,11 +604,21 @@ struct GDRomDisc_impl : GDRomDisc {
 
 	void ReadSector(u8* buff, u32 StartSector, u32 SectorCount, u32 secsz)
 	{
-		DiscGetDriveSector(buff, StartSector, SectorCount, secsz);
+		read_pipeline.Read(buff, StartSector, SectorCount, secsz);
 		//if (CurrDrive)
 		//	CurrDrive->ReadSector(buff,StartSector,SectorCount,secsz);
 	}
 
+	void ReadAhead(u32 StartSector, u32 SectorCount, u32 secsz)
+	{
+		read_pipeline.disc_lock.Lock();
+		if (disc)
+			disc->ReadAhead(StartSector, SectorCount);
+		read_pipeline.disc_lock.Unlock();
+
+		read_pipeline.Request(StartSector, SectorCount, secsz);
+	}
+
 	void GetToc(u32* toc, u32 area)
 	{
 		DiscGetDriveToc(toc, (DiskArea)area);
@@ -356,13 +649,25 @@ struct GDRomDisc_impl : GDRomDisc {
 		if (!DiscInit())
 			return rv_serror;
 		libCore_gdrom_disc_change();
+		gd_read_stats = GDReadStats();
+		read_pipeline.Start();
 		settings.imgread.PatchRegion = true;
 		return rv_ok;
 	}
 
 	//called when exiting from sh4 thread , from the new thread context (for any thread specific init) :P
 
-	~GDRomDisc_impl() { DiscTerm(); }
+	~GDRomDisc_impl()
+	{
+		read_pipeline.Stop();
+		DiscTerm();
+
+		GDReadStats& s = gd_read_stats;
+		if (s.reads)
+			printf("gdrom: %llu reads, %llu read ahead, %llu waited for, %.3f ms average, %.3f ms max\n",
+				(unsigned long long)s.reads, (unsigned long long)s.prefetch_hits, (unsigned long long)s.late_hits,
+				s.read_ms / s.reads, s.max_ms);
+	}
 
 	void Swap()
 	{
@@ -18,3 +18,15 @@ int GetFile(char *szFileName);
 
 void printtoc(TocInfo* toc,SessionInfo* ses);
 extern u8 q_subchannel[96];
+
+// Sector reads of the drive, as seen from the emulator thread
+struct GDReadStats
+{
+	u64 reads;
+	u64 prefetch_hits;	// read ahead by the io thread
+	u64 late_hits;		// still being read ahead, waited for
+	double read_ms;		// total, blocked in reads
+	double max_ms;
+};
+
+extern GDReadStats gd_read_stats;
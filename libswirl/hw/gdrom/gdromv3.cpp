@@ -94,6 +94,10 @@ struct GDRomV3_impl final : MMIODevice {
         g_GDRDisc->ReadSector(read_buff.cache, read_params.start_sector, count, read_params.sector_type);
         read_params.start_sector += count;
         read_params.remaining_sectors -= count;
+
+        // keep the image reading ahead of long dma transfers
+        if (read_params.remaining_sectors)
+            g_GDRDisc->ReadAhead(read_params.start_sector, read_params.remaining_sectors, read_params.sector_type);
     }
 
 
@@ -490,6 +494,8 @@ struct GDRomV3_impl final : MMIODevice {
             read_params.remaining_sectors = sector_count;
             read_params.sector_type = sector_type;//yeah i know , not really many types supported...
 
+            g_GDRDisc->ReadAhead(read_params.start_sector, read_params.remaining_sectors, read_params.sector_type);
+
             printf_spicmd("SPI_CD_READ - Sector=%d Size=%d/%d DMA=%d\n", read_params.start_sector, read_params.remaining_sectors, read_params.sector_type, Features.CDRead.DMA);
             if (Features.CDRead.DMA == 1)
             {
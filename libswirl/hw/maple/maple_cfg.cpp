@@ -12,6 +12,7 @@
 #include "cfg/cfg.h"
 #include "hw/naomi/naomi_cart.h"
 #include "oslib/oslib.h"
+#include "input/input_latency.h"
 
 #define HAS_VMU
 /*
@@ -61,6 +62,15 @@ u32 awave_button_mapping[] = {
 		// DC_DPAD2_RIGHT
 };
 
+// Each player's input is read once per dma, by the first device that asks for it
+static PlainJoystickState input_snapshot[4];
+static bool input_snapshot_valid[4];
+
+void mcfg_SnapshotInput()
+{
+	memset(input_snapshot_valid, 0, sizeof(input_snapshot_valid));
+}
+
 struct MapleConfigMap : IMapleConfigMap
 {
 	maple_device* dev;
@@ -81,7 +91,20 @@ struct MapleConfigMap : IMapleConfigMap
 	void GetInput(PlainJoystickState* pjs)
 	{
 		int player_num = this->player_num == -1 ? dev->bus_id : this->player_num;
-		UpdateInputState(player_num);
+
+		if (!input_snapshot_valid[player_num])
+		{
+			UpdateInputState(player_num);
+			ReadInput(player_num, &input_snapshot[player_num]);
+			input_snapshot_valid[player_num] = true;
+			latency_maple_sample(player_num);
+		}
+
+		*pjs = input_snapshot[player_num];
+	}
+
+	void ReadInput(int player_num, PlainJoystickState* pjs)
+	{
 
 		pjs->kcode=kcode[player_num];
 #if DC_PLATFORM == DC_PLATFORM_DREAMCAST
@@ -70,6 +70,8 @@ void mcfg_CreateAtomisWaveControllers();
 
 
 void mcfg_DestroyDevices();
+// Before a maple dma, the devices see the input as it is when they first read it during the dma
+void mcfg_SnapshotInput();
 void mcfg_SerializeDevices(void **data, unsigned int *total_size);
 void mcfg_UnserializeDevices(void **data, unsigned int *total_size);
 
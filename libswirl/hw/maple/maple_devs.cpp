@@ -138,22 +138,21 @@ struct maple_base: maple_device
 	void w16(u16 data) { *((u16*)dma_buffer_out)=data;dma_buffer_out+=2;dma_count_out[0]+=2; }
 	void w32(u32 data) { *(u32*)dma_buffer_out=data;dma_buffer_out+=4;dma_count_out[0]+=4; }
 
+	// the out buffer is the reply in guest ram, blocks are copied there in one go
 	void wptr(const void* src,u32 len)
 	{
-		u8* src8=(u8*)src;
-		while(len--)
-			w8(*src8++);
+		memcpy(dma_buffer_out,src,len);
+		dma_buffer_out+=len;
+		dma_count_out[0]+=len;
 	}
 	void wstr(const char* str,u32 len)
 	{
 		size_t ln=strlen(str);
 		verify(len>=ln);
-		len-=ln;
-		while(ln--)
-			w8(*str++);
-
-		while(len--)
-			w8(0x20);
+		memcpy(dma_buffer_out,str,ln);
+		memset(dma_buffer_out+ln,0x20,len-ln);
+		dma_buffer_out+=len;
+		dma_count_out[0]+=len;
 	}
 
 	u8 r8()	  { u8  rv=*((u8*)dma_buffer_in);dma_buffer_in+=1;dma_count_in-=1; return rv; }
@@ -161,9 +160,9 @@ struct maple_base: maple_device
 	u32 r32() { u32 rv=*(u32*)dma_buffer_in;dma_buffer_in+=4;dma_count_in-=4; return rv; }
 	void rptr(const void* dst,u32 len)
 	{
-		u8* dst8=(u8*)dst;
-		while(len--)
-			*dst8++=r8();
+		memcpy((void*)dst,dma_buffer_in,len);
+		dma_buffer_in+=len;
+		dma_count_in-=len;
 	}
 	u32 r_count() { return dma_count_in; }
 
@@ -382,6 +381,7 @@ struct maple_sega_vmu: maple_base
 	u8 flash_data[128*1024];
 	u8 lcd_data[192];
 	u8 lcd_data_decoded[48*32];
+	bool lcd_shown = false;		// lcd_data is on the screen
 
 	virtual MapleDeviceType get_device_type()
 	{
@@ -414,6 +414,7 @@ struct maple_sega_vmu: maple_base
 		REICAST_USA(flash_data,128*1024);
 		REICAST_USA(lcd_data,192);
 		REICAST_USA(lcd_data_decoded,48*32);
+		lcd_shown = false;
 		return true ;
 	}
 	virtual void OnSetup()
@@ -692,7 +693,12 @@ struct maple_sega_vmu: maple_base
 
 					case MFID_2_LCD:
 					{
+						// most games send the same image every frame
+						if (lcd_shown && r_count() >= 192 && memcmp(dma_buffer_in, lcd_data, 192) == 0)
+							return MDRS_DeviceReply;
+
 						rptr(lcd_data,192);
+						lcd_shown = true;
 
 						u8 white=0xff,black=0x00;
 
@@ -62,6 +62,7 @@ bool IsOnSh4Ram(u32 addr)
 }
 
 u32 dmacount=0;
+MapleStats maple_stats;
 
 struct MapleDevice final : MMIODevice {
 
@@ -93,6 +94,112 @@ struct MapleDevice final : MMIODevice {
 		}
 	}
 
+	/*
+		Dma lists are decoded once and kept while they don't change, games send the same one or two
+		every frame. What changes from frame to frame is the data in the frames (vmu lcd images,
+		block writes) and the devices read that from ram as before. Before a list is used its header
+		words are compared with the ones it was decoded from, where everything else comes from, and
+		a changed one decodes it again.
+	*/
+	struct DmaEntry
+	{
+		u32* header;		// host pointer to the two header words
+		u32 header_1;
+		u32 header_2;
+		u32* p_data;		// frame, for MP_Start
+		u32* p_out;			// reply, for MP_Start
+	};
+
+	struct DmaList
+	{
+		u32 addr = 0;
+		bool error = false;	// the decoded part is followed by an invalid frame
+		vector<DmaEntry> entries;
+	};
+
+	DmaList dma_lists[4];
+	u32 dma_list_next = 0;
+
+	bool CheckDmaList(const DmaList& list)
+	{
+		if (list.entries.empty())
+			return false;
+
+		for (const DmaEntry& e : list.entries)
+		{
+			if (e.header[0] != e.header_1 || e.header[1] != e.header_2)
+				return false;
+		}
+
+		return true;
+	}
+
+	void DecodeDmaList(DmaList& list)
+	{
+		list.entries.clear();
+		list.addr = SB_MDSTAR;
+		list.error = false;
+
+		u32 addr = SB_MDSTAR;
+		bool last = false;
+
+		while (last != true)
+		{
+			DmaEntry e;
+
+			e.header = (u32*)GetMemPtr(addr, 8);
+			e.header_1 = ReadMem32_nommu(addr);
+			e.header_2 = ReadMem32_nommu(addr + 4);
+			e.p_data = e.p_out = NULL;
+
+			last = (e.header_1 >> 31) == 1;//is last transfer ?
+			u32 plen = (e.header_1 & 0xFF) + 1;//transfer length (32-bit unit)
+			u32 maple_op = (e.header_1 >> 8) & 7;	// Pattern selection: 0 - START, 2 - SDCKB occupy permission, 3 - RESET, 4 - SDCKB occupy cancel, 7 - NOP
+
+			if (maple_op == MP_Start)
+			{
+				u32 header_2 = e.header_2 & 0x1FFFFFE0;
+
+				if (!IsOnSh4Ram(header_2))
+				{
+					printf("MAPLE ERROR : DESTINATION NOT ON SH4 RAM 0x%X\n", header_2);
+					header_2 &= 0xFFFFFF;
+					header_2 |= (3 << 26);
+				}
+				e.p_out = (u32*)GetMemPtr(header_2, 4);
+				e.p_data = (u32*)GetMemPtr(addr + 8, (plen) * sizeof(u32));
+
+				if (e.p_data == NULL || e.p_out == NULL || e.header == NULL)
+				{
+					printf("MAPLE ERROR : INVALID SB_MDSTAR value 0x%X\n", addr);
+					list.error = true;
+					break;
+				}
+
+				//goto next command
+				addr += 2 * 4 + plen * 4;
+			}
+			else
+			{
+				if (e.header == NULL)
+				{
+					printf("MAPLE ERROR : INVALID SB_MDSTAR value 0x%X\n", addr);
+					list.error = true;
+					break;
+				}
+
+				if (maple_op != MP_SDCKBOccupy && maple_op != MP_SDCKBOccupyCancel && maple_op != MP_Reset && maple_op != MP_NOP)
+					printf("MAPLE: Unknown maple_op == %d length %d\n", maple_op, plen * 4);
+
+				addr += 1 * 4;
+			}
+
+			list.entries.push_back(e);
+		}
+
+		maple_stats.decodes++;
+	}
+
 	void maple_DoDma()
 	{
 		verify(SB_MDEN & 1)
@@ -101,18 +208,35 @@ struct MapleDevice final : MMIODevice {
 #if debug_maple
 			printf("Maple: DoMapleDma SB_MDSTAR=%x\n", SB_MDSTAR);
 #endif
-		u32 addr = SB_MDSTAR;
+		maple_stats.dmas++;
+
+		// all the devices see the input as it is now
+		mcfg_SnapshotInput();
+
+		DmaList* list = NULL;
+
+		for (DmaList& l : dma_lists)
+		{
+			if (l.addr == SB_MDSTAR && !l.entries.empty())
+				list = &l;
+		}
+
+		if (list == NULL || !CheckDmaList(*list))
+		{
+			if (list == NULL)
+				list = &dma_lists[dma_list_next++ % ARRAY_SIZE(dma_lists)];
+
+			DecodeDmaList(*list);
+		}
+
 		u32 xfer_count = 0;
-		bool last = false;
-		while (last != true)
+
+		for (const DmaEntry& e : list->entries)
 		{
 			dmacount++;
-			u32 header_1 = ReadMem32_nommu(addr);
-			u32 header_2 = ReadMem32_nommu(addr + 4) & 0x1FFFFFE0;
 
-			last = (header_1 >> 31) == 1;//is last transfer ?
-			u32 plen = (header_1 & 0xFF) + 1;//transfer length (32-bit unit)
-			u32 maple_op = (header_1 >> 8) & 7;	// Pattern selection: 0 - START, 2 - SDCKB occupy permission, 3 - RESET, 4 - SDCKB occupy cancel, 7 - NOP
+			u32 plen = (e.header_1 & 0xFF) + 1;//transfer length (32-bit unit)
+			u32 maple_op = (e.header_1 >> 8) & 7;
 			xfer_count += plen * 4;
 
 			//this is kinda wrong .. but meh
@@ -121,22 +245,8 @@ struct MapleDevice final : MMIODevice {
 			{
 			case MP_Start:
 			{
-				if (!IsOnSh4Ram(header_2))
-				{
-					printf("MAPLE ERROR : DESTINATION NOT ON SH4 RAM 0x%X\n", header_2);
-					header_2 &= 0xFFFFFF;
-					header_2 |= (3 << 26);
-				}
-				u32* p_out = (u32*)GetMemPtr(header_2, 4);
-				u32 outlen = 0;
-
-				u32* p_data = (u32*)GetMemPtr(addr + 8, (plen) * sizeof(u32));
-				if (p_data == NULL)
-				{
-					printf("MAPLE ERROR : INVALID SB_MDSTAR value 0x%X\n", addr);
-					SB_MDST = 0;
-					return;
-				}
+				u32* p_data = e.p_data;
+				u32* p_out = e.p_out;
 
 				//Command code 
 				u32 command = p_data[0] & 0xFF;
@@ -150,6 +260,7 @@ struct MapleDevice final : MMIODevice {
 				u32 inlen = (p_data[0] >> 24) & 0xFF;
 				inlen *= 4;
 
+				// the reply goes straight to guest ram
 				if (MapleDevices[bus][5] && MapleDevices[bus][port])
 				{
 					u32 outlen = MapleDevices[bus][port]->RawDma(&p_data[0], inlen + 4, &p_out[0]);
@@ -159,43 +270,32 @@ struct MapleDevice final : MMIODevice {
 				{
 					if (port != 5 && command != 1)
 						printf("MAPLE: Unknown device bus %d port %d cmd %d\n", bus, port, command);
-					outlen = 4;
 					p_out[0] = 0xFFFFFFFF;
 				}
-
-				//goto next command
-				addr += 2 * 4 + plen * 4;
 			}
 			break;
 
 			case MP_SDCKBOccupy:
 			{
-				u32 bus = (header_1 >> 16) & 3;
+				u32 bus = (e.header_1 >> 16) & 3;
 				if (MapleDevices[bus][5])
 					MapleDevices[bus][5]->get_lightgun_pos();
-
-				addr += 1 * 4;
 			}
 			break;
 
-			case MP_SDCKBOccupyCancel:
-				addr += 1 * 4;
-				break;
-
-			case MP_Reset:
-				addr += 1 * 4;
-				break;
-
-			case MP_NOP:
-				addr += 1 * 4;
-				break;
-
 			default:
-				printf("MAPLE: Unknown maple_op == %d length %d\n", maple_op, plen * 4);
-				addr += 1 * 4;
+				break;
 			}
 		}
 
+		if (list->error)
+		{
+			// decoded again next time, the game may have fixed it by then
+			list->entries.clear();
+			SB_MDST = 0;
+			return;
+		}
+
 		//printf("Maple XFER size %d bytes - %.2f ms\n",xfer_count,xfer_count*100.0f/(2*1024*1024/8));
 		sh4_sched_request(maple_schid, xfer_count * (SH4_MAIN_CLOCK / (2 * 1024 * 1024 / 8)));
 	}
@@ -236,6 +336,8 @@ struct MapleDevice final : MMIODevice {
 
 	void Reset(bool Manual)
 	{
+		for (DmaList& l : dma_lists)
+			l.entries.clear();
 		maple_ddt_pending_reset = false;
 		SB_MDTSEL = 0x00000000;
 		SB_MDEN = 0x00000000;
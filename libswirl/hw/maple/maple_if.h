@@ -17,6 +17,15 @@
 
 extern maple_device* MapleDevices[4][6];
 
+// Totals since start
+struct MapleStats
+{
+	u64 dmas;
+	u64 decodes;		// of the dma list, the other dmas used the one decoded before
+};
+
+extern MapleStats maple_stats;
+
 struct SystemBus;
 struct ASIC;
 MMIODevice* Create_MapleDevice(SystemBus* sb, ASIC* asic);
@@ -411,6 +411,16 @@ bool _vmem_reserve(VLockedMemory* mram, VLockedMemory* vram, VLockedMemory* aica
 
 		mram->size = RAM_SIZE;
 		mram->data = &virt_ram_base[0x0C000000];   // Main memory, first mirror
+
+		// The other writable views, see VLockedMemory::AddMirror. The aica area 0 mirror is read only
+		for (u32 offset = RAM_SIZE; offset < 0x04000000; offset += RAM_SIZE)
+			mram->AddMirror(&virt_ram_base[0x0C000000 + offset], false);
+
+		for (u32 offset = VRAM_SIZE; offset < 0x01000000; offset += VRAM_SIZE)
+			vram->AddMirror(&virt_ram_base[0x04000000 + offset], offset == 0x800000);	// the texture cache locks the wrap
+
+		for (u32 offset = 0; offset < 0x01000000; offset += VRAM_SIZE)
+			vram->AddMirror(&virt_ram_base[0x06000000 + offset], false);
 	}
 
 	// Clear out memory
@@ -433,5 +443,14 @@ void _vmem_release(VLockedMemory* mram, VLockedMemory* vram, VLockedMemory* aica
 		freedefptr(aica_ram->data);
 		freedefptr(mram->data);
 	}
+
+	// Page lock bookkeeping, see VLockedMemory::LockRegion
+	VLockedMemory* mems[] = { mram, vram, aica_ram };
+	for (auto mem : mems)
+	{
+		free(mem->locked_pages);
+		mem->locked_pages = nullptr;
+		mem->mirror_count = 0;
+	}
 }
 
@@ -110,6 +110,11 @@ struct ModemDevice_impl : MMIODevice {
 
 	double last_dial_time;
 
+	// A byte the ppp side had no room for. TDBE stays clear until it's taken, so the dc waits
+	int tx_pending = -1;
+	// bytes written while one was pending, the dc didn't wait for TDBE
+	u32 tx_dropped = 0;
+
 #ifndef RELEASE
 	double last_comm_stats;
 	int sent_bytes;
@@ -125,9 +130,10 @@ struct ModemDevice_impl : MMIODevice {
 		{
 			if (last_comm_stats != 0)
 			{
-				printf("Stats sent %d (%.2f kB/s) received %d (%.2f kB/s) TDBE %d RDBF %d\n", sent_bytes, sent_bytes / 2000.0,
+				printf("Stats sent %d (%.2f kB/s) received %d (%.2f kB/s) TDBE %d RDBF %d, %u dropped\n", sent_bytes, sent_bytes / 2000.0,
 					recvd_bytes, recvd_bytes / 2000.0,
-					modem_regs.reg1e.TDBE, modem_regs.reg1e.RDBF);
+					modem_regs.reg1e.TDBE, modem_regs.reg1e.RDBF, tx_dropped);
+				tx_dropped = 0;
 				sent_bytes = 0;
 				recvd_bytes = 0;
 			}
@@ -275,7 +281,9 @@ struct ModemDevice_impl : MMIODevice {
 						SET_STATUS_BIT(0x01, modem_regs.reg01.RXHF, 1);
 					}
 				}
-				modem_regs.reg1e.TDBE = 1;
+				if (tx_pending >= 0 && write_pppd(tx_pending))
+					tx_pending = -1;
+				modem_regs.reg1e.TDBE = tx_pending < 0;
 				callback_cycles = SH4_MAIN_CLOCK / 1000000 * 238;	// 238 us
 
 				break;
@@ -330,6 +338,8 @@ struct ModemDevice_impl : MMIODevice {
 		modem_regs.reg1e.TDBE = 1;
 		connect_state = DISCONNECTED;
 		last_dial_time = 0;
+		tx_pending = -1;
+		tx_dropped = 0;
 	}
 	void DSPTestEnd()
 	{
@@ -489,7 +499,10 @@ struct ModemDevice_impl : MMIODevice {
 				if (sent_fp)
 					fputc(data, sent_fp);
 #endif
-				write_pppd(data);
+				if (tx_pending >= 0)
+					tx_dropped++;
+
+				tx_pending = write_pppd(data) ? -1 : (int)(data & 0xFF);
 				modem_regs.reg1e.TDBE = 0;
 			}
 			break;
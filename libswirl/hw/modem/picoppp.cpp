@@ -15,9 +15,14 @@
 #define _POSIX_SOURCE
 #endif
 
-#include <queue>
+#include <atomic>
 #include <map>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
 extern "C" {
 #include <pico_stack.h>
 #include <pico_dev_ppp.h>
@@ -30,6 +35,7 @@ extern "C" {
 #include "net_platform.h"
 
 #include "types.h"
+#include "oslib/oslib.h"
 #include "oslib/threading.h"
 #include "cfg/cfg.h"
 #include "picoppp.h"
@@ -37,13 +43,106 @@ extern "C" {
 #define RESOLVER1_OPENDNS_COM "208.67.222.222"
 #define AFO_ORIG_IP 0x83f2fb3f		// 63.251.242.131 in network order
 
+#define PPP_FLAG_BYTE 0x7e
+
+// stack ticks while bytes are moving, and when nothing happened for a while
+#define TICK_ACTIVE_MS 1
+#define TICK_IDLE_MS 10
+#define ACTIVE_TIMEOUT_MS 200
+
+/*
+	Single producer, single consumer byte ring between the emulated modem and the ppp stack.
+	The positions are free running, size is a power of two.
+*/
+template<u32 size>
+struct ByteRing
+{
+	u8 data[size];
+	std::atomic<u32> head;	// written by the producer
+	std::atomic<u32> tail;	// read by the consumer
+
+	void Reset()
+	{
+		head = 0;
+		tail = 0;
+	}
+
+	u32 Count() const
+	{
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+	// returns how many bytes fit
+	u32 Write(const u8* src, u32 len)
+	{
+		u32 h = head.load(std::memory_order_relaxed);
+		u32 space = size - (h - tail.load(std::memory_order_acquire));
+
+		if (len > space)
+			len = space;
+
+		u32 pos = h & (size - 1);
+		u32 first = min(len, size - pos);
+
+		memcpy(&data[pos], src, first);
+		memcpy(data, src + first, len - first);
+
+		head.store(h + len, std::memory_order_release);
+
+		return len;
+	}
+
+	u32 Read(u8* dst, u32 len)
+	{
+		u32 t = tail.load(std::memory_order_relaxed);
+		u32 avail = head.load(std::memory_order_acquire) - t;
+
+		if (len > avail)
+			len = avail;
+
+		u32 pos = t & (size - 1);
+		u32 first = min(len, size - pos);
+
+		memcpy(dst, &data[pos], first);
+		memcpy(dst + first, data, len - first);
+
+		tail.store(t + len, std::memory_order_release);
+
+		return len;
+	}
+};
+
 static struct pico_device *ppp;
 
-static std::queue<u8> in_buffer;
-static std::queue<u8> out_buffer;
+// ppp -> dreamcast, and dreamcast -> ppp
+static ByteRing<65536> in_buffer;
+static ByteRing<16384> out_buffer;
+
+// totals since the last report, only touched by the pico thread
+static struct
+{
+	u32 bytes_to_dc;
+	u32 bytes_from_dc;
+	u32 dropped;
+	u32 wakeups;
+	u32 ticks;
+	u32 frames;				// frame ends signalled by the modem
+	double latency;			// from the signal to the stack reading the frame, seconds
+	double max_latency;
+	double last_report;
+} pico_stats;
+
+static std::atomic<double> frame_signal_time;
+
+// write_pico calls that found out_buffer full, the modem holds the byte back
+static std::atomic<u32> out_full;
+
+#ifdef __linux__
+static int epoll_fd = -1;
+static std::atomic<int> wake_fd(-1);
+#endif
 
-static cMutex in_buffer_lock;
-static cMutex out_buffer_lock;
+static u32 last_activity;
 
 struct pico_ip4 dcaddr;
 struct pico_ip4 dnsaddr;
@@ -96,60 +195,165 @@ static void read_native_sockets();
 void get_host_by_name(const char *name, struct pico_ip4 dnsaddr);
 int get_dns_answer(struct pico_ip4 *address, struct pico_ip4 dnsaddr);
 
-static int modem_read(struct pico_device *dev, void *data, int len)
+/*
+	Native sockets are edge triggered, the thread wakes up when something arrives and
+	read_native_sockets then tries all of them. Whatever is left because the modem is behind
+	is picked up at the next tick. Closing a socket removes it from the set.
+*/
+static void watch_socket(sock_t fd, bool connecting = false)
 {
-	u8 *p = (u8 *)data;
+#ifdef __linux__
+	if (epoll_fd < 0)
+		return;
+
+	epoll_event ev = { };
+	ev.events = (connecting ? EPOLLOUT : EPOLLIN) | EPOLLET;
+	ev.data.fd = fd;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0
+			&& (errno != EEXIST || epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0))
+		perror("epoll_ctl");
+#endif
+}
+
+static void wake_pico()
+{
+#ifdef __linux__
+	int fd = wake_fd;
+
+	if (fd >= 0)
+	{
+		uint64_t one = 1;
+
+		if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+			perror("wake_pico");
+	}
+#endif
+}
+
+// Waits for a native socket, the modem or the next tick
+static void wait_events(u32 timeout_ms)
+{
+#ifdef __linux__
+	if (epoll_fd < 0)
+	{
+		usleep(1000);
+		return;
+	}
+
+	epoll_event events[16];
+	int n = epoll_wait(epoll_fd, events, 16, timeout_ms);
 
-	int count = 0;
-	out_buffer_lock.Lock();
-	while (!out_buffer.empty() && count < len)
+	for (int i = 0; i < n; i++)
 	{
-		*p++ = out_buffer.front();
-		out_buffer.pop();
-		count++;
+		if (events[i].data.fd != wake_fd)
+			continue;
+
+		uint64_t count;
+
+		if (read(wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+			perror("wake_fd");
 	}
-	out_buffer_lock.Unlock();
 
-    return count;
+	if (n > 0)
+	{
+		pico_stats.wakeups++;
+		last_activity = PICO_TIME_MS();
+	}
+#else
+	usleep(1000);
+#endif
 }
 
-static int modem_write(struct pico_device *dev, const void *data, int len)
+static int modem_read(struct pico_device *dev, void *data, int len)
 {
-	u8 *p = (u8 *)data;
+	u32 count = out_buffer.Read((u8*)data, len);
 
-	in_buffer_lock.Lock();
-	while (len > 0)
+	if (count > 0)
 	{
-		in_buffer.push(*p++);
-		len--;
+		pico_stats.bytes_from_dc += count;
+		last_activity = PICO_TIME_MS();
+
+		double signalled = frame_signal_time.exchange(0);
+
+		if (signalled != 0)
+		{
+			double latency = os_GetSeconds() - signalled;
+
+			pico_stats.frames++;
+			pico_stats.latency += latency;
+			pico_stats.max_latency = max(pico_stats.max_latency, latency);
+		}
 	}
-	in_buffer_lock.Unlock();
 
-    return len;
+	return count;
 }
 
-void write_pico(u8 b)
+static int modem_write(struct pico_device *dev, const void *data, int len)
 {
-	out_buffer_lock.Lock();
-	out_buffer.push(b);
-	out_buffer_lock.Unlock();
+	u32 count = in_buffer.Write((const u8*)data, len);
+
+	pico_stats.bytes_to_dc += count;
+	pico_stats.dropped += len - count;
+	last_activity = PICO_TIME_MS();
+
+	return count;
 }
 
-int read_pico()
+bool write_pico(u8 b)
 {
-	in_buffer_lock.Lock();
-	if (in_buffer.empty())
+	if (out_buffer.Write(&b, 1) == 0)
 	{
-		in_buffer_lock.Unlock();
-		return -1;
+		out_full++;
+
+		// the stack is behind, it should be reading
+		wake_pico();
+		return false;
+	}
+
+	// a flag starts or ends a frame, that is when the stack has something to do
+	if (b == PPP_FLAG_BYTE)
+	{
+		double expected = 0;
+
+		frame_signal_time.compare_exchange_strong(expected, os_GetSeconds());
+		wake_pico();
 	}
-	else
+
+	return true;
+}
+
+int read_pico()
+{
+	u8 b;
+
+	if (in_buffer.Read(&b, 1) == 0)
+		return -1;
+
+	return b;
+}
+
+static void report_stats()
+{
+#ifndef RELEASE
+	double now = os_GetSeconds();
+
+	if (now - pico_stats.last_report < 10)
+		return;
+
+	if (pico_stats.bytes_to_dc != 0 || pico_stats.bytes_from_dc != 0)
 	{
-		u32 b = in_buffer.front();
-		in_buffer.pop();
-		in_buffer_lock.Unlock();
-		return b;
+		double elapsed = now - pico_stats.last_report;
+
+		printf("picoppp: to dc %.2f kB/s, from dc %.2f kB/s, %u dropped, %u held back, %u wakeups, %u ticks, %u frames, latency avg %.3f ms max %.3f ms\n",
+			pico_stats.bytes_to_dc / elapsed / 1000, pico_stats.bytes_from_dc / elapsed / 1000, pico_stats.dropped, out_full.exchange(0),
+			pico_stats.wakeups, pico_stats.ticks, pico_stats.frames,
+			pico_stats.frames ? pico_stats.latency / pico_stats.frames * 1000 : 0.0, pico_stats.max_latency * 1000);
 	}
+
+	pico_stats = { };
+	pico_stats.last_report = now;
+#endif
 }
 
 void set_non_blocking(sock_t fd)
@@ -263,13 +467,17 @@ static void tcp_callback(uint16_t ev, struct pico_socket *s)
 						closesocket(sockfd);
 					}
 					else
+					{
 						tcp_connecting_sockets[sock_a] = sockfd;
+						watch_socket(sockfd, true);
+					}
 				}
 				else
 				{
 					set_tcp_nodelay(sockfd);
 
 					tcp_sockets[sock_a] = sockfd;
+					watch_socket(sockfd);
 				}
 			}
 		}
@@ -342,6 +550,7 @@ static sock_t find_udp_socket(uint16_t src_port)
 
 	// FIXME Need to clean up at some point?
 	udp_sockets[src_port] = sockfd;
+	watch_socket(sockfd);
 
 	return sockfd;
 }
@@ -424,6 +633,7 @@ static void read_native_sockets()
     	set_non_blocking(sockfd);
     	set_tcp_nodelay(sockfd);
     	tcp_sockets[ps] = sockfd;
+    	watch_socket(sockfd);
 	}
 
 	// Check connecting outbound TCP sockets
@@ -466,6 +676,7 @@ static void read_native_sockets()
 			{
 				set_tcp_nodelay(it->second);
 				tcp_sockets[it->first] = it->second;
+				watch_socket(it->second);
 
 				read_from_dc_socket(it->first, it->second);
 			}
@@ -477,10 +688,7 @@ static void read_native_sockets()
 	struct pico_msginfo msginfo;
 
 	// If modem buffer is full, wait
-	in_buffer_lock.Lock();
-	size_t in_buffer_size = in_buffer.size();
-	in_buffer_lock.Unlock();
-	if (in_buffer_size >= 256)
+	if (in_buffer.Count() >= 256)
 		return;
 
 	// Read UDP sockets
@@ -697,6 +905,25 @@ static void *pico_thread_func(void *)
     ppp = pico_ppp_create();
     if (!ppp)
         return NULL;
+
+#ifdef __linux__
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0)
+        perror("epoll_create1");
+    wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (wake_fd < 0)
+        perror("eventfd");
+    else
+    {
+        epoll_event ev = { };
+        ev.events = EPOLLIN;
+        ev.data.fd = wake_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+    }
+#endif
+    pico_stats = { };
+    pico_stats.last_report = os_GetSeconds();
+    last_activity = PICO_TIME_MS();
     pico_string_to_ipv4("192.168.167.2", &dcaddr.addr);
     pico_ppp_set_peer_ip(ppp, dcaddr);
     pico_string_to_ipv4("192.168.167.1", &ipaddr.addr);
@@ -770,6 +997,7 @@ static void *pico_thread_func(void *)
     	}
 		set_non_blocking(sockfd);
 		tcp_listening_sockets[port] = sockfd;
+		watch_socket(sockfd);
     }
 
     pico_ppp_set_serial_read(ppp, modem_read);
@@ -782,8 +1010,11 @@ static void *pico_thread_func(void *)
     {
     	read_native_sockets();
     	pico_stack_tick();
+    	pico_stats.ticks++;
     	check_dns_entries();
-    	usleep(1000);
+    	report_stats();
+
+    	wait_events(PICO_TIME_MS() - last_activity < ACTIVE_TIMEOUT_MS ? TICK_ACTIVE_MS : TICK_IDLE_MS);
     }
 
     for (auto it = tcp_listening_sockets.begin(); it != tcp_listening_sockets.end(); it++)
@@ -799,6 +1030,15 @@ static void *pico_thread_func(void *)
 	}
 	pico_stack_tick();
 
+#ifdef __linux__
+	int fd = wake_fd.exchange(-1);
+	if (fd >= 0)
+		close(fd);
+	if (epoll_fd >= 0)
+		close(epoll_fd);
+	epoll_fd = -1;
+#endif
+
 	return NULL;
 }
 
@@ -810,6 +1050,10 @@ static cThread pico_thread(pico_thread_func, NULL);
 
 bool start_pico()
 {
+	in_buffer.Reset();
+	out_buffer.Reset();
+	frame_signal_time = 0;
+
 	pico_thread_running = true;
 	pico_thread.Start();
 
@@ -819,6 +1063,7 @@ bool start_pico()
 void stop_pico()
 {
 	pico_thread_running = false;
+	wake_pico();
 	pico_thread.WaitToEnd();
 }
 
@@ -828,7 +1073,7 @@ void stop_pico()
 
 bool start_pico() { return false; }
 void stop_pico() { }
-void write_pico(u8 b) { }
+bool write_pico(u8 b) { return true; }
 int read_pico() { return -1; }
 
 #endif
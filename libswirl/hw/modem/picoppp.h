@@ -9,5 +9,6 @@
 
 bool start_pico();
 void stop_pico();
-void write_pico(u8 b);
+// false when the ppp side has no room, the byte wasn't taken
+bool write_pico(u8 b);
 int read_pico();
@@ -339,9 +339,49 @@ u16 AWCartridge::decrypt(u16 cipherText, u32 address, const u32 key)
 	return ((b3<<13)|(b2<<9)|(b1<<5)|b0)^(key&0xffff);
 }
 
+// decrypt() for a whole range, the bit swaps looked up a byte at a time
+void AWCartridge::decrypt_words(u8* dst, u32 offset, u32 size)
+{
+	const u8* pbox = permutation_table[rombd_key>>18];
+	const sbox_set* ss = &sboxes_table[(rombd_key>>16)&3];
+
+	const u8 text_swap_vec[] = {
+			pbox[15],pbox[14],pbox[13],pbox[12],pbox[11],pbox[10],pbox[9],pbox[8],
+			pbox[7],pbox[6],pbox[5],pbox[4],pbox[3],pbox[2],pbox[1],pbox[0] };
+	const u8 addr_swap_vec[] = { 13,5,2, 14,10,9,4, 15,11,6,1, 12,8,7,3,0 };
+
+	u16 text_lo[256], text_hi[256], addr_lo[256], addr_hi[256];
+
+	for (int i = 0; i < 256; i++)
+	{
+		text_lo[i] = bitswap16(i, text_swap_vec);
+		text_hi[i] = bitswap16(i << 8, text_swap_vec);
+		addr_lo[i] = bitswap16(i, addr_swap_vec);
+		addr_hi[i] = bitswap16(i << 8, addr_swap_vec);
+	}
+
+	const u16* src = (const u16*)(RomPtr + offset);
+	u16* out = (u16*)dst;
+
+	for (u32 i = 0; i < size / 2; i++)
+	{
+		u16 address = offset / 2 + i;
+		u16 aux = text_lo[src[i] & 0xff] ^ text_hi[src[i] >> 8] ^ addr_lo[address & 0xff] ^ addr_hi[address >> 8];
+
+		u8 b0 = ss->S0[aux & 0x1f];
+		u8 b1 = ss->S1[(aux >> 5) & 0xf];
+		u8 b2 = ss->S2[(aux >> 9) & 0xf];
+		u8 b3 = ss->S3[aux >> 13];
+
+		out[i] = ((b3<<13)|(b2<<9)|(b1<<5)|b0)^(rombd_key&0xffff);
+	}
+}
+
 
 void AWCartridge::Init()
 {
+	decrypted.Init(RomSize & ~1, [this](u8* dst, u32 offset, u32 size) { decrypt_words(dst, offset, size); });
+
 	mpr_offset = decrypt16(0x58/2) | (decrypt16(0x5a/2) << 16);
 	printf("AWCartridge::SetKey rombd_key %08x mpr_offset %08x\n", rombd_key, mpr_offset);
 	device_reset();
@@ -351,6 +391,7 @@ void AWCartridge::SetKey(u32 key)
 {
 	const u8 *krp = (u8 *)&key;
 	rombd_key = (krp[0] << 24) | (krp[1] << 16) | (krp[2] << 8) | krp[3];
+	decrypted.Invalidate();
 }
 
 void AWCartridge::device_reset()
@@ -396,6 +437,18 @@ void AWCartridge::recalc_dma_offset(int mode)
 
 void *AWCartridge::GetDmaPtr(u32 &limit)
 {
+	if (!(dma_offset & 1) && dma_offset < RomSize)
+	{
+		u32 size = std::min(limit, RomSize - dma_offset);
+		const u8* ptr = decrypted.Get(dma_offset, size);
+
+		if (ptr)
+		{
+			limit = size;
+			return (void*)ptr;
+		}
+	}
+
 	u32 offset = dma_offset / 2;
 	for (int i = 0; i < 16; i++)
 		decrypted_buf[i] = decrypt16(offset + i);
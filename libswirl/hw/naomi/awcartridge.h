@@ -20,6 +20,7 @@
 #define CORE_HW_NAOMI_AWCARTRIDGE_H_
 
 #include "naomi_cart.h"
+#include "decrypted_rom.h"
 
 class AWCartridge: public Cartridge
 {
@@ -47,6 +48,7 @@ private:
 	u32 epr_offset, mpr_file_offset;
 	u16 mpr_record_index, mpr_first_file_index;
 	u16 decrypted_buf[16];
+	DecryptedRom decrypted;
 
 	u32 dma_offset, dma_limit;
 
@@ -61,6 +63,7 @@ private:
 	static const sbox_set sboxes_table[4];
 	static u16 decrypt(u16 cipherText, u32 address, const u32 key);
 	u16 decrypt16(u32 address) { return decrypt(((u16 *)RomPtr)[address], address, rombd_key); }
+	void decrypt_words(u8* dst, u32 offset, u32 size);
 
 	void set_key();
 	void recalc_dma_offset(int mode);
@@ -0,0 +1,244 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#include <thread>
+#include <algorithm>
+#include "decrypted_rom.h"
+#include "stdclass.h"
+#include "oslib/threading.h"
+
+#ifdef _MSC_VER
+#include "dirent/dirent.h"
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <utime.h>
+#endif
+#include <sys/stat.h>
+
+#define DECRYPT_CACHE_MAGIC 0x43444E52	// "RNDC"
+#define DECRYPT_CACHE_VERSION 1
+#define DECRYPT_CACHE_PREFIX "decrypted_"
+// the least recently used images are removed past this, the last one saved is always kept
+#define DECRYPT_CACHE_MAX_SIZE (2048ull * 1024 * 1024)
+
+void DecryptedRom::Init(u32 size, DecryptFn decrypt)
+{
+	Term();
+
+	this->size = size;
+	this->decrypt = decrypt;
+
+	// the os only backs the pages that get decrypted
+	data = (u8*)malloc(size);
+	decrypted.assign((size + PAGE_SIZE - 1) >> PAGE_SHIFT, false);
+}
+
+void DecryptedRom::Term()
+{
+	free(data);
+	data = NULL;
+	size = 0;
+	decrypted.clear();
+}
+
+void DecryptedRom::Invalidate()
+{
+	decrypted.assign(decrypted.size(), false);
+}
+
+const u8* DecryptedRom::Get(u32 offset, u32 size)
+{
+	if (data == NULL || offset > this->size || size > this->size - offset)
+		return NULL;
+
+	if (size == 0)
+		return data + offset;
+
+	for (u32 page = offset >> PAGE_SHIFT; page <= (offset + size - 1) >> PAGE_SHIFT; page++)
+	{
+		if (decrypted[page])
+			continue;
+
+		u32 start = page << PAGE_SHIFT;
+
+		decrypt(data + start, start, std::min((u32)PAGE_SIZE, this->size - start));
+		decrypted[page] = true;
+	}
+
+	return data + offset;
+}
+
+struct DecryptWorker
+{
+	const std::function<void(u32, u32)>* func;
+	u32 start;
+	u32 end;
+
+	static void* run(void* param)
+	{
+		DecryptWorker* w = (DecryptWorker*)param;
+
+		(*w->func)(w->start, w->end);
+
+		return NULL;
+	}
+};
+
+void decrypt_parallel(u32 count, const std::function<void(u32, u32)>& func)
+{
+	u32 threads = std::max(1u, std::min(std::thread::hardware_concurrency(), 16u));
+
+	if (threads == 1 || count < threads)
+	{
+		func(0, count);
+		return;
+	}
+
+	DecryptWorker workers[16];
+	vector<cThread*> started;
+
+	for (u32 i = 0; i < threads; i++)
+	{
+		workers[i].func = &func;
+		workers[i].start = (u64)count * i / threads;
+		workers[i].end = (u64)count * (i + 1) / threads;
+	}
+
+	// the calling thread does the first part
+	for (u32 i = 1; i < threads; i++)
+	{
+		started.push_back(new cThread(&DecryptWorker::run, &workers[i]));
+		started.back()->Start();
+	}
+
+	DecryptWorker::run(&workers[0]);
+
+	for (size_t i = 0; i < started.size(); i++)
+		delete started[i];	// waits for it
+}
+
+static string decrypt_cache_path(u64 hash)
+{
+	char name[64];
+	sprintf(name, DATA_PATH DECRYPT_CACHE_PREFIX "%016llx.bin", (unsigned long long)hash);
+
+	return get_writable_data_path(name);
+}
+
+bool decrypt_cache_load(u64 hash, u8* dst, u32 size)
+{
+	string path = decrypt_cache_path(hash);
+	FILE* f = fopen(path.c_str(), "rb");
+
+	if (f == NULL)
+		return false;
+
+	// dst holds the encrypted data, it is only overwritten by a file that has all of it
+	u32 header[3];
+	bool ok = fread(header, sizeof(header), 1, f) == 1
+		&& header[0] == DECRYPT_CACHE_MAGIC && header[1] == DECRYPT_CACHE_VERSION && header[2] == size
+		&& fseek(f, 0, SEEK_END) == 0 && ftell(f) == (long)(sizeof(header) + size)
+		&& fseek(f, sizeof(header), SEEK_SET) == 0
+		&& fread(dst, size, 1, f) == 1;
+
+	fclose(f);
+
+	if (!ok)
+		printf("Decrypt cache: %s is invalid, ignoring it\n", path.c_str());
+	else
+		utime(path.c_str(), NULL);	// the mtime is the last use, for the eviction
+
+	return ok;
+}
+
+struct DecryptCacheFile
+{
+	string name;
+	string path;
+	u64 size;
+	time_t mtime;
+};
+
+// Removes the least recently used images until the cache fits in DECRYPT_CACHE_MAX_SIZE
+static void decrypt_cache_evict(const string& keep)
+{
+	size_t slash = keep.find_last_of("/\\");
+	string dir_path = slash == string::npos ? "." : keep.substr(0, slash);
+	string keep_name = keep.substr(slash + 1);	// npos + 1 is 0
+
+	DIR* dir = opendir(dir_path.c_str());
+
+	if (dir == NULL)
+		return;
+
+	vector<DecryptCacheFile> files;
+	u64 total = 0;
+
+	while (struct dirent* entry = readdir(dir))
+	{
+		string name(entry->d_name);
+
+		if (name.compare(0, strlen(DECRYPT_CACHE_PREFIX), DECRYPT_CACHE_PREFIX) != 0)
+			continue;
+
+		DecryptCacheFile file;
+		file.name = name;
+		file.path = dir_path + "/" + name;
+
+		struct stat st;
+		if (stat(file.path.c_str(), &st) != 0)
+			continue;
+
+		file.size = st.st_size;
+		file.mtime = st.st_mtime;
+
+		total += file.size;
+		files.push_back(file);
+	}
+
+	closedir(dir);
+
+	std::sort(files.begin(), files.end(), [](const DecryptCacheFile& a, const DecryptCacheFile& b) { return a.mtime < b.mtime; });
+
+	for (size_t i = 0; i < files.size() && total > DECRYPT_CACHE_MAX_SIZE; i++)
+	{
+		if (files[i].name == keep_name)
+			continue;
+
+		if (remove(files[i].path.c_str()) == 0)
+		{
+			printf("Decrypt cache: removed %s\n", files[i].path.c_str());
+			total -= files[i].size;
+		}
+	}
+}
+
+void decrypt_cache_save(u64 hash, const u8* src, u32 size)
+{
+	string path = decrypt_cache_path(hash);
+	FILE* f = fopen(path.c_str(), "wb");
+
+	if (f == NULL)
+	{
+		printf("Decrypt cache: can't write %s\n", path.c_str());
+		return;
+	}
+
+	u32 header[3] = { DECRYPT_CACHE_MAGIC, DECRYPT_CACHE_VERSION, size };
+	bool ok = fwrite(header, sizeof(header), 1, f) == 1 && fwrite(src, size, 1, f) == 1;
+
+	fclose(f);
+
+	if (!ok)
+	{
+		printf("Decrypt cache: can't write %s\n", path.c_str());
+		remove(path.c_str());
+		return;
+	}
+
+	decrypt_cache_evict(path);
+}
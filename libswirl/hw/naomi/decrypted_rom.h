@@ -0,0 +1,48 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#pragma once
+#include "types.h"
+#include <functional>
+
+/*
+	Decrypted copy of an encrypted cartridge rom. It is decrypted 64 KB at a time on first use,
+	after that dma reads are plain copies out of it.
+*/
+class DecryptedRom
+{
+public:
+	// decrypts size bytes at offset into dst, offset is a multiple of the page size
+	typedef std::function<void(u8* dst, u32 offset, u32 size)> DecryptFn;
+
+	DecryptedRom() : data(NULL), size(0) { }
+	~DecryptedRom() { Term(); }
+
+	void Init(u32 size, DecryptFn decrypt);
+	void Term();
+
+	// The key changed, everything is decrypted again
+	void Invalidate();
+
+	// size bytes at offset, NULL if that goes past the end of the rom
+	const u8* Get(u32 offset, u32 size);
+
+private:
+	enum { PAGE_SHIFT = 16, PAGE_SIZE = 1 << PAGE_SHIFT };
+
+	u8* data;
+	u32 size;
+	vector<bool> decrypted;
+	DecryptFn decrypt;
+};
+
+// Runs func(start, end) over [0, count) split between the host's cores, on a thread each
+void decrypt_parallel(u32 count, const std::function<void(u32, u32)>& func);
+
+// Decrypted images saved in the data directory, for the ones that take long to decrypt. Off by
+// default, Naomi.DecryptCache
+bool decrypt_cache_load(u64 hash, u8* dst, u32 size);
+void decrypt_cache_save(u64 hash, const u8* src, u32 size);
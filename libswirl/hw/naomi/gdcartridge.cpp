@@ -18,6 +18,9 @@
  */
 
 #include "gdcartridge.h"
+#include "decrypted_rom.h"
+#include "oslib/oslib.h"
+#include "deps/xxhash/xxhash.h"
 
 /*
 
@@ -396,22 +399,6 @@ u64 GDCartridge::rev64(u64 src)
 	return ret;
 }
 
-u64 GDCartridge::read_to_qword(const u8 *region)
-{
-	u64 ret = 0;
-
-	for(int i=0;i<8;i++)
-		ret |= u64(region[i]) << (56-(8*i));
-
-	return ret;
-}
-
-void GDCartridge::write_from_qword(u8 *region, u64 qword)
-{
-	for(int i=0;i<8;i++)
-		region[i] = qword >> (56-(i*8));
-}
-
 void GDCartridge::find_file(const char *name, const u8 *dir_sector, u32 &file_start, u32 &file_size)
 {
 	file_start = 0;
@@ -574,16 +561,45 @@ void GDCartridge::device_start()
 			if (dimm_data_size != file_rounded_size)
 				memset(dimm_data + file_rounded_size, 0, dimm_data_size - file_rounded_size);
 
+			double start = os_GetSeconds();
+
 			// read encrypted data into dimm_data
-			u32 sectors = file_rounded_size / 2048;
-			for (u32 sec = 0; sec != sectors; sec++)
-				read_gdrom(gdrom, file_start + sec, dimm_data + 2048 * sec);
+			gdrom->ReadSectors(file_start + 150, file_rounded_size / 2048, dimm_data, 2048);
 
-			u32 des_subkeys[32];
-			des_generate_subkeys(rev64(key), des_subkeys);
+			u64 hash = 0;
 
-			for (int i = 0; i < file_rounded_size; i += 8)
-				write_from_qword(dimm_data + i, rev64(des_encrypt_decrypt(true, rev64(read_to_qword(dimm_data + i)), des_subkeys)));
+			if (settings.naomi.DecryptCache)
+			{
+				// the pic, where the file is and all of the encrypted data tell the cached images apart,
+				// hashing is cheap next to des
+				hash = XXH64(RomPtr, RomSize, 0);
+				hash = XXH64(gdrom_name, strlen(gdrom_name), hash);
+				hash = XXH64(&file_start, sizeof(file_start), hash);
+				hash = XXH64(&file_size, sizeof(file_size), hash);
+				hash = XXH64(dimm_data, file_rounded_size, hash);
+			}
+
+			if (settings.naomi.DecryptCache && decrypt_cache_load(hash, dimm_data, file_rounded_size))
+			{
+				printf("Naomi GDROM: decrypted data from the cache in %.2f s\n", os_GetSeconds() - start);
+			}
+			else
+			{
+				u32 des_subkeys[32];
+				des_generate_subkeys(rev64(key), des_subkeys);
+
+				// des in ecb mode, the blocks are independent. loaded and stored little endian
+				decrypt_parallel(file_rounded_size / 8, [&](u32 first, u32 last) {
+					u64* block = (u64 *)dimm_data;
+					for (u32 i = first; i < last; i++)
+						block[i] = des_encrypt_decrypt(true, block[i], des_subkeys);
+				});
+
+				printf("Naomi GDROM: %d KB decrypted in %.2f s\n", file_rounded_size / 1024, os_GetSeconds() - start);
+
+				if (settings.naomi.DecryptCache)
+					decrypt_cache_save(hash, dimm_data, file_rounded_size);
+			}
 		}
 
 		// decrypt loaded data
@@ -72,8 +72,6 @@ private:
 	void des_generate_subkeys(const u64 key, u32 *subkeys);
 	u64 des_encrypt_decrypt(bool decrypt, u64 src, const u32 *des_subkeys);
 	u64 rev64(u64 src);
-	u64 read_to_qword(const u8 *region);
-	void write_from_qword(u8 *region, u64 qword);
 	void read_gdrom(Disc *gdrom, u32 sector, u8* dst);
 };
 
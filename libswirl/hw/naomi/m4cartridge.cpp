@@ -65,6 +65,8 @@ void M4Cartridge::device_start()
 	subkey2 = (m_key_data[0x5e6] << 8) | m_key_data[0x5e4];
 
 	enc_init();
+
+	decrypted.Init(RomSize & ~1, [this](u8* dst, u32 offset, u32 size) { decrypt_blocks(dst, offset, size); });
 }
 
 void M4Cartridge::enc_init()
@@ -184,6 +186,21 @@ void *M4Cartridge::GetDmaPtr(u32 &limit)
 	}
 	if (encryption)
 	{
+		// straight from the decrypted rom, the buffer holds the start of the same data
+		u32 pos = rom_cur_address - buffer_actual_size;
+
+		if ((rom_cur_address - counter * 2) % 32 == 0 && pos < RomSize)
+		{
+			u32 size = std::min(limit, RomSize - pos);
+			const u8* ptr = decrypted.Get(pos, size);
+
+			if (ptr)
+			{
+				limit = size;
+				return (void*)ptr;
+			}
+		}
+
 		limit = std::min(limit, (u32)sizeof(buffer));
 		return buffer;
 
@@ -213,7 +230,14 @@ void M4Cartridge::AdvancePtr(u32 size)
 			buffer_actual_size -= size;
 		}
 		else
+		{
+			// past the end of the buffer, after a dma from the decrypted rom
+			u32 skip = size - buffer_actual_size;
+
+			rom_cur_address += skip;
+			counter = (counter + skip / 2) % 16;
 			buffer_actual_size = 0;
+		}
 		enc_fill();
 	}
 	else
@@ -232,8 +256,60 @@ u16 M4Cartridge::decrypt_one_round(u16 word, u16 subkey)
 	return one_round[word ^ subkey] ^ subkey ;
 }
 
+// Whole rom, decrypted as one transfer from 0: the iv goes back to 0 every 32 bytes
+void M4Cartridge::decrypt_blocks(u8* dst, u32 offset, u32 size)
+{
+	const u8* src = RomPtr + offset;
+	u16 iv = 0;
+
+	for (u32 i = 0; i < size; i += 2)
+	{
+		if ((i & 31) == 0)
+			iv = 0;
+
+		u16 enc = src[i] | (src[i + 1] << 8);
+		u16 dec = iv;
+		iv = one_round[enc ^ iv ^ subkey1] ^ subkey1;
+		dec ^= one_round[iv ^ subkey2] ^ subkey2;
+
+		dst[i] = dec;
+		dst[i + 1] = dec >> 8;
+	}
+}
+
+// The rest of the buffer copied from the decrypted rom, if the transfer lines up with it
+bool M4Cartridge::enc_fill_decrypted()
+{
+	u32 size = sizeof(buffer) - buffer_actual_size;
+
+	if ((rom_cur_address - counter * 2) % 32 != 0 || (size & 1))
+		return false;
+
+	const u8* src = decrypted.Get(rom_cur_address, size);
+
+	if (src == NULL)
+		return false;
+
+	memcpy(buffer + buffer_actual_size, src, size);
+
+	buffer_actual_size += size;
+	rom_cur_address += size;
+	counter = (counter + size / 2) % 16;
+
+	// the iv as enc_fill leaves it, for save states
+	const u8* base = RomPtr + rom_cur_address - counter * 2;
+	iv = 0;
+	for (u32 i = 0; i < counter; i++)
+		iv = decrypt_one_round((base[i * 2] | (base[i * 2 + 1] << 8)) ^ iv, subkey1);
+
+	return true;
+}
+
 void M4Cartridge::enc_fill()
 {
+	if (enc_fill_decrypted())
+		return;
+
 	const u8 *base = RomPtr + rom_cur_address;
 	while (buffer_actual_size < sizeof(buffer))
 	{
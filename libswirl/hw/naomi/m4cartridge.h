@@ -21,6 +21,7 @@
 
 #include "naomi_cart.h"
 #include "naomi_regs.h"
+#include "decrypted_rom.h"
 
 class M4Cartridge: public NaomiCartridge {
 public:
@@ -73,6 +74,9 @@ private:
 	u16 subkey1, subkey2;
 	u16 one_round[0x10000];
 
+	// the whole rom as a transfer from 0 decrypts it, transfers starting on a block line up with it
+	DecryptedRom decrypted;
+
 	u8 buffer[32768];
 	u32 rom_cur_address, buffer_actual_size;
 	u16 iv;
@@ -84,7 +88,9 @@ private:
 	void enc_init();
 	void enc_reset();
 	void enc_fill();
+	bool enc_fill_decrypted();
 	u16 decrypt_one_round(u16 word, u16 subkey);
+	void decrypt_blocks(u8* dst, u32 offset, u32 size);
 };
 
 #endif /* CORE_HW_NAOMI_M4CARTRIDGE_H_ */
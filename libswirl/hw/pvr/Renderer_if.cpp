@@ -18,6 +18,7 @@
 #include "deps/crypto/md5.h"
 
 #include "scripting/lua_bindings.h"
+#include "input/input_latency.h"
 
 #include <memory>
 #include <atomic>
@@ -89,12 +90,14 @@ FILE* fCheckFrames;
 */
 
 u32 VertexCount=0;
+u64 VertexCountTotal=0;
 u32 FrameCount=1;
 
 static unique_ptr<Renderer> renderer;
 static unique_ptr<Renderer> fallback_renderer;
 //bool renderer_enabled = true;	// Signals the renderer thread to exit
 bool renderer_changed = false;	// Signals the renderer thread to switch renderer
+bool rend_skip_frames = false;
 
 static atomic<bool> pend_rend(false);
 static cResetEvent rs, re;
@@ -430,7 +433,10 @@ void rend_start_render(u8* vram)
 			{
 				palette_update();
 
+				u32 latency_frame = latency_frame_queued(ctx->tad.thd_root, (u32)(ctx->tad.End() - ctx->tad.thd_root));
+
                 g_GUIRenderer->QueueEmulatorFrame([=](){
+                    latency_frame_rendered(latency_frame);
 
                     _pvrrc = DequeueRender();
                     
@@ -462,7 +468,7 @@ void rend_start_render(u8* vram)
 			tactx_Recycle(ctx);
 		}
 	}
-	else
+	else if (!rend_skip_frames)
 	{
 		SetREP(nullptr);
 		palette_update();
@@ -501,13 +507,24 @@ void rend_end_render()
 	}
 }
 
+void rend_wait_rtt()
+{
+	if (pend_rend) {
+		re.Wait();
+		pend_rend = false;
+	}
+}
+
 void rend_vblank()
 {
+	vramlock_FrameTick();
+	vramwb_Apply();
+
 	#if FEAT_TA == TA_HLE
-		if (!render_called && fb_dirty && FB_R_CTRL.fb_enable)
+		if (!render_called && fb_dirty && FB_R_CTRL.fb_enable && !rend_skip_frames)
 	#else
 		fb_dirty = true;
-		if (fb_dirty && FB_R_CTRL.fb_enable)
+		if (fb_dirty && FB_R_CTRL.fb_enable && !rend_skip_frames)
 	#endif
 	{
         fb_dirty = false;
@@ -9,6 +9,7 @@
 #include "ta_ctx.h"
 
 extern u32 VertexCount;
+extern u64 VertexCountTotal;	// VertexCount is reset by the fps counter, this one isn't
 extern u32 FrameCount;
 
 
@@ -18,6 +19,8 @@ void rend_vblank();
 
 void rend_start_render(u8* vram);
 void rend_end_render();
+// Waits for the render to texture in flight, if any, to write its result to vram
+void rend_wait_rtt();
 
 void rend_set_fb_scale(float x,float y);
 void rend_resize(int width, int height);
@@ -58,6 +61,7 @@ struct Renderer
 	virtual ~Renderer() { }
 };
 
+extern bool rend_skip_frames;	// Drops frames that are never shown, render to texture still goes through
 extern bool renderer_enabled;	// Signals the renderer thread to exit
 extern bool renderer_changed;	// Signals the renderer thread to switch renderer
 
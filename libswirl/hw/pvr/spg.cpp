@@ -12,6 +12,11 @@
 #include "hw/holly/holly_intc.h"
 #include "oslib/oslib.h"
 #include "hw/sh4/sh4_sched.h"
+#include "rend/TexCache.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "benchmark.h"
+#include "scripting/lua_bindings.h"
 
 //SPG emulation; Scanline/Raster beam registers & interrupts
 //Time to emulate that stuff correctly ;)
@@ -53,6 +58,7 @@ void SetREP(TA_context* cntx)
     if (cntx && !cntx->rend.Overrun)
     {
         VertexCount += cntx->rend.verts.used();
+        VertexCountTotal += cntx->rend.verts.used();
         PVR_VTXC += cntx->rend.verts.used();
         int render_end_pending_cycles = cntx->rend.verts.used() * 60;
         //if (render_end_pending_cycles<500000)
@@ -167,6 +173,12 @@ struct SPG_impl final : SPG {
                 asic->RaiseInterrupt(holly_HBLank);// -> This turned out to be HBlank btw , needs to be emulated ;(
                 //TODO : rend_if_VBlank();
                 rend_vblank();//notify for vblank :)
+                rewind_vblank();
+                runahead_vblank();
+                bench_vblank();
+#ifdef SCRIPTING
+                luabindings_onframe();
+#endif
 
                 if ((os_GetSeconds() - last_fps) > 2)
                 {
@@ -216,11 +228,11 @@ struct SPG_impl final : SPG {
                     full_rps = (spd_fps + fskip / ts);
 
                     char temp[2048];
-                    snprintf(temp, 2048, "%s/%c - %4.2f - %4.2f - V: %4.2f (%.2f, %s%s%4.2f) R: %4.2f+%4.2f VTX: %4.2f%c, MIPS: %.2f",
+                    snprintf(temp, 2048, "%s/%c - %4.2f - %4.2f - V: %4.2f (%.2f, %s%s%4.2f) R: %4.2f+%4.2f VTX: %4.2f%c, MIPS: %.2f, VF: %u",
                         VER_SHORTNAME, 'n', mspdf, spd_cpu * 100 / 200, spd_vbs,
                         spd_vbs / full_rps, mode, res, fullvbs,
                         spd_fps, fskip / ts
-                        , mv, mv_c, mips_counter / 1024.0 / 1024.0);
+                        , mv, mv_c, mips_counter / 1024.0 / 1024.0, vramlock_stats.last_frame_faults);
                     mips_counter = 0;
 
                     os_SetWindowText(temp);
@@ -8,6 +8,7 @@
 #include "ta_ctx.h"
 
 #include "hw/sh4/sh4_sched.h"
+#include "Renderer_if.h"
 
 extern u32 fskip;
 extern u32 FrameCount;
@@ -15,11 +16,16 @@ extern u32 FrameCount;
 int frameskip=0;
 bool FrameSkipping=false;		// global switch to enable/disable frameskip
 
-TA_context* ta_ctx;
-tad_context ta_tad;
+TA_state* p_tastate;
 
-TA_context*  vd_ctx;
-rend_context vd_rc;
+#define mtx_rqueue (p_tastate->mtx_rqueue)
+#define rqueue (p_tastate->rqueue)
+#define frame_finished (p_tastate->frame_finished)
+#define last_frame (p_tastate->last_frame)
+#define last_cyces (p_tastate->last_cyces)
+#define mtx_pool (p_tastate->mtx_pool)
+#define ctx_pool (p_tastate->ctx_pool)
+#define ctx_list (p_tastate->ctx_list)
 
 #if ANDROID
 #include <errno.h>
@@ -128,13 +134,6 @@ void VDecEnd()
 	vd_ctx = 0;
 }
 
-cMutex mtx_rqueue;
-TA_context* rqueue;
-cResetEvent frame_finished;
-
-double last_frame = 0;
-u64 last_cyces = 0;
-
 bool QueueRender(TA_context* ctx)
 {
 	verify(ctx != 0);
@@ -145,6 +144,11 @@ bool QueueRender(TA_context* ctx)
 		fskip++;
 		return false;
  	}
+
+	if (rend_skip_frames && !ctx->rend.isRTT) {
+		tactx_Recycle(ctx);
+		return false;
+	}
  	
  	//Try to limit speed to a "sane" level
  	//Speed is also limited via audio, but audio
@@ -195,6 +199,9 @@ TA_context* DequeueRender()
 }
 
 bool rend_framePending() {
+	if (!p_tastate)
+		return false;
+
 	mtx_rqueue.Lock();
 	TA_context* rv = rqueue;
 	mtx_rqueue.Unlock();
@@ -214,11 +221,6 @@ void FinishRender(TA_context* ctx)
 	frame_finished.Set();
 }
 
-cMutex mtx_pool;
-
-vector<TA_context*> ctx_pool;
-vector<TA_context*> ctx_list;
-
 TA_context* tactx_Alloc()
 {
 	TA_context* rv = 0;
@@ -301,6 +303,10 @@ TA_context* tactx_Pop(u32 addr)
 
 void tactx_Term()
 {
+	// no machine, or it has been destroyed already
+	if (!p_tastate)
+		return;
+
 	for (size_t i = 0; i < ctx_list.size(); i++)
 	{
 		ctx_list[i]->Free();
@@ -251,11 +251,36 @@ struct TA_context
 };
 
 
-extern TA_context* ta_ctx;
-extern tad_context ta_tad;
+/*
+	TA and render queue state of one emulated machine, owned by its VirtualDreamcast.
+	p_tastate points to the one that is running
+*/
+struct TA_state
+{
+	TA_context* ta_ctx;
+	tad_context ta_tad;
+
+	TA_context*  vd_ctx;
+	rend_context vd_rc;
+
+	cMutex mtx_rqueue;
+	TA_context* rqueue;
+	cResetEvent frame_finished;
+
+	double last_frame;
+	u64 last_cyces;
+
+	cMutex mtx_pool;
+	vector<TA_context*> ctx_pool;
+	vector<TA_context*> ctx_list;
+};
+
+extern TA_state* p_tastate;
 
-extern TA_context*  vd_ctx;
-extern rend_context vd_rc;
+#define ta_ctx (p_tastate->ta_ctx)
+#define ta_tad (p_tastate->ta_tad)
+#define vd_ctx (p_tastate->vd_ctx)
+#define vd_rc (p_tastate->vd_rc)
 
 TA_context* tactx_Find(u32 addr, bool allocnew=false);
 TA_context* tactx_Pop(u32 addr);
@@ -37,6 +37,8 @@ bm_List all_blocks;
 bm_List del_blocks;
 
 bm_List page_blocks[RAM_SIZE/REI_PAGE_SIZE];
+
+u64 bm_compiled_blocks;
 bool	page_has_data[RAM_SIZE/REI_PAGE_SIZE];
 
 std::map<void*, RuntimeBlockInfo*> blkmap;
@@ -125,6 +127,7 @@ void bm_AddBlock(RuntimeBlockInfo* blk, bool lockRam)
 	}
 	blkmap[(void*)blk->code] = blk;
 	all_blocks.insert(blk);
+	bm_compiled_blocks++;
 
 	verify((void*)bm_GetCode(blk->addr)==(void*)rdv_ngen->FailedToFindBlock);
 	FPCA(blk->addr) = (DynarecCodeEntryPtr)CC_RW2RX(blk->code);
@@ -350,21 +353,10 @@ bool bm_LockedWrite(u8* addy)
 	{
 		u32 ram_offset = offset & RAM_MASK;
 		u32 ram_page = ram_offset / REI_PAGE_SIZE;
-		u32 ram_obase = ram_page * REI_PAGE_SIZE;
 
 		printf_bm("BM_LW: Pagefault @ %p %08X %08X\n", addy, ram_offset, ram_page);
 
-		page_has_data[ram_page] = true;
-
-		// Make a local copy so we can remove from the page_blocks list while iterating
-		auto list = page_blocks[ram_page];
-
-		for (auto it = list.begin(); it != list.end(); it++)
-		{
-			bm_DiscardBlock(*it);
-		}
-
-		sh4_cpu->mram.UnLockRegion(ram_obase, REI_PAGE_SIZE);
+		bm_DiscardRamPage(ram_page);
 
 		return true;
 	}
@@ -372,6 +364,21 @@ bool bm_LockedWrite(u8* addy)
 		return false;
 }
 
+void bm_DiscardRamPage(u32 ram_page)
+{
+	page_has_data[ram_page] = true;
+
+	// Make a local copy so we can remove from the page_blocks list while iterating
+	auto list = page_blocks[ram_page];
+
+	for (auto it = list.begin(); it != list.end(); it++)
+	{
+		bm_DiscardBlock(*it);
+	}
+
+	sh4_cpu->mram.UnLockRegion(ram_page * REI_PAGE_SIZE, REI_PAGE_SIZE);
+}
+
 bool bm_RamPageHasData(u32 guest_addr, u32 len)
 {
 	auto page_base = (guest_addr & RAM_MASK)/REI_PAGE_SIZE;
@@ -122,6 +122,10 @@ void bm_vmem_pagefill(void** ptr,u32 PAGE_SZ);
 
 void bm_sh4_jitsym(FILE* out);
 bool bm_LockedWrite(u8* addy);
+// Drops the blocks compiled from a main ram page and unlocks it, before the page is overwritten
+void bm_DiscardRamPage(u32 ram_page);
 bool bm_RamPageHasData(u32 guest_addr, u32 len);
 
-void bm_CleanupDeletedBlocks();
\ No newline at end of file
+void bm_CleanupDeletedBlocks();
+
+extern u64 bm_compiled_blocks;	// blocks added since start, never reset
\ No newline at end of file
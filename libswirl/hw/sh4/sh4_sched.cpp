@@ -28,13 +28,11 @@
 	sh4_sched_now()
 
 */
-u64 sh4_sched_ffb;
-u32 sh4_sched_intr;
+Sh4SchedContext* p_sh4sched;
 
-
-vector<sched_list> sch_list;	// using list as external inside a macro confuses clang and msc
-
-int sh4_sched_next_id=-1;
+#define sch_list (p_sh4sched->list)
+#define sh4_sched_next_id (p_sh4sched->next_id)
+#define sh4_sched_ffb (p_sh4sched->ffb)
 
 u32 sh4_sched_remaining(int id, u32 reference)
 {
@@ -144,6 +142,7 @@ void handle_cb(int id)
 	int jitter=elapsd-remain;
 
 	sch_list[id].end=-1;
+	sh4_sched_callbacks++;
 	int re_sch=sch_list[id].cb(sch_list[id].context, sch_list[id].tag,remain,jitter);
 
 	if (re_sch > 0)
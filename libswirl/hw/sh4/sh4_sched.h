@@ -59,8 +59,6 @@ void sh4_sched_cleanup();
 void sh4_sched_serialize(void** data, unsigned int* total_size);
 void sh4_sched_unserialize(void** data, unsigned int* total_size);
 
-extern u32 sh4_sched_intr;
-
 struct sched_list
 {
 	sh4_sched_callback* cb;
@@ -68,4 +66,22 @@ struct sched_list
 	int tag;
 	int start;
 	int end;
-};
\ No newline at end of file
+};
+
+/*
+	Scheduler state of one emulated machine, owned by its VirtualDreamcast.
+	p_sh4sched points to the one that is running
+*/
+struct Sh4SchedContext
+{
+	vector<sched_list> list;
+	int next_id = -1;
+	u64 ffb = 0;
+	u32 intr = 0;
+	u64 callbacks = 0;		// callbacks run since start, never reset
+};
+
+extern Sh4SchedContext* p_sh4sched;
+
+#define sh4_sched_intr (p_sh4sched->intr)
+#define sh4_sched_callbacks (p_sh4sched->callbacks)
\ No newline at end of file
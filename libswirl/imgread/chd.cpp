@@ -5,38 +5,227 @@
 
 
 #include "imgread_common.h"
+#include "oslib/threading.h"
+#include "oslib/oslib.h"
+#include "hw/StaticForward.h"
 
 #include "deps/chdr/chd.h"
 
 /* tracks are padded to a multiple of this many frames */
 const uint32_t CD_TRACK_PADDING = 4;
 
+ChdCacheStats chd_cache_stats;
+
+/*
+	Decompressed hunks are kept in a small LRU cache. The drive tells the disc what it is
+	about to read (ReadAhead), and a thread decompresses those hunks before they are asked for.
+	libchdr isn't thread safe, chd_lock serializes all chd_read calls
+*/
+struct CHDHunk
+{
+	u32 hunk;
+	u32 last_use;
+	bool prefetched;	// by the read-ahead thread, and not read yet
+	u8* data;
+};
+
+struct CHDTrack;
+
 struct CHDDisc : Disc
 {
 	chd_file* chd;
-	u8* hunk_mem;
-	u32 old_hunk;
 
 	u32 hunkbytes;
 	u32 sph;
 
-	CHDDisc()
+	vector<CHDHunk> cache;
+	u32 use_clock;
+
+	cMutex lock;			// cache and pending
+	cMutex chd_lock;
+
+	cThread prefetch_thread;
+	cResetEvent prefetch_wake;
+	vector<u32> pending;	// hunks to read ahead, in order
+	bool prefetch_exit;
+
+	CHDDisc() : prefetch_thread(STATIC_FORWARD(CHDDisc, prefetch_loop), this)
 	{
 		chd=0;
-		hunk_mem=0;
+		use_clock=0;
+		prefetch_exit=false;
 	}
 
 	bool TryOpen(const wchar* file);
 
+	// Copies a sector out of the cache, decompressing its hunk first on a miss
+	void ReadHunk(u32 hunk, u32 hunk_ofs, u8* dst, u32 size)
+	{
+		lock.Lock();
+
+		CHDHunk* slot = find(hunk);
+
+		if (slot == nullptr)
+		{
+			double start = os_GetSeconds();
+
+			// The read-ahead thread may be decompressing this very hunk, wait for it and look again
+			lock.Unlock();
+			chd_lock.Lock();
+			lock.Lock();
+
+			slot = find(hunk);
+
+			if (slot == nullptr)
+			{
+				slot = evict();
+				chd_read(chd, hunk, slot->data); //CHDERR_NONE
+				fill(slot, hunk, false);
+
+				chd_cache_stats.misses++;
+			}
+			else
+				chd_cache_stats.hits++;
+
+			chd_lock.Unlock();
+
+			chd_cache_stats.wait_ms += (os_GetSeconds() - start) * 1000;
+		}
+		else
+			chd_cache_stats.hits++;
+
+		if (slot->prefetched)
+			chd_cache_stats.prefetch_hits++;
+
+		slot->prefetched = false;
+		slot->last_use = ++use_clock;
+
+		memcpy(dst, slot->data + hunk_ofs * (2352+96), size);
+
+		lock.Unlock();
+	}
+
+	void ReadAhead(u32 FAD, u32 count);
+
 	~CHDDisc()
 	{
-		if (hunk_mem)
-			delete [] hunk_mem;
 		if (chd)
+		{
+			lock.Lock();
+			prefetch_exit = true;
+			lock.Unlock();
+			prefetch_wake.Set();
+			prefetch_thread.WaitToEnd();
+		}
+
+		for (size_t i = 0; i < cache.size(); i++)
+			delete[] cache[i].data;
+
+		if (chd)
+		{
+			ChdCacheStats& s = chd_cache_stats;
+			printf("chd: %llu hits, %llu misses, %.1f ms waited on the emulator thread, %llu hunks read ahead, %llu of them used\n",
+				(unsigned long long)s.hits, (unsigned long long)s.misses, s.wait_ms,
+				(unsigned long long)s.prefetched, (unsigned long long)s.prefetch_hits);
+
 			chd_close(chd);
+		}
 	}
-};
 
+private:
+	CHDHunk* find(u32 hunk)
+	{
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			if (cache[i].hunk == hunk)
+				return &cache[i];
+		}
+		return nullptr;
+	}
+
+	// Empties the least recently used slot, for a hunk to be decompressed into its buffer. Only
+	// called with chd_lock and lock held, so two slots are never being filled at once
+	CHDHunk* evict()
+	{
+		CHDHunk* victim = &cache[0];
+
+		for (size_t i = 1; i < cache.size(); i++)
+		{
+			if (cache[i].last_use < victim->last_use)
+				victim = &cache[i];
+		}
+
+		victim->hunk = 0xFFFFFFFF;
+
+		return victim;
+	}
+
+	void fill(CHDHunk* slot, u32 hunk, bool prefetched)
+	{
+		slot->hunk = hunk;
+		slot->prefetched = prefetched;
+		slot->last_use = ++use_clock;
+	}
+
+	void* prefetch_loop()
+	{
+		for (;;)
+		{
+			prefetch_wake.Wait();
+
+			for (;;)
+			{
+				lock.Lock();
+
+				if (prefetch_exit)
+				{
+					lock.Unlock();
+					return NULL;
+				}
+
+				u32 hunk = 0;
+				bool found = false;
+
+				while (!pending.empty() && !found)
+				{
+					hunk = pending.front();
+					pending.erase(pending.begin());
+					found = find(hunk) == nullptr;
+				}
+
+				lock.Unlock();
+
+				if (!found)
+					break;
+
+				chd_lock.Lock();
+				lock.Lock();
+
+				// a miss may have read it meanwhile
+				if (find(hunk) != nullptr)
+				{
+					lock.Unlock();
+					chd_lock.Unlock();
+					continue;
+				}
+
+				// out of the lookups while it is filled, the emulator thread can still read the others
+				CHDHunk* slot = evict();
+				lock.Unlock();
+
+				chd_read(chd, hunk, slot->data);
+
+				// before chd_lock is released, a miss waiting on it then finds the hunk
+				lock.Lock();
+				fill(slot, hunk, true);
+				chd_cache_stats.prefetched++;
+				lock.Unlock();
+
+				chd_lock.Unlock();
+			}
+		}
+	}
+};
 struct CHDTrack : TrackFile
 {
 	CHDDisc* disc;
@@ -57,16 +246,8 @@ struct CHDTrack : TrackFile
 	virtual void Read(u32 FAD, u8* dst, SectorFormat* sector_type, u8* subcode, SubcodeFormat* subcode_type)
 	{
 		u32 fad_offs = FAD + Offset;
-		u32 hunk=(fad_offs)/disc->sph;
-		if (disc->old_hunk!=hunk)
-		{
-			chd_read(disc->chd,hunk,disc->hunk_mem); //CHDERR_NONE
-			disc->old_hunk = hunk;
-		}
 
-		u32 hunk_ofs = fad_offs%disc->sph;
-
-		memcpy(dst, disc->hunk_mem + hunk_ofs * (2352+96), fmt);
+		disc->ReadHunk(fad_offs / disc->sph, fad_offs % disc->sph, dst, fmt);
 
 		if (swap_bytes)
 		{
@@ -85,6 +266,39 @@ struct CHDTrack : TrackFile
 	}
 };
 
+void CHDDisc::ReadAhead(u32 FAD, u32 count)
+{
+	if (count == 0 || !settings.imgread.ChdReadAhead)
+		return;
+
+	for (size_t i = tracks.size(); i-- > 0;)
+	{
+		Track& t = tracks[i];
+
+		if (FAD < t.StartFAD || FAD > t.EndFAD)
+			continue;
+
+		// the rest of the read, within the track, and not more than half the cache
+		u32 last = std::min(FAD + count - 1, t.EndFAD);
+		s32 Offset = ((CHDTrack*)t.file)->Offset;
+
+		u32 first_hunk = (FAD + Offset) / sph;
+		u32 last_hunk = std::min((last + Offset) / sph, first_hunk + (u32)cache.size() / 2);
+
+		lock.Lock();
+		pending.clear();
+		for (u32 hunk = first_hunk; hunk <= last_hunk; hunk++)
+		{
+			if (find(hunk) == nullptr)
+				pending.push_back(hunk);
+		}
+		lock.Unlock();
+
+		prefetch_wake.Set();
+		return;
+	}
+}
+
 bool CHDDisc::TryOpen(const wchar* file)
 {
 	chd_error err=chd_open(file,CHD_OPEN_READ,0,&chd);
@@ -100,8 +314,6 @@ bool CHDDisc::TryOpen(const wchar* file)
 	const chd_header* head = chd_get_header(chd);
 
 	hunkbytes = head->hunkbytes;
-	hunk_mem = new u8[hunkbytes];
-	old_hunk=0xFFFFFFF;
 
 	sph = hunkbytes/(2352+96);
 
@@ -111,6 +323,18 @@ bool CHDDisc::TryOpen(const wchar* file)
 		return false;
 	}
 
+	cache.resize(std::max(1u, settings.imgread.ChdCacheHunks));
+	for (size_t i = 0; i < cache.size(); i++)
+	{
+		cache[i].hunk = 0xFFFFFFFF;
+		cache[i].last_use = 0;
+		cache[i].prefetched = false;
+		cache[i].data = new u8[hunkbytes];
+	}
+
+	chd_cache_stats = ChdCacheStats();
+	prefetch_thread.Start();
+
 	u32 tag;
 	u8 flags;
 	char temp[512];
@@ -181,7 +405,8 @@ bool CHDDisc::TryOpen(const wchar* file)
 	{
 		printf("WARNING: chd: Total frames is wrong: %u frames in %zu tracks\n",total_frames,tracks.size());
 
-		msgboxf("This is an improper dump!",MBX_ICONEXCLAMATION);
+		if (!imgread_quiet)
+			msgboxf("This is an improper dump!",MBX_ICONEXCLAMATION);
 
 		return false;
 	}
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "types.h"
+#include <algorithm>
 
 
 struct TocTrackInfo
@@ -93,6 +94,12 @@ struct Session
 struct TrackFile
 {
 	virtual void Read(u32 FAD, u8* dst, SectorFormat* sector_type, u8* subcode, SubcodeFormat* subcode_type) = 0;
+
+	// count sectors straight from the image, without a copy. NULL if they have to go through Read
+	virtual const u8* Map(u32 FAD, u32 count, SectorFormat* sector_type) { return NULL; }
+	// Hint, these sectors are about to be read
+	virtual void ReadAhead(u32 FAD, u32 count) { }
+
 	virtual ~TrackFile() {};
 };
 
@@ -155,34 +162,31 @@ struct Disc
 
 		while (count)
 		{
-			if (ReadSector(FAD, temp, &secfmt, q_subchannel, &subfmt))
+			// Whole runs of sectors of the same track, straight from the image when it is mapped
+			u32 run = 0;
+			const u8* src = MapSectors(FAD, count, &run, &secfmt);
+
+			if (src)
 			{
-				//TODO: Proper sector conversions
-				if (secfmt == SECFMT_2352)
-				{
-					ConvertSector(temp, dst, 2352, fmt, FAD, q_subchannel);
-				}
-				else if (fmt == 2048 && secfmt == SECFMT_2336_MODE2)
-					memcpy(dst, temp + 8, 2048);
-				else if (fmt == 2048 && (secfmt == SECFMT_2048_MODE1 || secfmt == SECFMT_2048_MODE2_FORM1))
-				{
-					memcpy(dst, temp, 2048);
-				}
-				else if (fmt == 2352 && (secfmt == SECFMT_2048_MODE1 || secfmt == SECFMT_2048_MODE2_FORM1))
-				{
-					printf("GDR:fmt=2352;secfmt=2048\n");
-					memcpy(dst, temp, 2048);
-				}
-				else if (fmt == 2048 && secfmt == SECFMT_2448_MODE2)
-				{
-					// Pier Solar and the Great Architects
-					ConvertSector(temp, dst, 2448, fmt, FAD, q_subchannel);
-				}
+				u32 size = SectorSize(secfmt);
+
+				if (size == fmt && (fmt == 2048 || fmt == 2352))
+					memcpy(dst, src, run * fmt);	// nothing to convert
 				else
 				{
-					printf("ERROR: UNABLE TO CONVERT SECTOR. THIS IS FATAL. Format: %d Sector format: %d\n", fmt, secfmt);
-					//verify(false);
+					for (u32 i = 0; i < run; i++)
+						ConvertFrom(src + i * size, secfmt, dst + i * fmt, fmt, FAD + i, q_subchannel);
 				}
+
+				dst += run * fmt;
+				FAD += run;
+				count -= run;
+				continue;
+			}
+
+			if (ReadSector(FAD, temp, &secfmt, q_subchannel, &subfmt))
+			{
+				ConvertFrom(temp, secfmt, dst, fmt, FAD, q_subchannel);
 			}
 			else
 			{
@@ -193,6 +197,21 @@ struct Disc
 			count--;
 		}
 	}
+
+	// Hint, the drive is about to read these sectors
+	virtual void ReadAhead(u32 FAD, u32 count)
+	{
+		for (size_t i = tracks.size(); i-- > 0;)
+		{
+			Track& t = tracks[i];
+
+			if (t.file && FAD >= t.StartFAD && (FAD <= t.EndFAD || t.EndFAD == 0))
+			{
+				t.file->ReadAhead(FAD, t.EndFAD ? std::min(count, t.EndFAD - FAD + 1) : count);
+				return;
+			}
+		}
+	}
 	virtual ~Disc()
 	{
 		for (size_t i = 0; i < tracks.size(); i++)
@@ -243,7 +262,72 @@ struct Disc
 	}
 
 	private:
-		bool ConvertSector(u8* in_buff, u8* out_buff, int from, int to, int sector, u8* q_subchannel)
+		static u32 SectorSize(SectorFormat secfmt)
+		{
+			switch (secfmt)
+			{
+			case SECFMT_2352: return 2352;
+			case SECFMT_2336_MODE2: return 2336;
+			case SECFMT_2448_MODE2: return 2448;
+			default: return 2048;
+			}
+		}
+
+		// Up to count sectors from FAD on, as long as they are in the same track and mapped
+		const u8* MapSectors(u32 FAD, u32 count, u32* run, SectorFormat* secfmt)
+		{
+			for (size_t i = tracks.size(); i-- > 0;)
+			{
+				Track& t = tracks[i];
+
+				if (t.file && FAD >= t.StartFAD && (FAD <= t.EndFAD || t.EndFAD == 0))
+				{
+					*run = t.EndFAD ? std::min(count, t.EndFAD - FAD + 1) : count;
+
+					// ReadSector prefers the later tracks, the run stops where one starts
+					for (size_t j = i + 1; j < tracks.size(); j++)
+					{
+						if (tracks[j].file && tracks[j].StartFAD > FAD)
+							*run = std::min(*run, tracks[j].StartFAD - FAD);
+					}
+
+					return t.file->Map(FAD, *run, secfmt);
+				}
+			}
+			return NULL;
+		}
+
+		void ConvertFrom(const u8* src, SectorFormat secfmt, u8* dst, u32 fmt, u32 FAD, u8* q_subchannel)
+		{
+			//TODO: Proper sector conversions
+			if (secfmt == SECFMT_2352)
+			{
+				ConvertSector(src, dst, 2352, fmt, FAD, q_subchannel);
+			}
+			else if (fmt == 2048 && secfmt == SECFMT_2336_MODE2)
+				memcpy(dst, src + 8, 2048);
+			else if (fmt == 2048 && (secfmt == SECFMT_2048_MODE1 || secfmt == SECFMT_2048_MODE2_FORM1))
+			{
+				memcpy(dst, src, 2048);
+			}
+			else if (fmt == 2352 && (secfmt == SECFMT_2048_MODE1 || secfmt == SECFMT_2048_MODE2_FORM1))
+			{
+				printf("GDR:fmt=2352;secfmt=2048\n");
+				memcpy(dst, src, 2048);
+			}
+			else if (fmt == 2048 && secfmt == SECFMT_2448_MODE2)
+			{
+				// Pier Solar and the Great Architects
+				ConvertSector(src, dst, 2448, fmt, FAD, q_subchannel);
+			}
+			else
+			{
+				printf("ERROR: UNABLE TO CONVERT SECTOR. THIS IS FATAL. Format: %d Sector format: %d\n", fmt, secfmt);
+				//verify(false);
+			}
+		}
+
+		bool ConvertSector(const u8* in_buff, u8* out_buff, int from, int to, int sector, u8* q_subchannel)
 		{
 			//get subchannel data, if any
 			if (from == 2448)
@@ -310,4 +394,18 @@ struct Disc
 		}
 };
 
-Disc* OpenDisc(const wchar* fn);
\ No newline at end of file
+// Tries every driver. They keep state in globals, so opens from different threads take turns.
+// A quiet open (the game library's scan) doesn't ask the user anything about the image
+Disc* OpenDisc(const wchar* fn, bool quiet = false);
+extern bool imgread_quiet;		// set by OpenDisc for the drivers
+
+struct ChdCacheStats
+{
+	u64 hits;
+	u64 misses;			// hunks decompressed on the emulator thread
+	u64 prefetched;		// hunks decompressed ahead by the read-ahead thread
+	u64 prefetch_hits;	// of those, read before being evicted
+	double wait_ms;		// emulator thread time spent on misses
+};
+
+extern ChdCacheStats chd_cache_stats;
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 
 #include "imgread_common.h"
+#include "oslib/threading.h"
 
 Disc* chd_parse(const wchar* file);
 Disc* gdi_parse(const wchar* file);
@@ -39,13 +40,22 @@ DiscType GuessDiscType(bool m1, bool m2, bool da)
 }
 
 
-Disc* OpenDisc(const wchar* fn)
+static cMutex imgread_lock;
+bool imgread_quiet;
+
+Disc* OpenDisc(const wchar* fn, bool quiet)
 {
 	Disc* rv = NULL;
 
+	imgread_lock.Lock();
+	imgread_quiet = quiet;
+
 	for (unat i = 0; imgread_drivers[i] && !rv; i++) {  // ;drivers[i] && !(rv=drivers[i](fn));
 		rv = imgread_drivers[i](fn);
 	}
 
+	imgread_quiet = false;
+	imgread_lock.Unlock();
+
 	return rv;
 }
\ No newline at end of file
@@ -16,6 +16,10 @@ struct RawTrackFile : TrackFile
 	u32 fmt;
 	bool cleanup;
 
+	// whole image file, when it can be mapped
+	const u8* mapping;
+	size_t mapping_size;
+
 	RawTrackFile(core_file* file, u32 file_offs, u32 first_fad, u32 secfmt)
 	{
 		verify(file != 0);
@@ -23,22 +27,66 @@ struct RawTrackFile : TrackFile
 		this->offset = file_offs - first_fad * secfmt;
 		this->fmt = secfmt;
 		this->cleanup = true;
+		this->mapping = (const u8*)core_fmap(file, &mapping_size);
 	}
 
-	virtual void Read(u32 FAD, u8* dst, SectorFormat* sector_type, u8* subcode, SubcodeFormat* subcode_type)
+	SectorFormat Format()
 	{
 		//for now hackish
 		if (fmt == 2352)
-			*sector_type = SECFMT_2352;
+			return SECFMT_2352;
 		else if (fmt == 2048)
-			*sector_type = SECFMT_2048_MODE2_FORM1;
+			return SECFMT_2048_MODE2_FORM1;
 		else if (fmt == 2336)
-			*sector_type = SECFMT_2336_MODE2;
+			return SECFMT_2336_MODE2;
 		else if (fmt == 2448)
-			*sector_type = SECFMT_2448_MODE2;
-		else
+			return SECFMT_2448_MODE2;
+
+		verify(false);
+		return SECFMT_2352;
+	}
+
+	// byte offset of FAD in the file, if count sectors from there are all in it
+	bool InFile(u32 FAD, u32 count, size_t size, size_t* offs)
+	{
+		s64 start = (s64)offset + (s64)FAD * fmt;
+
+		if (start < 0 || start + (s64)count * fmt > (s64)size)
+			return false;
+
+		*offs = (size_t)start;
+		return true;
+	}
+
+	virtual const u8* Map(u32 FAD, u32 count, SectorFormat* sector_type)
+	{
+		size_t offs;
+
+		if (!mapping || !InFile(FAD, count, mapping_size, &offs))
+			return NULL;
+
+		*sector_type = Format();
+		return mapping + offs;
+	}
+
+	virtual void ReadAhead(u32 FAD, u32 count)
+	{
+		size_t offs;
+
+		if (mapping && InFile(FAD, count, mapping_size, &offs))
+			core_fadvise(file, offs, count * fmt);
+	}
+
+	virtual void Read(u32 FAD, u8* dst, SectorFormat* sector_type, u8* subcode, SubcodeFormat* subcode_type)
+	{
+		*sector_type = Format();
+
+		size_t offs;
+
+		if (mapping && InFile(FAD, 1, mapping_size, &offs))
 		{
-			verify(false);
+			memcpy(dst, mapping + offs, fmt);
+			return;
 		}
 
 		core_fseek(file, offset + FAD * fmt, SEEK_SET);
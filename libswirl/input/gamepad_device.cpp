@@ -13,6 +13,8 @@
 #include "oslib/oslib.h"
 #include "cfg/cfg.h"
 #include "libswirl.h"
+#include "rewind.h"
+#include "input_latency.h"
 
 #define MAPLE_PORT_CFG_PREFIX "maple_"
 
@@ -23,6 +25,13 @@ extern s8 joyx[4], joyy[4];
 std::vector<std::shared_ptr<GamepadDevice>> GamepadDevice::_gamepads;
 cMutex GamepadDevice::_gamepads_mutex;
 
+// What the game sees of a port, analog values in 8 steps so their noise isn't a change
+static u32 latency_state(int port)
+{
+	return kcode[port] | (lt[port] >> 5) << 16 | (rt[port] >> 5) << 19
+		| ((joyx[port] + 128) >> 5) << 22 | ((joyy[port] + 128) >> 5) << 25;
+}
+
 bool GamepadDevice::gamepad_btn_input(u32 code, bool pressed)
 {
 	if (_input_detected != NULL && _detecting_button 
@@ -37,6 +46,8 @@ bool GamepadDevice::gamepad_btn_input(u32 code, bool pressed)
 	if (key == EMU_BTN_NONE)
 		return false;
 
+	u32 state = latency_active ? latency_state(_maple_port) : 0;
+
 	if (key < 0x10000)
 	{
 		if (pressed)
@@ -98,6 +109,9 @@ bool GamepadDevice::gamepad_btn_input(u32 code, bool pressed)
 				settings.aica.LimitFPS ^=1;
 			}
 			break;
+		case EMU_BTN_REWIND:
+			rewind_held = pressed;
+			break;
 		case EMU_BTN_TRIGGER_LEFT:
 			lt[_maple_port] = pressed ? 255 : 0;
 			break;
@@ -122,6 +136,9 @@ bool GamepadDevice::gamepad_btn_input(u32 code, bool pressed)
 	}
 
 	//printf("%d: BUTTON %s %x -> %d. kcode=%x\n", _maple_port, pressed ? "down" : "up", code, key, kcode[_maple_port]);
+	if (latency_active && latency_state(_maple_port) != state)
+		latency_host_event(_maple_port);
+
 	return true;
 }
 
@@ -141,6 +158,7 @@ bool GamepadDevice::gamepad_axis_input(u32 code, int value)
 	if (input_mapper == NULL || _maple_port < 0 || _maple_port >= ARRAY_SIZE(kcode))
 		return false;
 	DreamcastKey key = input_mapper->get_axis_id(code);
+	u32 state = latency_active ? latency_state(_maple_port) : 0;
 
 	if ((int)key < 0x10000)
 	{
@@ -193,6 +211,9 @@ bool GamepadDevice::gamepad_axis_input(u32 code, int value)
 	else
 		return false;
 
+	if (latency_active && latency_state(_maple_port) != state)
+		latency_host_event(_maple_port);
+
 	return true;
 }
 
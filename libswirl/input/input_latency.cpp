@@ -0,0 +1,235 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#include "input_latency.h"
+#include "cfg/cfg.h"
+#include "oslib/oslib.h"
+#include "oslib/threading.h"
+#include "deps/xxhash/xxhash.h"
+
+#include <atomic>
+
+#define LATENCY_BUCKETS 200		// of 1 ms, the last one has everything longer
+#define LATENCY_MAX_FRAMES 60	// without a different frame, the change had no visible response
+
+struct LatencyHistogram
+{
+	const char* name;
+	u32 buckets[LATENCY_BUCKETS];
+	u32 count;
+	double total_ms;
+	double max_ms;
+
+	void Add(double seconds)
+	{
+		double ms = seconds * 1000;
+
+		buckets[std::min((u32)std::max(ms, 0.0), (u32)LATENCY_BUCKETS - 1)]++;
+		count++;
+		total_ms += ms;
+		max_ms = std::max(max_ms, ms);
+	}
+
+	// upper end of the bucket holding that fraction of the samples
+	u32 Percentile(double p)
+	{
+		if (count == 0)
+			return 0;
+
+		u32 target = (u32)(count * p);
+		u32 seen = 0;
+
+		for (u32 i = 0; i < LATENCY_BUCKETS; i++)
+		{
+			seen += buckets[i];
+			if (seen > target)
+				return i + 1;
+		}
+
+		return LATENCY_BUCKETS;
+	}
+};
+
+enum LatencyStage
+{
+	LS_IDLE,
+	LS_SAMPLED,		// maple read the change, waiting for a frame that differs
+	LS_QUEUED,		// that frame was queued, waiting for it to be presented
+};
+
+bool latency_active;
+
+static string report_path;
+static cMutex mtx;
+
+static LatencyHistogram event_to_maple = { "event_to_maple" };
+static LatencyHistogram maple_to_frame = { "maple_to_frame" };
+static LatencyHistogram frame_to_present = { "frame_to_present" };
+static LatencyHistogram event_to_present = { "event_to_present" };
+
+static double pending_event[4];		// first change not sampled yet, 0 for none
+static u32 no_response;
+
+static LatencyStage stage;
+static double event_time, sample_time, frame_time;
+static u64 reference_hash;			// of the frame before the sample
+static u32 frames_waited;
+static u32 response_frame;
+
+static u64 last_hash;
+static u32 frame_count;
+static std::atomic<u32> rendering_frame;	// set by the render thread, read under mtx by the gui one
+
+void latency_init()
+{
+	report_path = cfgLoadStr("input", "LatencyReport", "");
+	latency_active = !report_path.empty();
+
+	if (latency_active)
+		printf("Input latency: measuring, report in %s\n", report_path.c_str());
+}
+
+static void write_histogram(FILE* f, LatencyHistogram& h, bool last)
+{
+	u32 used = LATENCY_BUCKETS;
+	while (used > 0 && h.buckets[used - 1] == 0)
+		used--;
+
+	fprintf(f, "  \"%s\": { \"count\": %u, \"mean_ms\": %.2f, \"p50_ms\": %u, \"p95_ms\": %u, \"p99_ms\": %u, \"max_ms\": %.2f, \"bucket_ms\": 1, \"buckets\": [",
+		h.name, h.count, h.count ? h.total_ms / h.count : 0.0, h.Percentile(0.5), h.Percentile(0.95), h.Percentile(0.99), h.max_ms);
+
+	for (u32 i = 0; i < used; i++)
+		fprintf(f, "%s%u", i ? ", " : "", h.buckets[i]);
+
+	fprintf(f, "] }%s\n", last ? "" : ",");
+
+	printf("Input latency: %-16s %6u samples, mean %6.2f ms, p95 %3u ms, max %6.2f ms\n",
+		h.name, h.count, h.count ? h.total_ms / h.count : 0.0, h.Percentile(0.95), h.max_ms);
+}
+
+void latency_term()
+{
+	if (!latency_active)
+		return;
+
+	latency_active = false;
+
+	FILE* f = fopen(report_path.c_str(), "w");
+
+	if (!f)
+	{
+		printf("Input latency: cannot write %s\n", report_path.c_str());
+		return;
+	}
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"no_response\": %u,\n", no_response);
+	write_histogram(f, event_to_maple, false);
+	write_histogram(f, maple_to_frame, false);
+	write_histogram(f, frame_to_present, false);
+	write_histogram(f, event_to_present, true);
+	fprintf(f, "}\n");
+
+	fclose(f);
+}
+
+void latency_host_event(int port)
+{
+	if (!latency_active || port < 0 || port >= ARRAY_SIZE(pending_event))
+		return;
+
+	mtx.Lock();
+	if (pending_event[port] == 0)
+		pending_event[port] = os_GetSeconds();
+	mtx.Unlock();
+}
+
+void latency_maple_sample(int port)
+{
+	if (!latency_active || port < 0 || port >= ARRAY_SIZE(pending_event))
+		return;
+
+	mtx.Lock();
+
+	if (pending_event[port] != 0)
+	{
+		double now = os_GetSeconds();
+
+		event_to_maple.Add(now - pending_event[port]);
+
+		if (stage == LS_IDLE)
+		{
+			stage = LS_SAMPLED;
+			event_time = pending_event[port];
+			sample_time = now;
+			reference_hash = last_hash;
+			frames_waited = 0;
+		}
+
+		pending_event[port] = 0;
+	}
+
+	mtx.Unlock();
+}
+
+u32 latency_frame_queued(const void* data, u32 size)
+{
+	if (!latency_active)
+		return 0;
+
+	u64 hash = XXH64(data, size, 0);
+
+	mtx.Lock();
+
+	u32 frame = ++frame_count;
+	last_hash = hash;
+
+	if (stage == LS_SAMPLED)
+	{
+		if (hash != reference_hash)
+		{
+			stage = LS_QUEUED;
+			frame_time = os_GetSeconds();
+			maple_to_frame.Add(frame_time - sample_time);
+			response_frame = frame;
+		}
+		else if (++frames_waited >= LATENCY_MAX_FRAMES)
+		{
+			stage = LS_IDLE;
+			no_response++;
+		}
+	}
+
+	mtx.Unlock();
+
+	return frame;
+}
+
+void latency_frame_rendered(u32 frame)
+{
+	if (latency_active)
+		rendering_frame = frame;
+}
+
+void latency_frame_presented()
+{
+	if (!latency_active)
+		return;
+
+	mtx.Lock();
+
+	// a frame replaced before it was rendered shows up in the later one
+	if (stage == LS_QUEUED && rendering_frame >= response_frame)
+	{
+		double now = os_GetSeconds();
+
+		frame_to_present.Add(now - frame_time);
+		event_to_present.Add(now - event_time);
+		stage = LS_IDLE;
+	}
+
+	mtx.Unlock();
+}
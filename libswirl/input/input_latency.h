@@ -0,0 +1,35 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#pragma once
+#include "types.h"
+
+/*
+	Input latency measurement, on when input:LatencyReport names a file.
+
+	A change of a port's state is timestamped when the host delivers it, maple dma samples it,
+	the first frame queued after that whose ta data differs from the one before is taken as the
+	response, and the measurement ends when that frame is presented. One change is followed at a
+	time, the ones in between only count towards event to maple. Games that animate every frame
+	respond on the next frame whatever the input, so this is a lower bound for them.
+*/
+
+extern bool latency_active;
+
+void latency_init();
+// Writes the histograms to the report
+void latency_term();
+
+// The port's buttons or axes changed, from whatever thread handles host input
+void latency_host_event(int port);
+// Maple dma read the port's state
+void latency_maple_sample(int port);
+
+// Emulation thread, a frame with this ta data was queued, returns its number
+u32 latency_frame_queued(const void* data, u32 size);
+// Render thread, the frame is being rendered and then presented
+void latency_frame_rendered(u32 frame);
+void latency_frame_presented();
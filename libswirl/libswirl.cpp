@@ -30,13 +30,18 @@
 #include "gui/gui_renderer.h"
 #include "profiler/profiler.h"
 #include "input/gamepad_device.h"
+#include "input/input_latency.h"
 #include "rend/TexCache.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "benchmark.h"
 
 #include "hw/gdrom/gdromv3.h"
 
 #include "hw/maple/maple_if.h"
 #include "hw/modem/modem.h"
 #include "hw/bba/bba.h"
+#include "hw/bba/VirtualNetwork.h"
 #include "hw/holly/holly_intc.h"
 #include "hw/aica/aica_mmio.h"
 #include "hw/arm7/SoundCPU.h"
@@ -281,6 +286,15 @@ void InitSettings()
     settings.dynarec.DspEnable = true;
 
     settings.savepopup.isShown = false; // if false, popup on save state should appear
+    settings.rewind.Enable = false;
+    settings.rewind.Interval = 10;
+    settings.rewind.MaxSnapshots = 60;
+    settings.runahead.Enable = false;
+    settings.runahead.Frames = 1;
+    settings.imgread.ChdCacheHunks = 16;
+    settings.imgread.ChdReadAhead = true;
+    settings.imgread.AsyncRead = true;
+    settings.naomi.DecryptCache = false;
 
     settings.dreamcast.cable = 3;	// TV composite
     settings.dreamcast.region = 3;	// default
@@ -291,11 +305,16 @@ void InitSettings()
     settings.aica.LimitFPS = true;
     settings.aica.NoBatch = false;	// This also controls the DSP. Disabled by default
     settings.aica.NoSound = false;
+    settings.aica.VectorMixer = true;
     settings.audio.backend = "auto";
+    settings.audio.RateControl = true;
     settings.rend.UseMipmaps = true;
     settings.rend.WideScreen = false;
     settings.rend.ShowFPS = false;
     settings.rend.RenderToTextureBuffer = false;
+    settings.rend.RenderToTextureDeferred = false;
+    settings.rend.ShaderCache = true;
+    settings.rend.ShaderCacheWarmup = true;
     settings.rend.RenderToTextureUpscale = 1;
     settings.rend.TranslucentPolygonDepthMask = false;
     settings.rend.ModifierVolumes = true;
@@ -376,6 +395,15 @@ void LoadSettings(bool game_specific)
     settings.dynarec.DspEnable = cfgLoadInt(config_section, "Dynarec.DspEnabled", settings.dynarec.DspEnable);
 
     settings.savepopup.isShown = cfgLoadBool(config_section, "SavePopup.isShown", settings.savepopup.isShown);
+    settings.rewind.Enable = cfgLoadBool(config_section, "Rewind.Enable", settings.rewind.Enable);
+    settings.rewind.Interval = cfgLoadInt(config_section, "Rewind.Interval", settings.rewind.Interval);
+    settings.rewind.MaxSnapshots = cfgLoadInt(config_section, "Rewind.MaxSnapshots", settings.rewind.MaxSnapshots);
+    settings.runahead.Enable = cfgLoadBool(config_section, "RunAhead.Enable", settings.runahead.Enable);
+    settings.runahead.Frames = cfgLoadInt(config_section, "RunAhead.Frames", settings.runahead.Frames);
+    settings.imgread.ChdCacheHunks = cfgLoadInt(config_section, "ImageRead.ChdCacheHunks", settings.imgread.ChdCacheHunks);
+    settings.imgread.ChdReadAhead = cfgLoadBool(config_section, "ImageRead.ChdReadAhead", settings.imgread.ChdReadAhead);
+    settings.imgread.AsyncRead = cfgLoadBool(config_section, "ImageRead.AsyncRead", settings.imgread.AsyncRead);
+    settings.naomi.DecryptCache = cfgLoadBool(config_section, "Naomi.DecryptCache", settings.naomi.DecryptCache);
 
     //disable_nvmem can't be loaded, because nvmem init is before cfg load
     settings.dreamcast.cable = cfgLoadInt(config_section, "Dreamcast.Cable", settings.dreamcast.cable);
@@ -386,11 +414,16 @@ void LoadSettings(bool game_specific)
     settings.aica.LimitFPS = cfgLoadBool(config_section, "aica.LimitFPS", settings.aica.LimitFPS);
     settings.aica.NoBatch = cfgLoadBool(config_section, "aica.NoBatch", settings.aica.NoBatch);
     settings.aica.NoSound = cfgLoadBool(config_section, "aica.NoSound", settings.aica.NoSound);
+    settings.aica.VectorMixer = cfgLoadBool(config_section, "aica.VectorMixer", settings.aica.VectorMixer);
     settings.audio.backend = cfgLoadStr(audio_section, "backend", settings.audio.backend.c_str());
+    settings.audio.RateControl = cfgLoadBool(audio_section, "RateControl", settings.audio.RateControl);
     settings.rend.UseMipmaps = cfgLoadBool(config_section, "rend.UseMipmaps", settings.rend.UseMipmaps);
     settings.rend.WideScreen = cfgLoadBool(config_section, "rend.WideScreen", settings.rend.WideScreen);
     settings.rend.ShowFPS = cfgLoadBool(config_section, "rend.ShowFPS", settings.rend.ShowFPS);
     settings.rend.RenderToTextureBuffer = cfgLoadBool(config_section, "rend.RenderToTextureBuffer", settings.rend.RenderToTextureBuffer);
+    settings.rend.RenderToTextureDeferred = cfgLoadBool(config_section, "rend.RenderToTextureDeferred", settings.rend.RenderToTextureDeferred);
+    settings.rend.ShaderCache = cfgLoadBool(config_section, "rend.ShaderCache", settings.rend.ShaderCache);
+    settings.rend.ShaderCacheWarmup = cfgLoadBool(config_section, "rend.ShaderCacheWarmup", settings.rend.ShaderCacheWarmup);
     settings.rend.RenderToTextureUpscale = cfgLoadInt(config_section, "rend.RenderToTextureUpscale", settings.rend.RenderToTextureUpscale);
     settings.rend.TranslucentPolygonDepthMask = cfgLoadBool(config_section, "rend.TranslucentPolygonDepthMask", settings.rend.TranslucentPolygonDepthMask);
     settings.rend.ModifierVolumes = cfgLoadBool(config_section, "rend.ModifierVolumes", settings.rend.ModifierVolumes);
@@ -528,6 +561,15 @@ void SaveSettings()
     cfgSaveBool("config", "Dynarec.unstable-opt", settings.dynarec.unstable_opt);
 
     cfgSaveBool("config", "SavePopup.isShown", settings.savepopup.isShown);
+    cfgSaveBool("config", "Rewind.Enable", settings.rewind.Enable);
+    cfgSaveInt("config", "Rewind.Interval", settings.rewind.Interval);
+    cfgSaveInt("config", "Rewind.MaxSnapshots", settings.rewind.MaxSnapshots);
+    cfgSaveBool("config", "RunAhead.Enable", settings.runahead.Enable);
+    cfgSaveInt("config", "RunAhead.Frames", settings.runahead.Frames);
+    cfgSaveInt("config", "ImageRead.ChdCacheHunks", settings.imgread.ChdCacheHunks);
+    cfgSaveBool("config", "ImageRead.ChdReadAhead", settings.imgread.ChdReadAhead);
+    cfgSaveBool("config", "ImageRead.AsyncRead", settings.imgread.AsyncRead);
+    cfgSaveBool("config", "Naomi.DecryptCache", settings.naomi.DecryptCache);
 
     if (!safemode_game || !settings.dynarec.safemode)
         cfgSaveBool("config", "Dynarec.safe-mode", settings.dynarec.safemode);
@@ -537,7 +579,9 @@ void SaveSettings()
     cfgSaveBool("config", "aica.LimitFPS", settings.aica.LimitFPS);
     cfgSaveBool("config", "aica.NoBatch", settings.aica.NoBatch);
     cfgSaveBool("config", "aica.NoSound", settings.aica.NoSound);
+    cfgSaveBool("config", "aica.VectorMixer", settings.aica.VectorMixer);
     cfgSaveStr("audio", "backend", settings.audio.backend.c_str());
+    cfgSaveBool("audio", "RateControl", settings.audio.RateControl);
 
     // Write backend specific settings
     // std::map<std::string, std::map<std::string, std::string>>
@@ -562,6 +606,9 @@ void SaveSettings()
     cfgSaveBool("config", "rend.ShowFPS", settings.rend.ShowFPS);
     if (!rtt_to_buffer_game || !settings.rend.RenderToTextureBuffer)
         cfgSaveBool("config", "rend.RenderToTextureBuffer", settings.rend.RenderToTextureBuffer);
+    cfgSaveBool("config", "rend.RenderToTextureDeferred", settings.rend.RenderToTextureDeferred);
+    cfgSaveBool("config", "rend.ShaderCache", settings.rend.ShaderCache);
+    cfgSaveBool("config", "rend.ShaderCacheWarmup", settings.rend.ShaderCacheWarmup);
     cfgSaveInt("config", "rend.RenderToTextureUpscale", settings.rend.RenderToTextureUpscale);
     cfgSaveBool("config", "rend.ModifierVolumes", settings.rend.ModifierVolumes);
     cfgSaveBool("config", "rend.Clipping", settings.rend.Clipping);
@@ -622,6 +669,7 @@ void SaveSettings()
 }
 
 static bool reset_requested;
+static bool checkpoint_requested;
 
 
 
@@ -650,16 +698,24 @@ int reicast_init(int argc, char* argv[])
     else
         LoadSettings(false);
 
+    bool headless = bench_init();
+    latency_init();
+
 #if BUILD_RETROARCH_CORE == 0
-    os_CreateWindow();
+    if (!headless)
+        os_CreateWindow();
 #endif
-    os_SetupInput();
+    if (!headless)
+        os_SetupInput();
 
     g_GUI.reset(GUI::Create());
     g_GUI->Init();
 
 #if BUILD_RETROARCH_CORE == 0
-    g_GUIRenderer.reset(GUIRenderer::Create(g_GUI.get()));
+    if (headless)
+        g_GUIRenderer.reset(GUIRenderer::CreateHeadless());
+    else
+        g_GUIRenderer.reset(GUIRenderer::Create(g_GUI.get()));
 #endif
 
     if (showOnboarding)
@@ -669,10 +725,15 @@ int reicast_init(int argc, char* argv[])
 }
 
 void reicast_ui_loop() {
-    g_GUIRenderer->UILoop();
+    if (bench_active && settings.pvr.backend == "none")
+        bench_main();
+    else
+        g_GUIRenderer->UILoop();
 }
 
 void reicast_term() {
+    latency_term();
+
     g_GUIRenderer.reset();
 
     g_GUI.reset();
@@ -700,10 +761,21 @@ struct Dreamcast_impl : VirtualDreamcast {
     int aica_schid = -1;
     int ds_schid = -1;
 
+    // Reached through p_sh4sched and p_tastate while this machine exists. Sh4RCB, the vmem
+    // reservation and the code and texture caches are still process wide, one machine at a time
+    Sh4SchedContext sched_ctx;
+    TA_state ta_state;
+
     cThread emu_thread;
     cResetEvent emu_started;
 
-    Dreamcast_impl() : emu_thread(STATIC_FORWARD(Dreamcast_impl, dc_run), this) { }
+    Dreamcast_impl() : ta_state(), emu_thread(STATIC_FORWARD(Dreamcast_impl, dc_run), this)
+    {
+        verify(p_sh4sched == nullptr && p_tastate == nullptr);
+
+        p_sh4sched = &sched_ctx;
+        p_tastate = &ta_state;
+    }
 
 #ifndef TARGET_DISPFRAME
     void* dc_run()
@@ -754,12 +826,39 @@ struct Dreamcast_impl : VirtualDreamcast {
 
         emu_started.Set();
 
+        bool restart;
+
         do {
             reset_requested = false;
+            checkpoint_requested = false;
 
             sh4_cpu->Run();
 
-            SaveRomFiles(get_writable_data_path(DATA_PATH));
+            if (checkpoint_requested && !reset_requested)
+            {
+                // The gui may have asked for a stop meanwhile, it takes priority
+                callback_lock.Lock();
+                restart = callback == nullptr;
+                if (restart)
+                {
+                    rewind_checkpoint();
+                    runahead_checkpoint();
+                    sh4_cpu->Start();
+                }
+                callback_lock.Unlock();
+
+                if (restart)
+                    continue;
+            }
+
+            // Back to the frame that was shown, before the nvmem is saved or the gui sees the state
+            runahead_stop();
+
+            // benchmark runs start from the same flash every time
+            if (!bench_active)
+                SaveRomFiles(get_writable_data_path(DATA_PATH));
+
+            restart = reset_requested;
             if (reset_requested)
             {
                 virtualDreamcast->Reset();
@@ -768,7 +867,7 @@ struct Dreamcast_impl : VirtualDreamcast {
                 luabindings_onreset();
 #endif
             }
-        } while (reset_requested);
+        } while (restart);
 
 #ifdef SCRIPTING
             luabindings_onstop();
@@ -787,6 +886,9 @@ struct Dreamcast_impl : VirtualDreamcast {
 
     ~Dreamcast_impl() {
         Term();
+
+        p_sh4sched = nullptr;
+        p_tastate = nullptr;
     }
 
 
@@ -800,8 +902,21 @@ struct Dreamcast_impl : VirtualDreamcast {
 
         //if (aica_sample_cycles>=AICA_SAMPLE_CYCLES)
         {
-            sh4_cpu->GetA0H<SoundCPU>(A0H_SCPU)->Update(512 * 32);
-            sh4_cpu->GetA0H<AICA>(A0H_AICA)->Update(1 * 32);
+            if (unlikely(bench_active))
+            {
+                double start = os_GetSeconds();
+                sh4_cpu->GetA0H<SoundCPU>(A0H_SCPU)->Update(512 * 32);
+                double arm7_end = os_GetSeconds();
+                sh4_cpu->GetA0H<AICA>(A0H_AICA)->Update(1 * 32);
+
+                bench_times.arm7 += arm7_end - start;
+                bench_times.aica += os_GetSeconds() - arm7_end;
+            }
+            else
+            {
+                sh4_cpu->GetA0H<SoundCPU>(A0H_SCPU)->Update(512 * 32);
+                sh4_cpu->GetA0H<AICA>(A0H_AICA)->Update(1 * 32);
+            }
             //aica_sample_cycles-=AICA_SAMPLE_CYCLES;
         }
 
@@ -834,6 +949,8 @@ struct Dreamcast_impl : VirtualDreamcast {
 
         sh4_cpu->vram.Zero();
         sh4_cpu->aica_ram.Zero();
+
+        rewind_reset();
     }
 
     int StartGame(const string& path)
@@ -945,7 +1062,9 @@ struct Dreamcast_impl : VirtualDreamcast {
 
         MMIODevice* extDevice_010 = 
         #if DC_PLATFORM == DC_PLATFORM_DREAMCAST && defined(ENABLE_BBA)
-            Create_BBA(asic, CreateNullNetwork());
+            Create_BBA(asic, cfgLoadStr("network", "VirtualSwitch", "").empty()
+                ? VirtualNetwork::CreateNullNetwork()
+                : VirtualNetwork::CreateSwitchNetwork(cfgLoadStr("network", "VirtualSwitch", "").c_str()));
         #else
             Create_ExtDevice_010();
         #endif
@@ -986,6 +1105,9 @@ struct Dreamcast_impl : VirtualDreamcast {
 
     void Term()
     {
+        rewind_reset();
+        runahead_stop();
+
         sh4_cpu->Term();
         
 #if DC_PLATFORM != DC_PLATFORM_DREAMCAST
@@ -993,12 +1115,20 @@ struct Dreamcast_impl : VirtualDreamcast {
 #endif
         plugins_Term();
         rend_term_renderer();
+        vramwb_Drop();
+
+#ifdef SCRIPTING
+        // the renderer closed the scripts, before the memory they watch is released
+        luabindings_sync();
+#endif
 
         _vmem_release(&sh4_cpu->mram, &sh4_cpu->vram, &sh4_cpu->aica_ram);
 
         mcfg_DestroyDevices();
 
-        SaveSettings();
+        // the benchmark overrides some of them
+        if (!bench_active)
+            SaveSettings();
 
         delete sh4_cpu;
         sh4_cpu = nullptr;
@@ -1009,20 +1139,34 @@ struct Dreamcast_impl : VirtualDreamcast {
 
     void Stop(function<void()> callback)
     {
-        verify(sh4_cpu->IsRunning());
-
         callback_lock.Lock();
+        // A rewind or run-ahead checkpoint may have stopped the cpu already, dc_run won't restart it
+        verify(sh4_cpu->IsRunning() || checkpoint_requested);
         verify(this->callback == nullptr);
         this->callback = callback;
+        if (sh4_cpu->IsRunning())
+            sh4_cpu->Stop();
         callback_lock.Unlock();
-        sh4_cpu->Stop();
     }
 
     // Called on the emulator thread for soft reset
     void RequestReset()
     {
         reset_requested = true;
-        sh4_cpu->Stop();
+        callback_lock.Lock();
+        if (sh4_cpu->IsRunning())
+            sh4_cpu->Stop();
+        callback_lock.Unlock();
+    }
+
+    // Called on the emulator thread, runs rewind_checkpoint and runahead_checkpoint once the cpu has stopped
+    void RequestCheckpoint()
+    {
+        checkpoint_requested = true;
+        callback_lock.Lock();
+        if (sh4_cpu->IsRunning())
+            sh4_cpu->Stop();
+        callback_lock.Unlock();
     }
 
     void Resume()
@@ -1162,6 +1306,9 @@ struct Dreamcast_impl : VirtualDreamcast {
         // TODO: save state fix this
         dynamic_cast<SPG*>(sh4_cpu->GetA0Handler(A0H_SPG))->CalculateSync();
 
+        // the snapshots are of another timeline now
+        rewind_reset();
+
         cleanup_serialize(data);
         printf("Loaded state from %s size %d\n", filename.c_str(), total_size);
     }
@@ -1183,7 +1330,21 @@ struct Dreamcast_impl : VirtualDreamcast {
 
         u8* address = (u8*)addr;
 
-        if (VramLockedWrite(sh4_cpu->vram.data, address))
+        // First write to a page since the last rewind or run-ahead snapshot, if the page is also locked
+        // by the texture cache or the dynarec their handlers below still run
+        if (sh4_cpu->mram.DirtyWrite(address) || sh4_cpu->vram.DirtyWrite(address) || sh4_cpu->aica_ram.DirtyWrite(address))
+        {
+            fault_printf("DirtyWrite!\n");
+
+            return true;
+        }
+        else if (sh4_cpu->mram.WatchWrite(address))
+        {
+            fault_printf("WatchWrite!\n");
+
+            return true;
+        }
+        else if (VramLockedWrite(sh4_cpu->vram.data, address))
         {
             fault_printf("VramLockedWrite!\n");
 
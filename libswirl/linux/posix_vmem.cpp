@@ -59,21 +59,12 @@ int ashmem_create_region(const char *name, size_t size) {
 }
 #endif  // #ifdef _ANDROID
 
-void VLockedMemory::LockRegion(unsigned offset, unsigned size_bytes) {
+void VLockedMemory::SetViewProtection(u8* view, unsigned offset, unsigned size_bytes, bool writable) {
 	#ifndef TARGET_NO_EXCEPTIONS
 	size_t inpage = offset & REI_PAGE_MASK;
-	if (mprotect(&data[offset - inpage], size_bytes + inpage, PROT_READ)) {
-		die("mprotect failed ..\n");
-	}
-	#endif
-}
-
-void VLockedMemory::UnLockRegion(unsigned offset, unsigned size_bytes) {
-	#ifndef TARGET_NO_EXCEPTIONS
-	size_t inpage = offset & REI_PAGE_MASK;
-	if (mprotect(&data[offset - inpage], size_bytes + inpage, PROT_READ|PROT_WRITE)) {
+	if (mprotect(&view[offset - inpage], size_bytes + inpage, writable ? PROT_READ|PROT_WRITE : PROT_READ)) {
 		// Add some way to see why it failed? gdb> info proc mappings
-		die("mprotect  failed ..\n");
+		die("mprotect failed ..\n");
 	}
 	#endif
 }
@@ -50,17 +50,10 @@ DWORD CALLBACK dsound_thread(PVOID param)
 		{
 			verifyc(buffer->Lock(writeCursor, chunk_size, &p1, &s1, &p2, &s2, 0));
 			{
-				if (pull_callback(nullptr, 0, 0, 0) >= 512)
-				{
-					pull_callback(p1, s1 / 4, s1 / 4, 0);
-					if (p2 != nullptr)
-						pull_callback(p2, s2 / 4, s2 / 4, 0);
-				}
-				else {
-					memset(p1, 0, s1);
-					if (p2 != nullptr)
-						memset(p2, 0, s2);
-				}
+				// what isn't there yet is silence
+				pull_callback(p1, s1 / 4, s1 / 4, 0);
+				if (p2 != nullptr)
+					pull_callback(p2, s2 / 4, s2 / 4, 0);
 			}
 			buffer->Unlock(p1, s1, p2, s2);
 			writeCursor = (writeCursor + chunk_size) % bufferSize;
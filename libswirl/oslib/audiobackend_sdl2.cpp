@@ -21,25 +21,8 @@ union Sample { int16_t s[2]; uint32_t l; };
 static void sdl2_audiocb(void* userdata, Uint8* stream, int len) {
 	unsigned oslen = len / sizeof(uint32_t);
 
-	if (!needs_resampling) {
-		if (pull_callback(nullptr, 0, 0, 0) >= oslen)
-		{
-			pull_callback(stream, oslen, oslen, 0);
-		}
-		else {
-			memset(stream, 0, oslen);
-		}
-	}
-	else
-	{
-		if (pull_callback(nullptr, 0, 0, 48000) >= oslen)
-		{
-			pull_callback(stream, oslen, oslen, 48000);
-		}
-		else {
-			memset(stream, 0, oslen);
-		}
-	}
+	// what isn't there yet is silence
+	pull_callback(stream, oslen, oslen, needs_resampling ? 48000 : 0);
 }
 
 static void sdl2_audio_init(audio_backend_pull_callback_t pull_callback)
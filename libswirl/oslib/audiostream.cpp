@@ -5,6 +5,7 @@
 
 
 #include <limits.h>
+#include <atomic>
 #include "hw/holly/sb.h" // for STATIC_FORWARD
 #include "cfg/cfg.h"
 #include "oslib/threading.h"
@@ -18,13 +19,23 @@ struct SoundFrame { s16 l; s16 r; };
 WaveWriter rawout("d:\\aica_out.wav");
 #endif
 
+bool audio_skip_samples;
+
 static unsigned int audiobackends_num_max = 1;
 static unsigned int audiobackends_num_registered = 0;
 static audiobackend_t **audiobackends = NULL;
 
-static float InterpolateCatmull4pt3oX(float x0, float x1, float x2, float x3, float t) {
-	return 0.45f* ((2 * x1) + t * ((-x0 + x2) + t * ((2 * x0 - 5 * x1 + 4 * x2 - x3) + t * (-x0 + 3 * x1 - 3 * x2 + x3))));
-}
+#if HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64
+#include <emmintrin.h>
+#define AUDIO_SSE2
+#endif
+
+// Catmull-Rom over 4 frames, 0.45 * (2 x1 + t (x2 - x0) + t^2 (2 x0 - 5 x1 + 4 x2 - x3) + t^3 (-x0 + 3 x1 - 3 x2 + x3))
+// written as the weight of each frame, w = C0 + t (C1 + t (C2 + t C3))
+static const float CatmullC0[4] = { 0.0f, 0.9f, 0.0f, 0.0f };
+static const float CatmullC1[4] = { -0.45f, 0.0f, 0.45f, 0.0f };
+static const float CatmullC2[4] = { 0.9f, -2.25f, 1.8f, -0.45f };
+static const float CatmullC3[4] = { -0.45f, 1.35f, -1.35f, 0.45f };
 
 static s16 SaturateToS16(float v)
 {
@@ -35,36 +46,124 @@ static s16 SaturateToS16(float v)
 	return (s16)v;
 }
 
+AudioStats audio_stats;
+
+#define AUDIO_REPORT_SAMPLES (44100 * 10)
+
 class PullBuffer_t {
 private:
-	static const u32 SAMPLE_COUNT = 4096;
-	static const u32 OVERRUN_SKIP = 128;
+	static const u32 SAMPLE_COUNT = 8192;	// a power of two, the positions wrap around on their own
+	static const u32 MIN_FILL = 1024;
+	static constexpr double MAX_RATE_DELTA = 0.005;
 
 	SoundFrame RingBuffer[SAMPLE_COUNT];
-	const u32 RingBufferByteSize = sizeof(RingBuffer);
-	const u32 RingBufferSampleCount = SAMPLE_COUNT;
 
-	volatile u32 WritePtr;  //last WRITEN sample
-	volatile u32 ReadPtr;   //next sample to read
+	// Free running, WritePos is only stored by the emulator and ReadPos by the audio thread
+	std::atomic<u32> WritePos { 0 };
+	std::atomic<u32> ReadPos { 0 };
+
+	// Frames the rate control keeps queued, twice what the backend asks for at once. With the
+	// fps limit the emulator waits there, else it's what the resampling ratio steers to
+	std::atomic<u32> TargetFill { MIN_FILL };
 
 	u32 asRingUsedCount()
 	{
-		if (WritePtr > ReadPtr)
-			return WritePtr - ReadPtr;
-		else
-			return RingBufferSampleCount - (ReadPtr - WritePtr);
-		//s32 sz=(WritePtr+1)%RingBufferSampleCount-ReadPtr;
-		//return sz<0?sz+RingBufferSampleCount:sz;
+		return WritePos.load(std::memory_order_acquire) - ReadPos.load(std::memory_order_acquire);
 	}
 
 	u32 asRingFreeCount()
 	{
-		return RingBufferSampleCount - asRingUsedCount();
+		return SAMPLE_COUNT - asRingUsedCount();
 	}
 
-	SoundFrame Status[4] = { { 0 } };
+	// resampler, audio thread only
+#ifdef AUDIO_SSE2
+	__m128 Window[4];		// the last 4 frames as l, r, l, r
+#else
+	float Window[4][2];
+#endif
 	float current_partial_pos = 0;
+	double smoothed_fill = MIN_FILL;
+
+	void PushWindow(const SoundFrame& frame)
+	{
+#ifdef AUDIO_SSE2
+		Window[0] = Window[1];
+		Window[1] = Window[2];
+		Window[2] = Window[3];
+		Window[3] = _mm_setr_ps(frame.l, frame.r, frame.l, frame.r);
+#else
+		memmove(&Window[0], &Window[1], sizeof(Window[0]) * 3);
+		Window[3][0] = frame.l;
+		Window[3][1] = frame.r;
+#endif
+	}
+
+	SoundFrame Interpolate(float t)
+	{
+#ifdef AUDIO_SSE2
+		__m128 vt = _mm_set1_ps(t);
+		__m128 w = _mm_loadu_ps(CatmullC3);
+		w = _mm_add_ps(_mm_loadu_ps(CatmullC2), _mm_mul_ps(w, vt));
+		w = _mm_add_ps(_mm_loadu_ps(CatmullC1), _mm_mul_ps(w, vt));
+		w = _mm_add_ps(_mm_loadu_ps(CatmullC0), _mm_mul_ps(w, vt));
+
+		__m128 v = _mm_mul_ps(Window[0], _mm_shuffle_ps(w, w, _MM_SHUFFLE(0, 0, 0, 0)));
+		v = _mm_add_ps(v, _mm_mul_ps(Window[1], _mm_shuffle_ps(w, w, _MM_SHUFFLE(1, 1, 1, 1))));
+		v = _mm_add_ps(v, _mm_mul_ps(Window[2], _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 2, 2))));
+		v = _mm_add_ps(v, _mm_mul_ps(Window[3], _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 3, 3))));
+
+		// truncates like SaturateToS16 then saturates to s16, the low 32 bits are l and r
+		__m128i packed = _mm_cvttps_epi32(v);
+		packed = _mm_packs_epi32(packed, packed);
+
+		SoundFrame rv;
+		u32 lr = _mm_cvtsi128_si32(packed);
+		memcpy(&rv, &lr, sizeof(rv));
+		return rv;
+#else
+		float w[4];
+		for (int k = 0; k < 4; k++)
+			w[k] = CatmullC0[k] + t * (CatmullC1[k] + t * (CatmullC2[k] + t * CatmullC3[k]));
+
+		SoundFrame rv = {
+			SaturateToS16(w[0] * Window[0][0] + w[1] * Window[1][0] + w[2] * Window[2][0] + w[3] * Window[3][0]),
+			SaturateToS16(w[0] * Window[0][1] + w[1] * Window[1][1] + w[2] * Window[2][1] + w[3] * Window[3][1])
+		};
+		return rv;
+#endif
+	}
+
+	void UpdateTarget(u32 amt)
+	{
+		u32 target = min(amt * 2, SAMPLE_COUNT / 2);
+
+		if (target < MIN_FILL)
+			target = MIN_FILL;
+
+		TargetFill.store(target, std::memory_order_relaxed);
+	}
+
+	// The backend asks for amt frames at a time, and gets silence for the ones that aren't there
+	u32 PadSilence(SoundFrame* outbuf, u32 read, u32 amt)
+	{
+		if (read < amt)
+		{
+			memset(outbuf + read, 0, (amt - read) * sizeof(SoundFrame));
+			audio_stats.underruns++;
+		}
+
+		return read;
+	}
+
 public:
+	PullBuffer_t()
+	{
+		memset(&Window, 0, sizeof(Window));
+	}
+
+	// Returns the frames read, the rest of amt is silence. The ratio goes up to MAX_RATE_DELTA
+	// above or below 44100 / target_rate, with the fill against TargetFill
 	u32 ReadAudioResampling(void* buffer, u32 buffer_size, u32 amt, u32 target_rate)
 	{
 		if (buffer == nullptr)
@@ -72,30 +171,44 @@ public:
 
 		SoundFrame* outbuf = (SoundFrame*)buffer;
 
-		u32 read = min(min(amt, buffer_size), asRingUsedCount());
+		amt = min(amt, buffer_size);
+
+		UpdateTarget(amt);
+
+		u32 target = TargetFill.load(std::memory_order_relaxed);
+		u32 used = asRingUsedCount();
+		smoothed_fill += (used - smoothed_fill) / 16;
+
+		double error = max(-1.0, min(1.0, (smoothed_fill - target) / target));
+		double ratio = 1 + MAX_RATE_DELTA * error;
+		float inc = (float)(44100.0 / target_rate * ratio);
+
+		audio_stats.fill = used;
+		audio_stats.ratio = (float)ratio;
 
-		float inc = 44100.0f / target_rate;
+		u32 pos = ReadPos.load(std::memory_order_relaxed);
+		u32 end = pos + used;
+		u32 read;
 
-		for (int i = 0; i < read; i++)
+		for (read = 0; read < amt; read++)
 		{
-			SoundFrame res = {
-				SaturateToS16(InterpolateCatmull4pt3oX(Status[0].l,Status[1].l,Status[2].l,Status[3].l,current_partial_pos)),
-				SaturateToS16(InterpolateCatmull4pt3oX(Status[0].r,Status[1].r,Status[2].r,Status[3].r,current_partial_pos))
-			};
-			outbuf[i] = res;
-			current_partial_pos += inc;
-			while (current_partial_pos >= 1)
+			while (current_partial_pos >= 1 && pos != end)
 			{
-				Status[0] = Status[1];
-				Status[1] = Status[2];
-				Status[2] = Status[3];
-				Status[3] = RingBuffer[ReadPtr];
-				ReadPtr = (ReadPtr + 1) % RingBufferSampleCount;
+				PushWindow(RingBuffer[pos % SAMPLE_COUNT]);
+				pos++;
 				current_partial_pos -= 1;
 			}
+
+			if (current_partial_pos >= 1)
+				break;
+
+			outbuf[read] = Interpolate(current_partial_pos);
+			current_partial_pos += inc;
 		}
 
-		return read;
+		ReadPos.store(pos, std::memory_order_release);
+
+		return PadSilence(outbuf, read, amt);
 	}
 
 	u32 ReadAudio(void* buffer, u32 buffer_size, u32 amt)
@@ -103,37 +216,77 @@ public:
 		if (buffer == nullptr)
 			return asRingUsedCount();
 
-		u32 read = min(min(amt, buffer_size), asRingUsedCount());
-		u32 first = min(RingBufferSampleCount - ReadPtr, read);
-		memcpy(buffer, RingBuffer + ReadPtr, first * sizeof(SoundFrame));
+		amt = min(amt, buffer_size);
+
+		UpdateTarget(amt);
+
+		u32 pos = ReadPos.load(std::memory_order_relaxed);
+		u32 used = asRingUsedCount();
+		u32 read = min(amt, used);
+		u32 index = pos % SAMPLE_COUNT;
+		u32 first = min(SAMPLE_COUNT - index, read);
+
+		memcpy(buffer, RingBuffer + index, first * sizeof(SoundFrame));
 		if (read > first)
 		{
-			memcpy(((SoundFrame*)buffer) + first, RingBuffer,(read - first) * sizeof(SoundFrame));
+			memcpy(((SoundFrame*)buffer) + first, RingBuffer, (read - first) * sizeof(SoundFrame));
 		}
-		ReadPtr = (ReadPtr + read) % RingBufferSampleCount;
-		return read;
+		ReadPos.store(pos + read, std::memory_order_release);
+
+		audio_stats.fill = used;
+		audio_stats.ratio = 1;
+
+		return PadSilence((SoundFrame*)buffer, read, amt);
 	}
 
 	void WriteSample(s16 r, s16 l, bool wait)
 	{
-		const u32 ptr = (WritePtr + 1) % RingBufferSampleCount;
-		RingBuffer[ptr].r = r;
-		RingBuffer[ptr].l = l;
-		WritePtr = ptr;
+		if (wait)
+		{
+			// infinite?
+			while (asRingUsedCount() >= TargetFill.load(std::memory_order_relaxed))
+				SleepMs(1);
+		}
+		else if (asRingFreeCount() == 0)
+		{
+			// the reader owns ReadPos, the new sample is dropped
+			audio_stats.overruns++;
+			Report();
+			return;
+		}
+
+		u32 pos = WritePos.load(std::memory_order_relaxed);
+		RingBuffer[pos % SAMPLE_COUNT].r = r;
+		RingBuffer[pos % SAMPLE_COUNT].l = l;
+		WritePos.store(pos + 1, std::memory_order_release);
+
+		Report();
+	}
+
+private:
+	u32 report_samples = 0;
+	u32 reported_underruns = 0;
+	u32 reported_overruns = 0;
+
+	// Emulator thread, when something went wrong since the last one
+	void Report()
+	{
+		if (++report_samples < AUDIO_REPORT_SAMPLES)
+			return;
+
+		report_samples = 0;
 
-		if (asRingFreeCount() < 16)
+		u32 underruns = audio_stats.underruns;
+		u32 overruns = audio_stats.overruns;
+
+		if (underruns != reported_underruns || overruns != reported_overruns)
 		{
-			if (wait)
-			{
-				// infinite?
-				while (asRingFreeCount() < 512)
-					SleepMs(1);
-			}
-			else
-			{
-				ReadPtr = (ReadPtr + OVERRUN_SKIP) % RingBufferSampleCount;
-			}
+			printf("Audio: %u underruns, %u overruns, %u frames queued, rate %.4f\n",
+				underruns - reported_underruns, overruns - reported_overruns, (u32)audio_stats.fill, (float)audio_stats.ratio);
 		}
+
+		reported_underruns = underruns;
+		reported_overruns = overruns;
 	}
 };
 
@@ -307,7 +460,10 @@ struct AudioStream_impl : AudioStream {
 
 	u32 PullAudioCallback(void* buffer, u32 buffer_size, u32 amt, u32 target_rate)
 	{
-		if (target_rate != 0 && target_rate != 44100)
+		if (target_rate == 0)
+			target_rate = 44100;
+
+		if (target_rate != 44100 || settings.audio.RateControl)
 			return PullBuffer.ReadAudioResampling(buffer, buffer_size, amt, target_rate);
 		else
 			return PullBuffer.ReadAudio(buffer, buffer_size, amt);
@@ -324,6 +480,9 @@ struct AudioStream_impl : AudioStream {
 
 	void WriteSample(s16 r, s16 l)
 	{
+		if (audio_skip_samples)
+			return;
+
 		bool wait = settings.aica.LimitFPS;
 
 		if (IsPullMode())
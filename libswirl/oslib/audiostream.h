@@ -8,6 +8,7 @@
 #include "types.h"
 #include <tuple>
 #include <functional>
+#include <atomic>
 
 //Get used size in the ring buffer
 u32 asRingUsedCount();
@@ -43,6 +44,8 @@ typedef struct {
 typedef audio_option_t* (*audio_options_func_t)(int* option_count);
 
 
+// Reads amt frames at target_rate (0 for 44100) into buffer and returns how many were there, the
+// rest are silence. With buffer == nullptr returns the frames that can be read
 typedef std::function<u32(void* buffer, u32 buffer_size, u32 amt, u32 target_rate)> audio_backend_pull_callback_t;
 typedef void (*audio_backend_init_func_t)(audio_backend_pull_callback_t pull_callback);
 typedef u32 (*audio_backend_push_func_t)(void*, u32, bool);
@@ -66,6 +69,20 @@ audiobackend_t* GetAudioBackend(int num);
 audiobackend_t* GetAudioBackend(std::string slug);
 
 
+// Pull mode ring buffer telemetry, printed every 10 seconds of sound when there were problems
+// Written from the backend's audio thread and the emulator thread
+struct AudioStats
+{
+	std::atomic<u32> underruns;		// backend reads padded with silence, the emulator is late
+	std::atomic<u32> overruns;		// samples dropped with the ring full, the backend is late
+	std::atomic<u32> fill;			// frames queued at the last read
+	std::atomic<float> ratio;		// resampling ratio from the rate control, 1 at the nominal rate
+};
+
+extern AudioStats audio_stats;
+
+extern bool audio_skip_samples;	// drops samples instead of queuing them, for frames that are never heard
+
 struct AudioStream {
 	static AudioStream* Create();
 
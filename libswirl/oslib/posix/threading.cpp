@@ -42,7 +42,7 @@ void SleepMs(unsigned count) {
 	usleep(count * 1000);
 }
 
-cResetEvent::cResetEvent() {
+cResetEvent::cResetEvent() : state(false) {
 	pthread_mutex_init(&mutx, NULL);
 	pthread_cond_init(&cond, NULL);
 }
@@ -135,7 +135,49 @@ void palette_update()
 
 using namespace std;
 
-vector<vram_block*> VramLocks[VRAM_SIZE/REI_PAGE_SIZE];
+//Per page list of the lock blocks overlapping it. Protection is page granular,
+//so a fault invalidates everything on the page; there is no point in keeping
+//finer intervals than that. Lists are kept compact (swap-remove, no holes) so
+//the fault path only walks live blocks.
+struct vram_page
+{
+	vector<vram_block*> blocks;
+	bool locked;	//page is currently write protected
+};
+
+vram_page VramLocks[VRAM_SIZE/REI_PAGE_SIZE];
+
+VramLockStats vramlock_stats;
+u64 texture_updates;
+
+//Lock block pool
+//Blocks are allocated in slabs and recycled through a free list, textures
+//are relocked every time they get invalidated so this is a hot allocation.
+#define VRAM_BLOCK_SLAB 256
+
+static vector<vram_block*> vramblock_free;
+static vector<vram_block*> vramblock_slabs;
+
+static vram_block* vramblock_alloc()
+{
+	if (vramblock_free.empty())
+	{
+		vram_block* slab = new vram_block[VRAM_BLOCK_SLAB];
+		vramblock_slabs.push_back(slab);
+
+		for (int i = VRAM_BLOCK_SLAB - 1; i >= 0; i--)
+			vramblock_free.push_back(&slab[i]);
+	}
+
+	vram_block* rv = vramblock_free.back();
+	vramblock_free.pop_back();
+	return rv;
+}
+
+static void vramblock_release(vram_block* block)
+{
+	vramblock_free.push_back(block);
+}
 
 //List functions
 //
@@ -146,41 +188,28 @@ void vramlock_list_remove(vram_block* block)
 
 	for (u32 i=base;i<=end;i++)
 	{
-		vector<vram_block*>* list=&VramLocks[i];
-		for (size_t j=0;j<list->size();j++)
+		vector<vram_block*>& list=VramLocks[i].blocks;
+		for (size_t j=0;j<list.size();j++)
 		{
-			if ((*list)[j]==block)
+			if (list[j]==block)
 			{
-				(*list)[j]=0;
+				list[j]=list.back();
+				list.pop_back();
+				break;
 			}
 		}
 	}
 }
- 
+
 void vramlock_list_add(vram_block* block)
 {
 	u32 base = block->start/REI_PAGE_SIZE;
 	u32 end = block->end/REI_PAGE_SIZE;
 
-
 	for (u32 i=base;i<=end;i++)
-	{
-		vector<vram_block*>* list=&VramLocks[i];
-		for (u32 j=0;j<list->size();j++)
-		{
-			if ((*list)[j]==0)
-			{
-				(*list)[j]=block;
-				goto added_it;
-			}
-		}
-
-		list->push_back(block);
-added_it:
-		i=i;
-	}
+		VramLocks[i].blocks.push_back(block);
 }
- 
+
 cMutex vramlist_lock;
 
 //simple IsInRange test
@@ -191,10 +220,238 @@ inline bool IsInRange(vram_block* block,u32 offset)
 
 #if !defined(REFSW_OFFLINE)
 
+//Unprotects the pages in [first, last] that no longer back any lock, coalescing
+//runs of pages so that every contiguous range costs a single mprotect
+static void vramlock_unprotect_pages(u32 first, u32 last)
+{
+	u32 run_start = 0;
+	u32 run_len = 0;
+
+	for (u32 i = first; i <= last + 1; i++)
+	{
+		if (i <= last && VramLocks[i].locked && VramLocks[i].blocks.empty())
+		{
+			VramLocks[i].locked = false;
+			if (run_len == 0)
+				run_start = i;
+			run_len++;
+			continue;
+		}
+
+		if (run_len == 0)
+			continue;
+
+		sh4_cpu->vram.UnLockRegion(run_start * REI_PAGE_SIZE, run_len * REI_PAGE_SIZE);
+
+		//TODO: Fix this for 32M wrap as well
+		if (_nvmem_enabled() && VRAM_SIZE == 0x800000) {
+			sh4_cpu->vram.UnLockRegion(run_start * REI_PAGE_SIZE + VRAM_SIZE, run_len * REI_PAGE_SIZE);
+		}
+
+		vramlock_stats.pages_unlocked += run_len;
+		run_len = 0;
+	}
+}
+
+//Protects the pages and adds the block, with the vram list lock held
+static vram_block* vramlock_lock_wb(u32 start_offset64, u32 end_offset64, void* userdata, u32 type)
+{
+	vram_block* block=vramblock_alloc();
+
+	block->end=end_offset64;
+	block->start=start_offset64;
+	block->len=end_offset64-start_offset64+1;
+	block->userdata=userdata;
+	block->type=type;
+
+	sh4_cpu->vram.LockRegion(block->start, block->len);
+
+	//TODO: Fix this for 32M wrap as well
+	if (_nvmem_enabled() && VRAM_SIZE == 0x800000) {
+		sh4_cpu->vram.LockRegion(block->start + VRAM_SIZE, block->len);
+	}
+
+	for (u32 i = block->start/REI_PAGE_SIZE; i <= block->end/REI_PAGE_SIZE; i++)
+		VramLocks[i].locked = true;
+
+	vramlock_list_add(block);
+
+	return block;
+}
+
+//Lock blocks of the pages of a pending writeback, userdata is the VramWriteback
+#define VRAM_BLOCK_WRITEBACK 1
+
+struct VramWriteback
+{
+	u32 id;
+	u32 addr;
+	u32 row_bytes, rows, stride;
+	vector<u8> data;			//rows * stride bytes, only row_bytes of each row go to vram
+	vector<vram_block*> pages;	//a lock per page of the area, NULL once the guest wrote to it
+	void* keep;					//userdata of the texture that holds the result already
+	bool ready;
+};
+
+static std::list<VramWriteback> writebacks;
+static u32 writeback_id;
+
+//A guest write to a page of a pending writeback, the page keeps what was written
+static void vramwb_page_written(vram_block* block)
+{
+	VramWriteback* wb = (VramWriteback*)block->userdata;
+
+	wb->pages[block->start / REI_PAGE_SIZE - wb->addr / REI_PAGE_SIZE] = NULL;
+	libCore_vramlock_Unlock_block_wb(block);
+}
+
+u32 vramwb_Create(u32 addr, u32 row_bytes, u32 rows, u32 stride)
+{
+	vramlist_lock.Lock();
+
+	writebacks.emplace_back();
+	VramWriteback& wb = writebacks.back();
+
+	wb.id = ++writeback_id;
+	wb.addr = addr;
+	wb.row_bytes = row_bytes;
+	wb.rows = rows;
+	wb.stride = stride;
+	wb.keep = NULL;
+	wb.ready = false;
+
+	u32 end = addr + (rows - 1) * stride + row_bytes;
+
+	for (u32 page = addr / REI_PAGE_SIZE; page * REI_PAGE_SIZE < end; page++)
+	{
+		u32 start = max(addr, page * REI_PAGE_SIZE);
+		u32 last = min(end, (page + 1) * REI_PAGE_SIZE) - 1;
+
+		wb.pages.push_back(vramlock_lock_wb(start, last, &wb, VRAM_BLOCK_WRITEBACK));
+	}
+
+	vramlist_lock.Unlock();
+
+	return wb.id;
+}
+
+void vramwb_Ready(u32 id, vector<u8>& data, void* keep)
+{
+	vramlist_lock.Lock();
+
+	for (VramWriteback& wb : writebacks)
+	{
+		if (wb.id == id)
+		{
+			wb.data.swap(data);
+			wb.keep = keep;
+			wb.ready = true;
+			break;
+		}
+	}
+
+	vramlist_lock.Unlock();
+}
+
+//Writes the pages of the writeback the guest didn't write to. The textures on them are invalidated
+//but for keep, and the pages are written with the protection lifted, not through the fault handler
+static void vramwb_write(VramWriteback& wb, u8* vram)
+{
+	void* keep = wb.keep;
+
+	//the kept texture was reloaded from vram, without the result for the pages that weren't written
+	for (vram_block* block : wb.pages)
+	{
+		if (block == NULL)
+			keep = NULL;
+	}
+
+	u32 first = wb.addr / REI_PAGE_SIZE;
+
+	for (u32 k = 0; k < wb.pages.size(); k++)
+	{
+		if (wb.pages[k] == NULL)
+			continue;
+
+		libCore_vramlock_Unlock_block_wb(wb.pages[k]);
+		wb.pages[k] = NULL;
+
+		//the readback failed
+		if (wb.data.empty())
+			continue;
+
+		u32 page = first + k;
+		vector<vram_block*> list = VramLocks[page].blocks;
+
+		for (vram_block* block : list)
+		{
+			if (block->type != VRAM_BLOCK_WRITEBACK && block->userdata != keep)
+				rend_text_invl(block);
+		}
+
+		sh4_cpu->vram.UnLockRegion(page * REI_PAGE_SIZE, REI_PAGE_SIZE);
+		if (_nvmem_enabled() && VRAM_SIZE == 0x800000)
+			sh4_cpu->vram.UnLockRegion(page * REI_PAGE_SIZE + VRAM_SIZE, REI_PAGE_SIZE);
+
+		u32 page_start = page * REI_PAGE_SIZE;
+		u32 page_end = page_start + REI_PAGE_SIZE;
+
+		for (u32 r = 0; r < wb.rows; r++)
+		{
+			u32 row = wb.addr + r * wb.stride;
+			u32 start = max(row, page_start);
+			u32 end = min(row + wb.row_bytes, page_end);
+
+			if (start < end)
+				memcpy(&vram[start], &wb.data[start - wb.addr], end - start);
+		}
+
+		if (VramLocks[page].blocks.empty())
+		{
+			VramLocks[page].locked = false;
+			continue;
+		}
+
+		sh4_cpu->vram.LockRegion(page * REI_PAGE_SIZE, REI_PAGE_SIZE);
+		if (_nvmem_enabled() && VRAM_SIZE == 0x800000)
+			sh4_cpu->vram.LockRegion(page * REI_PAGE_SIZE + VRAM_SIZE, REI_PAGE_SIZE);
+	}
+}
+
+void vramwb_Apply()
+{
+	vramlist_lock.Lock();
+
+	//in order, a later one may cover an earlier one
+	while (!writebacks.empty() && writebacks.front().ready)
+	{
+		vramwb_write(writebacks.front(), sh4_cpu->vram.data);
+		writebacks.pop_front();
+	}
+
+	vramlist_lock.Unlock();
+}
+
+void vramwb_Drop()
+{
+	vramlist_lock.Lock();
+
+	for (VramWriteback& wb : writebacks)
+	{
+		for (vram_block* block : wb.pages)
+		{
+			if (block != NULL)
+				libCore_vramlock_Unlock_block_wb(block);
+		}
+	}
+
+	writebacks.clear();
+
+	vramlist_lock.Unlock();
+}
+
 vram_block* libCore_vramlock_Lock(u32 start_offset64,u32 end_offset64,void* userdata)
 {
-	vram_block* block=(vram_block* )malloc(sizeof(vram_block));
- 
 	if (end_offset64>(VRAM_SIZE-1))
 	{
 		msgboxf("vramlock_Lock_64: end_offset64>(VRAM_SIZE-1) \n Tried to lock area out of vram , possibly bug on the pvr plugin",MBX_OK);
@@ -207,28 +464,11 @@ vram_block* libCore_vramlock_Lock(u32 start_offset64,u32 end_offset64,void* user
 		start_offset64=0;
 	}
 
-	
-
-	block->end=end_offset64;
-	block->start=start_offset64;
-	block->len=end_offset64-start_offset64+1;
-	block->userdata=userdata;
-	block->type=64;
+	vramlist_lock.Lock();
 
-	{
-		vramlist_lock.Lock();
-	
-		sh4_cpu->vram.LockRegion(block->start, block->len);
+	vram_block* block = vramlock_lock_wb(start_offset64, end_offset64, userdata, 64);
 
-		//TODO: Fix this for 32M wrap as well
-		if (_nvmem_enabled() && VRAM_SIZE == 0x800000) {
-			sh4_cpu->vram.LockRegion(block->start + VRAM_SIZE, block->len);
-		}
-		
-		vramlock_list_add(block);
-		
-		vramlist_lock.Unlock();
-	}
+	vramlist_lock.Unlock();
 
 	return block;
 }
@@ -240,46 +480,72 @@ bool VramLockedWrite(u8* vram, u8* address)
 
 	if (offset<VRAM_SIZE)
 	{
-
 		size_t addr_hash = offset/REI_PAGE_SIZE;
-		vector<vram_block*>* list=&VramLocks[addr_hash];
-		
-		{
-			vramlist_lock.Lock();
 
-			for (size_t i=0;i<list->size();i++)
-			{
-				if ((*list)[i])
-				{
-					rend_text_invl((*list)[i]);
-				
-					if ((*list)[i])
-					{
-						msgboxf("Error : pvr is supposed to remove lock",MBX_OK);
-						dbgbreak;
-					}
+		vramlist_lock.Lock();
 
-				}
-			}
-			list->clear();
+		vector<vram_block*>& list=VramLocks[addr_hash].blocks;
 
-			
-			sh4_cpu->vram.UnLockRegion((u32)offset&(~(REI_PAGE_SIZE-1)),REI_PAGE_SIZE);
+		//it faulted, so it is protected no matter what the bookkeeping says
+		VramLocks[addr_hash].locked = true;
 
-			//TODO: Fix this for 32M wrap as well
-			if (_nvmem_enabled() && VRAM_SIZE == 0x800000) {
-				sh4_cpu->vram.UnLockRegion((u32)offset&(~(REI_PAGE_SIZE-1)) + VRAM_SIZE,REI_PAGE_SIZE);
-			}
-			
-			vramlist_lock.Unlock();
+		vramlock_stats.faults++;
+		vramlock_stats.frame_faults++;
+
+		//rend_text_invl removes the blocks from the page lists, so work off a copy
+		static vector<vram_block*> invalidated;
+		invalidated.assign(list.begin(), list.end());
+
+		u32 first = addr_hash;
+		u32 last = addr_hash;
+
+		for (size_t i=0;i<invalidated.size();i++)
+		{
+			vram_block* block = invalidated[i];
+
+			first = min(first, block->start/REI_PAGE_SIZE);
+			last = max(last, block->end/REI_PAGE_SIZE);
+
+			if (block->type == VRAM_BLOCK_WRITEBACK)
+				vramwb_page_written(block);
+			else
+				rend_text_invl(block);
+		}
+
+		if (!list.empty())
+		{
+			msgboxf("Error : pvr is supposed to remove lock",MBX_OK);
+			dbgbreak;
+			list.clear();
 		}
 
+		vramlock_stats.blocks_invalidated += invalidated.size();
+
+		//Unprotect every page that no longer backs a lock in one go. This covers
+		//the faulting page and the rest of the invalidated textures, so further
+		//writes to them don't fault again
+		vramlock_unprotect_pages(first, last);
+
+		vramlist_lock.Unlock();
+
 		return true;
 	}
 	else
 		return false;
 }
 
+void vramlock_FrameTick()
+{
+	vramlist_lock.Lock();
+
+	vramlock_stats.last_frame_faults = vramlock_stats.frame_faults;
+	if (vramlock_stats.frame_faults > vramlock_stats.peak_frame_faults)
+		vramlock_stats.peak_frame_faults = vramlock_stats.frame_faults;
+	vramlock_stats.frame_faults = 0;
+
+	vramlist_lock.Unlock();
+}
+
 //unlocks mem
 //also frees the handle
 void libCore_vramlock_Unlock_block(vram_block* block)
@@ -296,9 +562,9 @@ void libCore_vramlock_Unlock_block_wb(vram_block* block)
 		msgboxf("Error : block end is after vram , skipping unlock",MBX_OK);
 	else
 	{
+		//the pages stay protected until the next fault on them
 		vramlock_list_remove(block);
-		//more work needed
-		free(block);
+		vramblock_release(block);
 	}
 }
 
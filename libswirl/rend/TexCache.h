@@ -641,3 +641,31 @@ vram_block* vramlock_Lock_64(u32 start_offset64,u32 end_offset64,void* userdata)
 void DePosterize(u32* source, u32* dest, int width, int height);
 void UpscalexBRZ(int factor, u32* source, u32* dest, int width, int height, bool has_alpha);
 bool VramLockedWrite(u8* vram, u8* address);
+
+//VRAM write protection counters, updated under the vram list lock
+struct VramLockStats
+{
+	u64 faults;				//total protection faults handled
+	u64 blocks_invalidated;	//lock blocks invalidated by those faults
+	u64 pages_unlocked;		//pages unprotected by those faults
+
+	u32 frame_faults;		//faults since the last vblank
+	u32 last_frame_faults;	//faults during the previous frame
+	u32 peak_frame_faults;	//worst frame so far
+};
+
+extern VramLockStats vramlock_stats;
+
+//textures converted and uploaded since start
+extern u64 texture_updates;
+
+//called once per vblank to roll the per frame counters
+void vramlock_FrameTick();
+
+//Render to texture results that are read back on the render thread and written to vram on the
+//emulation thread. Every page of the area stays locked until then, the pages the guest writes to
+//in between keep the guest's data and only the others are written
+u32 vramwb_Create(u32 addr, u32 row_bytes, u32 rows, u32 stride);	//render thread, at the render
+void vramwb_Ready(u32 id, vector<u8>& data, void* keep);			//render thread, rows * stride bytes
+void vramwb_Apply();	//emulation thread, at vblank
+void vramwb_Drop();		//the state was restored
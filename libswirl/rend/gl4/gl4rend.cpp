@@ -7,6 +7,7 @@
 #include <math.h>
 #include "gl4.h"
 #include "rend/gles/glcache.h"
+#include "rend/gles/glprogcache.h"
 #include "rend/TexCache.h"
 #include "cfg/cfg.h"
 
@@ -415,7 +416,7 @@ bool gl4CompilePipelineShader(	gl4PipelineShader* s, bool rotate_90, const char
                 s->cp_AlphaTest,s->pp_ClipTestMode,s->pp_UseAlpha,
                 s->pp_Texture,s->pp_IgnoreTexA,s->pp_ShadInstr,s->pp_Offset,s->pp_FogCtrl, s->pp_TwoVolumes, s->pp_DepthFunc, s->pp_Gouraud, s->pp_BumpMap, s->fog_clamping, s->pass);
 
-	s->program = gl_CompileAndLink(vshader, pshader);
+	s->program = gl_progcache_CompileAndLink(vshader, pshader);
 
 	//setup texture 0 as the input for the shader
 	GLint gu = glGetUniformLocation(s->program, "tex0");
@@ -507,6 +508,7 @@ static void gl41_term(void)
 	glDeleteBuffers(1, &gl4.vbo.idxs2);
 	glDeleteBuffers(1, &gl4.vbo.tr_poly_params);
 	gl4_delete_shaders();
+	gl_progcache_term();
 	glDeleteVertexArrays(1, &gl4.vbo.main_vao);
 	glDeleteVertexArrays(1, &gl4.vbo.modvol_vao);
 }
@@ -573,6 +575,8 @@ static bool gl41_init()
 
 	glcache.EnableCache();
 
+	gl_progcache_init("gl4");
+
 	if (!gl4_create_resources())
 		return false;
 
@@ -1046,6 +1050,7 @@ struct gl4rend : Renderer
 		CollectCleanup();
 
 		free_output_framebuffer();
+		FreeRTTReadback();
 		gl41_term();
 	}
 
@@ -149,6 +149,8 @@ void SetMVS_Mode(ModifierVolumeMode mv_mode, ISP_Modvol ispc);
 
 void BindRTT(u32 addy, u32 fbw, u32 fbh, u32 channels, u32 fmt);
 void ReadRTTBuffer(u8* vram);
+void ResolveRTTReadback(u8* vram);
+void FreeRTTReadback();
 void RenderFramebuffer();
 void DrawFramebuffer(float w, float h);
 #if !defined(REFSW_OFFLINE)
@@ -163,7 +165,7 @@ PipelineShader *GetProgram(u32 cp_AlphaTest, u32 pp_ClipTestMode,
 							u32 pp_FogCtrl, bool pp_Gouraud, bool pp_BumpMap, bool fog_clamping, bool trilinear);
 
 GLuint gl_CompileShader(const char* shader, GLuint type);
-GLuint gl_CompileAndLink(const char* VertexShader, const char* FragmentShader);
+GLuint gl_CompileAndLink(const char* VertexShader, const char* FragmentShader, bool retrievable = false);
 bool CompilePipelineShader(PipelineShader* s);
 #define TEXTURE_LOAD_ERROR 0
 u8* loadPNGData(const string& subpath, int &width, int &height);
@@ -6,6 +6,7 @@
 
 #include <math.h>
 #include "glcache.h"
+#include "glprogcache.h"
 #include "rend/TexCache.h"
 #include "cfg/cfg.h"
 #include "gui/gui.h"
@@ -379,6 +380,8 @@ static void gl_delete_shaders()
 
 static void gles_term()
 {
+	gl_progcache_term();
+
 	glDeleteBuffers(1, &gl.vbo.geometry);
 	gl.vbo.geometry = 0;
 
@@ -398,6 +401,7 @@ static void gles_term()
 	fogTextureId = 0;
 
 	free_output_framebuffer();
+	FreeRTTReadback();
 
 	gl_delete_shaders();
 }
@@ -430,7 +434,7 @@ GLuint gl_CompileShader(const char* shader,GLuint type)
 	return rv;
 }
 
-GLuint gl_CompileAndLink(const char* VertexShader, const char* FragmentShader)
+GLuint gl_CompileAndLink(const char* VertexShader, const char* FragmentShader, bool retrievable /* = false */)
 {
 	//create shaders
 	GLuint vs=gl_CompileShader(VertexShader ,GL_VERTEX_SHADER);
@@ -454,6 +458,12 @@ GLuint gl_CompileAndLink(const char* VertexShader, const char* FragmentShader)
 		glBindFragDataLocation(program, 0, "FragColor");
 #endif
 
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+	// Tell the driver the binary will be saved in the program cache
+	if (retrievable)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+
 	glLinkProgram(program);
 
 	GLint result;
@@ -550,7 +560,7 @@ bool CompilePipelineShader(	PipelineShader* s)
                 s->pp_Texture,s->pp_IgnoreTexA,s->pp_ShadInstr,s->pp_Offset,s->pp_FogCtrl, s->pp_Gouraud, s->pp_BumpMap,
 				s->fog_clamping, s->trilinear);
 
-	s->program=gl_CompileAndLink(vshader, pshader);
+	s->program=gl_progcache_CompileAndLink(vshader, pshader);
 
 
 	//setup texture 0 as the input for the shader
@@ -665,6 +675,8 @@ bool gles_init()
 {
 	glcache.EnableCache();
 
+	gl_progcache_init("gles");
+
 	if (!gl_create_resources())
 		return false;
 
@@ -731,6 +743,8 @@ bool ProcessFrame(Renderer* renderer, u8* vram, TA_context* ctx)
 {
 	ctx->rend_inuse.Lock();
 
+	ResolveRTTReadback(vram);
+
 	if (KillTex)
 		killtex();
 
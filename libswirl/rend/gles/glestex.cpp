@@ -303,6 +303,7 @@ void TextureCacheData::Update()
 {
 	//texture state tracking stuff
 	Updates++;
+	texture_updates++;
 	dirty=0;
 
 	GLuint textype=tex->type;
@@ -633,6 +634,183 @@ void BindRTT(u32 addy, u32 fbw, u32 fbh, u32 channels, u32 fmt)
 	glViewport(0, 0, fbw, fbh);		// TODO CLIP_X/Y min?
 }
 
+// Packs a RGBA8888 read back from the RTT framebuffer into vram using the given fb_packmode
+static void WriteRTTPixels(u16 *dst, const u8 *p, u32 w, u32 h, u32 stride, u8 fb_packmode, u16 kval_bit, u8 fb_alpha_threshold)
+{
+	for (u32 l = 0; l < h; l++) {
+		switch(fb_packmode)
+		{
+		case 0: //0x0   0555 KRGB 16 bit  (default)	Bit 15 is the value of fb_kval[7].
+			for (u32 c = 0; c < w; c++) {
+				*dst++ = (((p[0] >> 3) & 0x1F) << 10) | (((p[1] >> 3) & 0x1F) << 5) | ((p[2] >> 3) & 0x1F) | kval_bit;
+				p += 4;
+			}
+			break;
+		case 1: //0x1   565 RGB 16 bit
+			for (u32 c = 0; c < w; c++) {
+				*dst++ = (((p[0] >> 3) & 0x1F) << 11) | (((p[1] >> 2) & 0x3F) << 5) | ((p[2] >> 3) & 0x1F);
+				p += 4;
+			}
+			break;
+		case 2: //0x2   4444 ARGB 16 bit
+			for (u32 c = 0; c < w; c++) {
+				*dst++ = (((p[0] >> 4) & 0xF) << 8) | (((p[1] >> 4) & 0xF) << 4) | ((p[2] >> 4) & 0xF) | (((p[3] >> 4) & 0xF) << 12);
+				p += 4;
+			}
+			break;
+		case 3://0x3    1555 ARGB 16 bit    The alpha value is determined by comparison with the value of fb_alpha_threshold.
+			for (u32 c = 0; c < w; c++) {
+				*dst++ = (((p[0] >> 3) & 0x1F) << 10) | (((p[1] >> 3) & 0x1F) << 5) | ((p[2] >> 3) & 0x1F) | (p[3] > fb_alpha_threshold ? 0x8000 : 0);
+				p += 4;
+			}
+			break;
+		}
+		dst += (stride - w * 2) / 2;
+	}
+}
+
+// Marks the textures overlapping [addr, addr + size) as dirty and removes their vram locks,
+// so that vram can be written from the render thread (deadlock on rpi)
+static void InvalidateRTTArea(u32 addr, u32 size)
+{
+	for (TexCacheIter i = TexCache.begin(); i != TexCache.end(); i++)
+	{
+		if (i->second.sa_tex <= addr + size - 1 && i->second.sa + i->second.size - 1 >= addr) {
+			i->second.dirty = FrameCount;
+			if (i->second.lock_block != NULL) {
+				libCore_vramlock_Unlock_block(i->second.lock_block);
+				i->second.lock_block = NULL;
+			}
+		}
+	}
+}
+
+// Builds the texture cache key for a render to texture target
+static void GetRTTTextureKey(u32 tex_addr, u32 w, u32 h, u8 fb_packmode, TSP& tsp, TCW& tcw)
+{
+	// TexAddr : fb_rtt.TexAddr, Reserved : 0, StrideSel : 0, ScanOrder : 1
+	tcw.full = 0;
+	tcw.TexAddr = tex_addr >> 3;
+	tcw.ScanOrder = 1;
+	switch (fb_packmode) {
+	case 0:
+	case 3:
+		tcw.PixelFmt = Pixel1555;
+		break;
+	case 1:
+		tcw.PixelFmt = Pixel565;
+		break;
+	case 2:
+		tcw.PixelFmt = Pixel4444;
+		break;
+	}
+	tsp.full = 0;
+	for (tsp.TexU = 0; tsp.TexU <= 7 && (8 << tsp.TexU) < w; tsp.TexU++);
+	for (tsp.TexV = 0; tsp.TexV <= 7 && (8 << tsp.TexV) < h; tsp.TexV++);
+}
+
+// Deferred render to texture readback
+// The framebuffer is read into a pixel buffer object right after the RTT pass, which doesn't stall
+// the pipeline, and the rendered texture stays on the GPU for the TA to use. The PBO is only
+// mapped and packed on the next frame, by which time the transfer is done, and the emulation
+// thread writes the result to vram at the following vblank (see vramwb_Apply). The pages of the
+// area the guest writes to in between keep the guest's data.
+// With run-ahead or rewind the readback is synchronous, their snapshots must hold the result.
+static struct
+{
+	GLuint pbo;
+	u32 pbo_size;
+	bool pending;
+	u32 writeback;		// vramwb_Create id
+
+	u32 w, h, stride;
+	u8 fb_packmode;
+	u16 kval_bit;
+	u8 fb_alpha_threshold;
+	bool direct;		// PBO holds 565 pixels that can be copied as is
+	TextureCacheData* texture;	// the RTT texture kept in the texture cache
+} rtt_readback;
+
+static bool RTTReadbackDeferred(u32 w, u32 h)
+{
+	// the texture cache only keeps RTT textures up to 1024x1024, larger ones are read from vram
+	return settings.rend.RenderToTextureBuffer && settings.rend.RenderToTextureDeferred && gl.gl_major >= 3
+		&& w <= 1024 && h <= 1024 && !settings.runahead.Enable && !settings.rewind.Enable;
+}
+
+void ResolveRTTReadback(u8* vram)
+{
+	if (!rtt_readback.pending)
+		return;
+	rtt_readback.pending = false;
+
+	vector<u8> data(rtt_readback.h * rtt_readback.stride);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, rtt_readback.pbo);
+	u8 *p = (u8 *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rtt_readback.pbo_size, GL_MAP_READ_BIT);
+	if (p == NULL)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		// nothing to write, the locks of the area go at the next vblank
+		data.clear();
+		vramwb_Ready(rtt_readback.writeback, data, NULL);
+		return;
+	}
+
+	if (rtt_readback.direct)
+		memcpy(data.data(), p, data.size());
+	else
+		WriteRTTPixels((u16 *)data.data(), p, rtt_readback.w, rtt_readback.h, rtt_readback.stride,
+				rtt_readback.fb_packmode, rtt_readback.kval_bit, rtt_readback.fb_alpha_threshold);
+
+	glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	vramwb_Ready(rtt_readback.writeback, data, rtt_readback.texture);
+}
+
+void FreeRTTReadback()
+{
+	// packed while the context is still there, the emulation thread writes it
+	ResolveRTTReadback(NULL);
+
+	if (rtt_readback.pbo != 0)
+		glDeleteBuffers(1, &rtt_readback.pbo);
+	rtt_readback.pbo = 0;
+	rtt_readback.pbo_size = 0;
+}
+
+static void QueueRTTReadback(u32 tex_addr, u32 w, u32 h, u32 stride, u8 fb_packmode, bool direct)
+{
+	u32 size = w * h * (direct ? 2 : 4);
+
+	if (rtt_readback.pbo == 0)
+		glGenBuffers(1, &rtt_readback.pbo);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, rtt_readback.pbo);
+	if (rtt_readback.pbo_size < size)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		rtt_readback.pbo_size = size;
+	}
+
+	if (direct)
+		glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 0);
+	else
+		glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	rtt_readback.writeback = vramwb_Create(tex_addr, w * 2, h, stride);
+	rtt_readback.w = w;
+	rtt_readback.h = h;
+	rtt_readback.stride = stride;
+	rtt_readback.fb_packmode = fb_packmode;
+	rtt_readback.kval_bit = (FB_W_CTRL.fb_kval & 0x80) << 8;
+	rtt_readback.fb_alpha_threshold = FB_W_CTRL.fb_alpha_threshold;
+	rtt_readback.direct = direct;
+	rtt_readback.texture = NULL;
+	rtt_readback.pending = true;
+}
+
 void ReadRTTBuffer(u8* vram) {
 	u32 w = pvrrc.fb_X_CLIP.max - pvrrc.fb_X_CLIP.min + 1;
 	u32 h = pvrrc.fb_Y_CLIP.max - pvrrc.fb_Y_CLIP.min + 1;
@@ -647,23 +825,34 @@ void ReadRTTBuffer(u8* vram) {
 	u32 size = w * h * 2;
 
 	const u8 fb_packmode = FB_W_CTRL.fb_packmode;
+	const bool deferred = RTTReadbackDeferred(w, h);
+
+	if (deferred)
+	{
+		// The previous readback must land before its PBO is reused
+		ResolveRTTReadback(vram);
+
+		u32 tex_addr = gl.rtt.TexAddr << 3;
+
+		// The cached copies of this area are stale from now on
+		InvalidateRTTArea(tex_addr, size);
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+		GLint color_fmt, color_type;
+		glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_FORMAT, &color_fmt);
+		glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_TYPE, &color_type);
 
-	if (settings.rend.RenderToTextureBuffer)
+		bool direct = fb_packmode == 1 && stride == w * 2 && color_fmt == GL_RGB && color_type == GL_UNSIGNED_SHORT_5_6_5;
+		QueueRTTReadback(tex_addr, w, h, stride, fb_packmode, direct);
+	}
+	else if (settings.rend.RenderToTextureBuffer)
 	{
 		u32 tex_addr = gl.rtt.TexAddr << 3;
 
 		// Manually mark textures as dirty and remove all vram locks before calling glReadPixels
 		// (deadlock on rpi)
-		for (TexCacheIter i = TexCache.begin(); i != TexCache.end(); i++)
-		{
-			if (i->second.sa_tex <= tex_addr + size - 1 && i->second.sa + i->second.size - 1 >= tex_addr) {
-				i->second.dirty = FrameCount;
-				if (i->second.lock_block != NULL) {
-					libCore_vramlock_Unlock_block(i->second.lock_block);
-					i->second.lock_block = NULL;
-				}
-			}
-		}
+		InvalidateRTTArea(tex_addr, size);
 
 		glPixelStorei(GL_PACK_ALIGNMENT, 1);
 		u16 *dst = (u16 *)&vram[tex_addr];
@@ -687,36 +876,7 @@ void ReadRTTBuffer(u8* vram) {
 			u8 *p = (u8 *)tmp_buf.data();
 			glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, p);
 
-			for (u32 l = 0; l < h; l++) {
-				switch(fb_packmode)
-				{
-				case 0: //0x0   0555 KRGB 16 bit  (default)	Bit 15 is the value of fb_kval[7].
-					for (u32 c = 0; c < w; c++) {
-						*dst++ = (((p[0] >> 3) & 0x1F) << 10) | (((p[1] >> 3) & 0x1F) << 5) | ((p[2] >> 3) & 0x1F) | kval_bit;
-						p += 4;
-					}
-					break;
-				case 1: //0x1   565 RGB 16 bit
-					for (u32 c = 0; c < w; c++) {
-						*dst++ = (((p[0] >> 3) & 0x1F) << 11) | (((p[1] >> 2) & 0x3F) << 5) | ((p[2] >> 3) & 0x1F);
-						p += 4;
-					}
-					break;
-				case 2: //0x2   4444 ARGB 16 bit
-					for (u32 c = 0; c < w; c++) {
-						*dst++ = (((p[0] >> 4) & 0xF) << 8) | (((p[1] >> 4) & 0xF) << 4) | ((p[2] >> 4) & 0xF) | (((p[3] >> 4) & 0xF) << 12);
-						p += 4;
-					}
-					break;
-				case 3://0x3    1555 ARGB 16 bit    The alpha value is determined by comparison with the value of fb_alpha_threshold.
-					for (u32 c = 0; c < w; c++) {
-						*dst++ = (((p[0] >> 3) & 0x1F) << 10) | (((p[1] >> 3) & 0x1F) << 5) | ((p[2] >> 3) & 0x1F) | (p[3] > fb_alpha_threshold ? 0x8000 : 0);
-						p += 4;
-					}
-					break;
-				}
-				dst += (stride - w * 2) / 2;
-			}
+			WriteRTTPixels(dst, p, w, h, stride, fb_packmode, kval_bit, fb_alpha_threshold);
 		}
 	}
 	else
@@ -726,28 +886,14 @@ void ReadRTTBuffer(u8* vram) {
 
     //dumpRtTexture(fb_rtt.TexAddr, w, h);
 
-    if (w > 1024 || h > 1024 || settings.rend.RenderToTextureBuffer) {
+    if (w > 1024 || h > 1024 || (settings.rend.RenderToTextureBuffer && !deferred)) {
     	glcache.DeleteTextures(1, &gl.rtt.tex);
     }
     else
     {
-    	// TexAddr : fb_rtt.TexAddr, Reserved : 0, StrideSel : 0, ScanOrder : 1
-    	TCW tcw = { { gl.rtt.TexAddr, 0, 0, 1 } };
-    	switch (fb_packmode) {
-    	case 0:
-    	case 3:
-    		tcw.PixelFmt = Pixel1555;
-    		break;
-    	case 1:
-    		tcw.PixelFmt = Pixel565;
-    		break;
-    	case 2:
-    		tcw.PixelFmt = Pixel4444;
-    		break;
-    	}
-    	TSP tsp = { 0 };
-    	for (tsp.TexU = 0; tsp.TexU <= 7 && (8 << tsp.TexU) < w; tsp.TexU++);
-    	for (tsp.TexV = 0; tsp.TexV <= 7 && (8 << tsp.TexV) < h; tsp.TexV++);
+    	TSP tsp;
+    	TCW tcw;
+    	GetRTTTextureKey(gl.rtt.TexAddr << 3, w, h, fb_packmode, tsp, tcw);
 
     	TextureCacheData *texture_data = getTextureCacheData(vram, tsp, tcw);
     	if (texture_data->texID != 0)
@@ -758,6 +904,8 @@ void ReadRTTBuffer(u8* vram) {
     	texture_data->dirty = 0;
     	if (texture_data->lock_block == NULL)
     		texture_data->lock_block = libCore_vramlock_Lock(texture_data->sa_tex, texture_data->sa + texture_data->size - 1, texture_data);
+    	if (deferred)
+    		rtt_readback.texture = texture_data;
     }
     gl.rtt.tex = 0;
 
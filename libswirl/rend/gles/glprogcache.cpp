@@ -0,0 +1,296 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#include <map>
+#include <vector>
+#include "glprogcache.h"
+#include "glcache.h"
+#include "oslib/oslib.h"
+#include "deps/xxhash/xxhash.h"
+
+#define PROGCACHE_MAGIC 0x43505752	// "RWPC"
+#define PROGCACHE_VERSION 1
+
+ProgCacheStats progcache_stats;
+
+struct progcache_entry
+{
+	GLenum format;
+	u32 compile_us;		// how long compiling it from source took
+	std::vector<u8> binary;
+};
+
+static struct
+{
+	bool enabled;
+	bool dirty;
+	string path;
+	u64 driver_hash;
+	std::map<u64, progcache_entry> entries;
+	std::map<u64, GLuint> prelinked;	// linked by the warm-up pass, not claimed yet
+} progcache;
+
+static u64 progcache_driver_hash()
+{
+	const char* strings[] = {
+		(const char*)glGetString(GL_VENDOR),
+		(const char*)glGetString(GL_RENDERER),
+		(const char*)glGetString(GL_VERSION),
+	};
+	u64 hash = PROGCACHE_VERSION;
+	for (int i = 0; i < ARRAY_SIZE(strings); i++)
+		if (strings[i] != NULL)
+			hash = XXH64(strings[i], strlen(strings[i]), hash);
+
+	return hash;
+}
+
+static u64 progcache_key(const char* VertexShader, const char* FragmentShader)
+{
+	u64 hash = XXH64(VertexShader, strlen(VertexShader), 0);
+	return XXH64(FragmentShader, strlen(FragmentShader), hash);
+}
+
+static bool progcache_supported()
+{
+#ifdef GL_NUM_PROGRAM_BINARY_FORMATS
+	if (gl.gl_major < 3 || glGetProgramBinary == NULL || glProgramBinary == NULL)
+		return false;
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+	return formats > 0;
+#else
+	return false;
+#endif
+}
+
+static void progcache_load_file()
+{
+	FILE* f = fopen(progcache.path.c_str(), "rb");
+	if (f == NULL)
+		return;
+
+	u32 header[3];
+	u64 driver_hash;
+	if (fread(header, sizeof(header), 1, f) != 1 || fread(&driver_hash, sizeof(driver_hash), 1, f) != 1
+			|| header[0] != PROGCACHE_MAGIC || header[1] != PROGCACHE_VERSION)
+	{
+		printf("Shader cache: %s is invalid, ignoring it\n", progcache.path.c_str());
+		fclose(f);
+		return;
+	}
+	if (driver_hash != progcache.driver_hash)
+	{
+		printf("Shader cache: GL driver changed, discarding %s\n", progcache.path.c_str());
+		progcache.dirty = true;
+		fclose(f);
+		return;
+	}
+
+	long data_start = ftell(f);
+	fseek(f, 0, SEEK_END);
+	long file_size = ftell(f);
+	fseek(f, data_start, SEEK_SET);
+
+	for (u32 i = 0; i < header[2]; i++)
+	{
+		u64 key;
+		u32 info[3];	// format, compile_us, size
+		if (fread(&key, sizeof(key), 1, f) != 1 || fread(info, sizeof(info), 1, f) != 1)
+			break;
+
+		// a truncated or corrupt file, the rest isn't read
+		if (info[2] == 0 || info[2] > (u64)(file_size - ftell(f)))
+		{
+			printf("Shader cache: %s is truncated, ignoring the rest\n", progcache.path.c_str());
+			progcache.dirty = true;
+			break;
+		}
+
+		progcache_entry& entry = progcache.entries[key];
+		entry.format = info[0];
+		entry.compile_us = info[1];
+		entry.binary.resize(info[2]);
+		if (fread(entry.binary.data(), info[2], 1, f) != 1)
+		{
+			progcache.entries.erase(key);
+			break;
+		}
+	}
+	fclose(f);
+
+	printf("Shader cache: %d programs in %s\n", (int)progcache.entries.size(), progcache.path.c_str());
+}
+
+static void progcache_save_file()
+{
+	FILE* f = fopen(progcache.path.c_str(), "wb");
+	if (f == NULL)
+	{
+		printf("Shader cache: can't write %s\n", progcache.path.c_str());
+		return;
+	}
+
+	u32 header[3] = { PROGCACHE_MAGIC, PROGCACHE_VERSION, (u32)progcache.entries.size() };
+	fwrite(header, sizeof(header), 1, f);
+	fwrite(&progcache.driver_hash, sizeof(progcache.driver_hash), 1, f);
+
+	for (auto& it : progcache.entries)
+	{
+		u32 info[3] = { it.second.format, it.second.compile_us, (u32)it.second.binary.size() };
+		fwrite(&it.first, sizeof(it.first), 1, f);
+		fwrite(info, sizeof(info), 1, f);
+		fwrite(it.second.binary.data(), it.second.binary.size(), 1, f);
+	}
+	fclose(f);
+}
+
+// Links a program from a cached binary. Returns 0 if the driver rejects it
+static GLuint progcache_link_binary(const progcache_entry& entry)
+{
+#ifdef GL_NUM_PROGRAM_BINARY_FORMATS
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, entry.format, entry.binary.data(), entry.binary.size());
+
+	GLint result = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &result);
+	if (result)
+		return program;
+
+	glDeleteProgram(program);
+#endif
+	return 0;
+}
+
+static void progcache_warmup()
+{
+	double start = os_GetSeconds();
+
+	for (auto it = progcache.entries.begin(); it != progcache.entries.end(); )
+	{
+		GLuint program = progcache_link_binary(it->second);
+		if (program == 0)
+		{
+			it = progcache.entries.erase(it);
+			progcache.dirty = true;
+			continue;
+		}
+		progcache.prelinked[it->first] = program;
+		progcache_stats.prelinked++;
+		it++;
+	}
+
+	progcache_stats.load_time += os_GetSeconds() - start;
+
+	if (progcache_stats.prelinked != 0)
+		printf("Shader cache: warm-up linked %d programs in %.1f ms\n", progcache_stats.prelinked, (os_GetSeconds() - start) * 1000);
+}
+
+void gl_progcache_init(const char* name)
+{
+	if (progcache.enabled)
+		gl_progcache_term();
+
+	memset(&progcache_stats, 0, sizeof(progcache_stats));
+
+	if (!settings.rend.ShaderCache || !progcache_supported())
+		return;
+
+	progcache.enabled = true;
+	progcache.dirty = false;
+	progcache.path = get_writable_data_path(string(DATA_PATH "shadercache_") + name + ".bin");
+	progcache.driver_hash = progcache_driver_hash();
+
+	progcache_load_file();
+
+	if (settings.rend.ShaderCacheWarmup)
+		progcache_warmup();
+}
+
+void gl_progcache_term()
+{
+	if (!progcache.enabled)
+		return;
+
+	for (auto& it : progcache.prelinked)
+		glcache.DeleteProgram(it.second);
+	progcache.prelinked.clear();
+
+	if (progcache.dirty)
+		progcache_save_file();
+	progcache.entries.clear();
+	progcache.enabled = false;
+
+	if (progcache_stats.compiled != 0 || progcache_stats.loaded != 0)
+		printf("Shader cache: %d compiled in %.1f ms, %d from cache in %.1f ms (%.1f ms of compiling avoided)\n",
+				progcache_stats.compiled, progcache_stats.compile_time * 1000,
+				progcache_stats.loaded, progcache_stats.load_time * 1000,
+				progcache_stats.time_saved * 1000);
+}
+
+GLuint gl_progcache_CompileAndLink(const char* VertexShader, const char* FragmentShader)
+{
+	if (!progcache.enabled)
+		return gl_CompileAndLink(VertexShader, FragmentShader);
+
+	u64 key = progcache_key(VertexShader, FragmentShader);
+
+	auto prelinked = progcache.prelinked.find(key);
+	if (prelinked != progcache.prelinked.end())
+	{
+		GLuint program = prelinked->second;
+		progcache.prelinked.erase(prelinked);
+
+		progcache_stats.loaded++;
+		progcache_stats.time_saved += progcache.entries[key].compile_us / 1000000.0;
+		glcache.UseProgram(program);
+
+		return program;
+	}
+
+	auto cached = progcache.entries.find(key);
+	if (cached != progcache.entries.end())
+	{
+		double start = os_GetSeconds();
+		GLuint program = progcache_link_binary(cached->second);
+		if (program != 0)
+		{
+			progcache_stats.loaded++;
+			progcache_stats.load_time += os_GetSeconds() - start;
+			progcache_stats.time_saved += cached->second.compile_us / 1000000.0;
+			glcache.UseProgram(program);
+
+			return program;
+		}
+		// Rejected by the driver, rebuild it
+		progcache.entries.erase(cached);
+	}
+
+	double start = os_GetSeconds();
+	GLuint program = gl_CompileAndLink(VertexShader, FragmentShader, true);
+	double compile_time = os_GetSeconds() - start;
+
+	progcache_stats.compiled++;
+	progcache_stats.compile_time += compile_time;
+
+#ifdef GL_NUM_PROGRAM_BINARY_FORMATS
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length > 0)
+	{
+		progcache_entry& entry = progcache.entries[key];
+		entry.binary.resize(length);
+		entry.compile_us = (u32)(compile_time * 1000000);
+		glGetProgramBinary(program, length, &length, &entry.format, entry.binary.data());
+		entry.binary.resize(length);
+		progcache.dirty = true;
+	}
+#endif
+
+	return program;
+}
@@ -0,0 +1,41 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#pragma once
+#include "gles.h"
+
+/*
+	Persistent GL program binary cache
+
+	Linked programs are saved with glGetProgramBinary, keyed by a hash of the shader
+	sources. The sources already encode the pipeline permutation (alpha test, clip mode,
+	texture, fog, offset, ...), the GLSL header and Rotate90, so a stale entry can't be
+	picked up by mistake. The whole cache is dropped when the GL vendor, renderer or
+	version strings change.
+
+	With rend.ShaderCacheWarmup, every cached program is relinked from its binary at
+	renderer init so that the first use of a permutation mid-game doesn't hitch.
+*/
+
+struct ProgCacheStats
+{
+	u32 compiled;			// programs compiled from source
+	u32 loaded;				// programs loaded from a binary
+	u32 prelinked;			// programs relinked by the warm-up pass
+	double compile_time;	// seconds spent compiling from source
+	double load_time;		// seconds spent loading binaries
+	double time_saved;		// original compile time of the loaded programs
+};
+
+extern ProgCacheStats progcache_stats;
+
+// name selects the cache file, one per renderer
+void gl_progcache_init(const char* name);
+// saves the cache if it changed and frees the unclaimed warm-up programs
+void gl_progcache_term();
+
+// gl_CompileAndLink, going through the cache
+GLuint gl_progcache_CompileAndLink(const char* VertexShader, const char* FragmentShader);
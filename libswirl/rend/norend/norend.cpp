@@ -36,8 +36,7 @@ struct norend : Renderer
 
 #include "hw/pvr/Renderer_if.h"
 
-#if FEAT_TA == TA_HLE
 Renderer* rend_norend(u8* vram) { return new ::norend(); }
 
-static auto norend = RegisterRendererBackend(rendererbackend_t{ "none", "No PVR Rendering", -2, rend_norend });
-#endif
\ No newline at end of file
+// also with the lle ta, the benchmark mode runs headless on it
+static auto norend = RegisterRendererBackend(rendererbackend_t{ "none", "No PVR Rendering", -2, rend_norend });
\ No newline at end of file
@@ -88,6 +88,7 @@ u32 decoded_colors[3][65536];
 #include <memory>
 #include <atomic>
 #include <queue>
+#include <chrono>
 
 extern u32 decoded_colors[3][65536];
 
@@ -111,47 +112,269 @@ void refsw_dump() {
 }
 
 
+// Max tiles in a frame (tilex / tiley are 6 bits in the region array)
+#define REF_MAX_TILES (64 * 64)
+
+/*
+    A frame's worth of tile jobs
+
+    Region array entries for the same tile are chained in region array order, and the whole chain
+    is a single job so z_keep passes see the buffers of the previous pass on the same backend.
+*/
+struct RefTileJob {
+    u32 first_entry;    // index in RefTileFrame::entries
+    u32 tile_id;
+};
+
+struct RefTileFrame {
+    vector<RegionArrayEntry> entries;
+    vector<u32> entry_next;             // next entry for the same tile, or ~0
+    vector<RefTileJob> jobs;
+
+    u32 job_for_tile[REF_MAX_TILES];
+    u32 last_for_tile[REF_MAX_TILES];
+
+    void Clear() {
+        entries.clear();
+        entry_next.clear();
+        jobs.clear();
+        memset(job_for_tile, 0xFF, sizeof(job_for_tile));
+    }
+
+    void Add(const RegionArrayEntry& entry) {
+        u32 tile_id = entry.control.tiley * 64 + entry.control.tilex;
+        u32 idx = (u32)entries.size();
+
+        entries.push_back(entry);
+        entry_next.push_back(~0u);
+
+        if (job_for_tile[tile_id] == ~0u) {
+            job_for_tile[tile_id] = (u32)jobs.size();
+            jobs.push_back({ idx, tile_id });
+        } else {
+            entry_next[last_for_tile[tile_id]] = idx;
+        }
+
+        last_for_tile[tile_id] = idx;
+    }
+};
+
+/*
+    Chase-Lev work stealing deque
+
+    The owner pops from the bottom, other workers steal from the top. Pushes only happen while the
+    workers are parked (between frames), so the deque never needs to grow.
+*/
+struct RefWorkDeque {
+    atomic<s64> top;
+    atomic<s64> bottom;
+    atomic<u32> items[REF_MAX_TILES];
+
+    RefWorkDeque() : top(0), bottom(0) { }
+
+    void Reset() {
+        top.store(0, memory_order_relaxed);
+        bottom.store(0, memory_order_relaxed);
+    }
+
+    void Push(u32 item) {
+        s64 b = bottom.load(memory_order_relaxed);
+        items[b % REF_MAX_TILES].store(item, memory_order_relaxed);
+        bottom.store(b + 1, memory_order_release);
+    }
+
+    bool Pop(u32* item) {
+        s64 b = bottom.load(memory_order_relaxed) - 1;
+        bottom.store(b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        s64 t = top.load(memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, memory_order_relaxed);
+            return false;
+        }
+
+        *item = items[b % REF_MAX_TILES].load(memory_order_relaxed);
+
+        if (t == b) {
+            // last item, race against the stealers
+            bool won = top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+            bottom.store(b + 1, memory_order_relaxed);
+            return won;
+        }
+
+        return true;
+    }
+
+    bool Steal(u32* item) {
+        s64 t = top.load(memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        s64 b = bottom.load(memory_order_acquire);
+
+        if (t >= b)
+            return false;
+
+        *item = items[t % REF_MAX_TILES].load(memory_order_relaxed);
+
+        return top.compare_exchange_strong(t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+    }
+
+    bool Empty() {
+        return top.load(memory_order_acquire) >= bottom.load(memory_order_acquire);
+    }
+};
+
+RefRendFrameStats refrend_stats;
+
+#if defined(REFSW_OFFLINE)
+string refrend_png_path = "FB_W_SOF1.png";
+#endif
+
+static double RefTimeMs() {
+    return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Accumulates the time since the previous lap into a stage counter
+struct RefStageTimer {
+    double last;
+
+    RefStageTimer() : last(RefTimeMs()) { }
+
+    void Lap(double* stage) {
+        double now = RefTimeMs();
+        *stage += now - last;
+        last = now;
+    }
+};
+
+struct RefWorkerStats {
+    u32 tiles;
+    u32 steals;
+    double tile_ms;
+    double isp_ms;
+    double tsp_ms;
+    double slowest_tile_ms;
+    u32 slowest_tile_id;
+
+    void Clear() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    void AddTile(u32 tile_id, double ms) {
+        tiles++;
+        tile_ms += ms;
+        if (ms > slowest_tile_ms) {
+            slowest_tile_ms = ms;
+            slowest_tile_id = tile_id;
+        }
+    }
+};
+
 struct RefThreadPool {
+    typedef function<void(RefRendInterface* backend, const RefTileJob& job, RefWorkerStats* stats)> TileFn;
+
     vector<cThread> threads;
-    vector<queue<function<void(RefRendInterface*)>>> queues;
+    vector<unique_ptr<RefWorkDeque>> deques;
+    vector<RefWorkerStats> stats;
     vector<cResetEvent> eventHasWork;
     vector<cResetEvent> eventDoneWork;
 
     queue<function<void()>> queueMainThread;
 
     atomic<bool> running;
-    cMutex queue_lock;
+    cMutex main_lock;
 
-    RefThreadPool() : running(false) {
+    const vector<RefTileJob>* jobs;
+    TileFn renderTile;
+    int frameNum;
+
+    RefThreadPool() : running(false), jobs(nullptr), frameNum(0) {
         
     }
 
     void enqueueMainThread(function<void()> fn) {
-        queue_lock.Lock();
+        main_lock.Lock();
         queueMainThread.push(fn);
-        queue_lock.Unlock();
+        main_lock.Unlock();
     }
 
     void pumpMainThread() {
-        queue_lock.Lock();
+        main_lock.Lock();
         while (queueMainThread.size() != 0) {
             auto fn = queueMainThread.front();
             queueMainThread.pop();
-            queue_lock.Unlock();
+            main_lock.Unlock();
             fn();
-            queue_lock.Lock();
+            main_lock.Lock();
+        }
+        main_lock.Unlock();
+    }
+
+    // Spread the frame's jobs over the workers in contiguous runs (neighbouring tiles share textures)
+    // and wake the first one, which starts the frame and wakes the rest. Must only be called while
+    // the workers are parked.
+    void runJobs(const vector<RefTileJob>& frameJobs, int frame) {
+        verify(deques.size() != 0);
+
+        jobs = &frameJobs;
+        frameNum = frame;
+
+        auto count = frameJobs.size();
+        auto workers = deques.size();
+
+        for (size_t i = 0; i < workers; i++) {
+            deques[i]->Reset();
+            stats[i].Clear();
+
+            // pushed in reverse so the owner pops them in region array order
+            for (size_t j = count * (i + 1) / workers; j-- > count * i / workers; ) {
+                deques[i]->Push((u32)j);
+            }
         }
-        queue_lock.Unlock();
+
+        eventHasWork[0].Set();
     }
 
-    void enqueueWorkThread(int tileId, function<void(RefRendInterface*)> fn) {
-        verify(queues.size() != 0);
+    // Run local jobs, then steal from the other workers until every deque is empty. Nothing is added
+    // after runJobs, so the tiles still being rendered then are the other workers' and waitWorkThreads
+    // blocks on those
+    void drain(int id, RefRendInterface* backend) {
+        auto& own = *deques[id];
+        auto workers = deques.size();
+
+        for (;;) {
+            u32 jobId;
+            bool stolen = false;
+
+            if (!own.Pop(&jobId)) {
+                bool found = false;
+                for (size_t i = 1; i < workers && !found; i++) {
+                    found = deques[(id + i) % workers]->Steal(&jobId);
+                }
+
+                if (!found) {
+                    bool empty = true;
+                    for (size_t i = 0; i < workers && empty; i++) {
+                        empty = deques[i]->Empty();
+                    }
+
+                    if (empty)
+                        break;
+
+                    // a steal lost a race for a tile, there are more
+                    continue;
+                }
+
+                stolen = true;
+            }
 
-        auto queueId = tileId % queues.size();
-        queue_lock.Lock();
-        queues[queueId].push(fn);
-        eventHasWork[queueId].Set();
-        queue_lock.Unlock();
+            auto& job = (*jobs)[jobId];
+
+            double start = RefTimeMs();
+            renderTile(backend, job, &stats[id]);
+            stats[id].AddTile(job.tile_id, RefTimeMs() - start);
+            stats[id].steals += stolen;
+        }
     }
 
     static void* ThreadPoolEntry(void* func) {
@@ -164,15 +387,21 @@ struct RefThreadPool {
         return nullptr;
     }
 
-    bool Init(int threadCount, function<RefRendInterface*()> createBackend) {
+    bool Init(int threadCount, function<RefRendInterface*()> createBackend, TileFn tileFn) {
 
         running = true;
+        renderTile = tileFn;
 
-        queues.reserve(threadCount);
+        deques.reserve(threadCount);
         threads.reserve(threadCount);
+        stats.resize(threadCount);
         eventHasWork.resize(threadCount); // resize not reserve
         eventDoneWork.resize(threadCount);
 
+        for (int i = 0; i < threadCount; i++) {
+            deques.push_back(unique_ptr<RefWorkDeque>(new RefWorkDeque()));
+        }
+
         for (int i = 0; i < threadCount; i++) {
             auto func = new function<void()>([=]() {
                 unique_ptr<RefRendInterface> backend;
@@ -181,26 +410,29 @@ struct RefThreadPool {
 
                 backend->Init();
 
-                while (running) {
-                    queue_lock.Lock();
-                    if (queues[i].size() == 0)
-                    {
-                        queue_lock.Unlock();
-                        eventDoneWork[i].Set();
-                        eventHasWork[i].Wait();
-                        continue;
+                for (;;) {
+                    eventHasWork[i].Wait();
+
+                    if (!running)
+                        break;
+
+                    // once per frame, before any tile
+                    if (i == 0) {
+                        backend->DebugOnFrameStart(frameNum);
+
+                        for (size_t w = 1; w < eventHasWork.size(); w++) {
+                            eventHasWork[w].Set();
+                        }
                     }
-                    auto item = queues[i].front();
-                    queues[i].pop();
-                    queue_lock.Unlock();
 
-                    item(backend.get());
+                    drain(i, backend.get());
+
+                    eventDoneWork[i].Set();
                 }
 
                 backend.reset();
             });
 
-            queues.push_back(queue<function<void(RefRendInterface*)>>());
             threads.push_back(cThread(ThreadPoolEntry, func));
 
             threads[threads.size() - 1].Start();
@@ -209,18 +441,10 @@ struct RefThreadPool {
         return true;
     }
 
+    // Wait for every worker to finish and park
     void waitWorkThreads() {
-        for (int i = 0; i < threads.size(); i++) {
-            for (;;) {
-                queue_lock.Lock();
-                bool empty = queues[i].size() == 0;
-                queue_lock.Unlock();
-
-                if (empty)
-                    break;
-                else
-                    eventDoneWork[i].Wait();
-            }
+        for (auto& event : eventDoneWork) {
+            event.Wait();
         }
     }
 
@@ -251,24 +475,21 @@ struct refrend : Renderer
     u8* vram;
 
     RefThreadPool pool;
+    RefTileFrame frame;
     int numRenders = 0;
 
+    // Writeouts always run on the main thread
+    double writeout_ms = 0;
+
     refrend(u8* vram, function<RefRendInterface*()> createBackend) : vram(vram), createBackend(createBackend) {
         if (MAX_CPU_COUNT == 0) {
             backend.reset(createBackend());
 
             backend->Init();
         } else {
-            pool.Init(MAX_CPU_COUNT, createBackend);
-        }
-    }
-
-    //queue a tile to the correct thread, or render it immediately if threading is disabled 
-    void EnqueueTile(int tileId, function<void(RefRendInterface*)> fn) {
-        if (!pool.running) {
-            fn(backend.get());
-        } else {
-            pool.enqueueWorkThread(tileId, fn);
+            pool.Init(MAX_CPU_COUNT, createBackend, [this](RefRendInterface* backend, const RefTileJob& job, RefWorkerStats* stats) {
+                RenderTileJob(backend, job, stats);
+            });
         }
     }
 
@@ -587,144 +808,218 @@ struct refrend : Renderer
 
         RegionArrayEntry entry;
 
-        EnqueueTile(0, [=](RefRendInterface* backend){
-            backend->DebugOnFrameStart(numRenders);
-        });
+        double parse_start = RefTimeMs();
+        writeout_ms = 0;
 
         // Parse region array
+        frame.Clear();
         do {
             base += ReadRegionArrayEntry(base, &entry);
-            EnqueueTile(entry.control.tiley * 64 + entry.control.tilex, [=](RefRendInterface* backend) {
-                taRECT rect;
-                rect.top = entry.control.tiley * 32;
-                rect.left = entry.control.tilex * 32;
+            frame.Add(entry);
+        } while (!entry.control.last_region);
 
-                rect.bottom = rect.top + 32;
-                rect.right = rect.left + 32;
+        double start = RefTimeMs();
+        double parse_ms = start - parse_start;
 
-                parameter_tag_t bgTag;
+        if (!pool.running) {
+            RefWorkerStats stats;
+            stats.Clear();
 
-                backend->DebugOnTileStart(rect.left, rect.top);
+            backend->DebugOnFrameStart(numRenders);
 
-                // register BGPOLY to fpu
-                {
-                    DrawParameters params;
-                    Vertex vtx[8];
-                    decode_pvr_vetrices(&params, PARAM_BASE + ISP_BACKGND_T.tag_address * 4, ISP_BACKGND_T.skip, ISP_BACKGND_T.shadow, vtx, 8);
-                    bgTag = backend->AddFpuEntry(&params, &vtx[ISP_BACKGND_T.tag_offset], RM_OPAQUE, ISP_BACKGND_T);
-                }
+            for (auto& job : frame.jobs) {
+                double tile_start = RefTimeMs();
+                RenderTileJob(backend.get(), job, &stats);
+                stats.AddTile(job.tile_id, RefTimeMs() - tile_start);
+            }
 
-                // Tile needs clear?
-                if (!entry.control.z_keep)
-                {
-                    // Clear Param + Z + stencil buffers
-                    backend->ClearBuffers(bgTag, ISP_BACKGND_D.f, 0);
-                }
+            UpdateStats(&stats, 1, RefTimeMs() - start, parse_ms);
+        } else {
+            pool.runJobs(frame.jobs, numRenders);
 
-                // Render OPAQ to TAGS
-                if (!entry.opaque.empty)
-                {
-                    RenderObjectList(backend, RM_OPAQUE, entry.opaque.ptr_in_words * 4, &rect);
-                }
+            pool.pumpMainThread();
+            pool.waitWorkThreads();
+            pool.pumpMainThread();
 
-                // render PT to TAGS
-                if (!entry.puncht.empty)
-                {
-                    RenderObjectList(backend, RM_PUNCHTHROUGH, entry.puncht.ptr_in_words * 4, &rect);
-                }
+            UpdateStats(pool.stats.data(), (int)pool.stats.size(), RefTimeMs() - start, parse_ms);
+        }
 
-                //TODO: Render OPAQ modvols
-                if (!entry.opaque_mod.empty)
-                {
-                    RenderObjectList(backend, RM_MODIFIER, entry.opaque_mod.ptr_in_words * 4, &rect);
-                }
+        return false;
+    }
 
-                // Render TAGS to ACCUM
-                backend->RenderParamTags(RM_OPAQUE, rect.left, rect.top);
+    void UpdateStats(const RefWorkerStats* workers, int count, double frame_ms, double parse_ms) {
+        RefRendFrameStats rv = { };
 
-                // layer peeling rendering
-                if (!entry.trans.empty)
-                {
-                    // clear the param buffer
-                    backend->ClearParamBuffer(TAG_INVALID);
+        rv.threads = count;
+        rv.frame_ms = frame_ms;
+        rv.parse_ms = parse_ms;
+        rv.writeout_ms = writeout_ms;
 
-                    int layers = 0;
-                    do
-                    {
-                        // prepare for a new pass
-                        backend->ClearPixelsDrawn();
+        for (int i = 0; i < count; i++) {
+            rv.tiles += workers[i].tiles;
+            rv.steals += workers[i].steals;
+            rv.tile_ms += workers[i].tile_ms;
+            rv.isp_ms += workers[i].isp_ms;
+            rv.tsp_ms += workers[i].tsp_ms;
+            rv.isp_max_ms = max(rv.isp_max_ms, workers[i].isp_ms);
+            rv.tsp_max_ms = max(rv.tsp_max_ms, workers[i].tsp_ms);
+            rv.busiest_thread_ms = max(rv.busiest_thread_ms, workers[i].tile_ms);
+
+            if (workers[i].slowest_tile_ms > rv.slowest_tile_ms) {
+                rv.slowest_tile_ms = workers[i].slowest_tile_ms;
+                rv.slowest_tile_x = workers[i].slowest_tile_id % 64;
+                rv.slowest_tile_y = workers[i].slowest_tile_id / 64;
+            }
+        }
 
-                        // copy depth test to depth reference buffer, clear depth test buffer, clear stencil
-                        backend->PeelBuffers(FLT_MAX, 0);
+        refrend_stats = rv;
+    }
 
-                        // render to TAGS
-                        RenderObjectList(backend, RM_TRANSLUCENT, entry.trans.ptr_in_words * 4, &rect);
+    // Render all the region array entries of a tile, in region array order
+    void RenderTileJob(RefRendInterface* backend, const RefTileJob& job, RefWorkerStats* stats) {
+        for (u32 e = job.first_entry; e != ~0u; e = frame.entry_next[e]) {
+            RenderRegionEntry(backend, frame.entries[e], stats);
+        }
+    }
 
-                        if (!entry.trans_mod.empty)
-                        {
-                            RenderObjectList(backend, RM_MODIFIER, entry.trans_mod.ptr_in_words * 4, &rect);
-                        }
+    // Render a single region array entry
+    void RenderRegionEntry(RefRendInterface* backend, const RegionArrayEntry& entry, RefWorkerStats* stats) {
+        RefStageTimer timer;
 
-                        // render TAGS to ACCUM
-                        // also marks TAGS as invalid, but keeps the index for coplanar sorting
-                        backend->RenderParamTags(RM_TRANSLUCENT, rect.left, rect.top);
-                    } while (backend->GetPixelsDrawn() != 0 && ++layers < 60);
-                }
+        taRECT rect;
+        rect.top = entry.control.tiley * 32;
+        rect.left = entry.control.tilex * 32;
 
-                // Copy to vram
-                if (!entry.control.no_writeout)
+        rect.bottom = rect.top + 32;
+        rect.right = rect.left + 32;
+
+        parameter_tag_t bgTag;
+
+        backend->DebugOnTileStart(rect.left, rect.top);
+
+        // register BGPOLY to fpu
+        {
+            DrawParameters params;
+            Vertex vtx[8];
+            decode_pvr_vetrices(&params, PARAM_BASE + ISP_BACKGND_T.tag_address * 4, ISP_BACKGND_T.skip, ISP_BACKGND_T.shadow, vtx, 8);
+            bgTag = backend->AddFpuEntry(&params, &vtx[ISP_BACKGND_T.tag_offset], RM_OPAQUE, ISP_BACKGND_T);
+        }
+
+        // Tile needs clear?
+        if (!entry.control.z_keep)
+        {
+            // Clear Param + Z + stencil buffers
+            backend->ClearBuffers(bgTag, ISP_BACKGND_D.f, 0);
+        }
+
+        // Render OPAQ to TAGS
+        if (!entry.opaque.empty)
+        {
+            RenderObjectList(backend, RM_OPAQUE, entry.opaque.ptr_in_words * 4, &rect);
+        }
+
+        // render PT to TAGS
+        if (!entry.puncht.empty)
+        {
+            RenderObjectList(backend, RM_PUNCHTHROUGH, entry.puncht.ptr_in_words * 4, &rect);
+        }
+
+        //TODO: Render OPAQ modvols
+        if (!entry.opaque_mod.empty)
+        {
+            RenderObjectList(backend, RM_MODIFIER, entry.opaque_mod.ptr_in_words * 4, &rect);
+        }
+
+        timer.Lap(&stats->isp_ms);
+
+        // Render TAGS to ACCUM
+        backend->RenderParamTags(RM_OPAQUE, rect.left, rect.top);
+
+        timer.Lap(&stats->tsp_ms);
+
+        // layer peeling rendering
+        if (!entry.trans.empty)
+        {
+            // clear the param buffer
+            backend->ClearParamBuffer(TAG_INVALID);
+
+            int layers = 0;
+            do
+            {
+                // prepare for a new pass
+                backend->ClearPixelsDrawn();
+
+                // copy depth test to depth reference buffer, clear depth test buffer, clear stencil
+                backend->PeelBuffers(FLT_MAX, 0);
+
+                // render to TAGS
+                RenderObjectList(backend, RM_TRANSLUCENT, entry.trans.ptr_in_words * 4, &rect);
+
+                if (!entry.trans_mod.empty)
                 {
-                    auto copy = new u8[32 * 32 * 4];
-                    memcpy(copy, backend->GetColorOutputBuffer(), 32 * 32 * 4);
+                    RenderObjectList(backend, RM_MODIFIER, entry.trans_mod.ptr_in_words * 4, &rect);
+                }
 
-                    EnqueueWriteout([=](){
-                        auto field = SCALER_CTL.fieldselect;
-                        auto interlace = SCALER_CTL.interlace;
+                timer.Lap(&stats->isp_ms);
 
-                        auto base = (interlace && field) ? FB_W_SOF2 : FB_W_SOF1;
+                // render TAGS to ACCUM
+                // also marks TAGS as invalid, but keeps the index for coplanar sorting
+                backend->RenderParamTags(RM_TRANSLUCENT, rect.left, rect.top);
 
-                        // very few configurations supported here
-                        verify(SCALER_CTL.hscale == 0);
-                        verify(SCALER_CTL.interlace == 0); // write both SOFs
-                        auto vscale = SCALER_CTL.vscalefactor;
-                        verify(vscale == 0x401 || vscale == 0x400 || vscale == 0x800);
+                timer.Lap(&stats->tsp_ms);
+            } while (backend->GetPixelsDrawn() != 0 && ++layers < 60);
+        }
 
-                        auto fb_packmode = FB_W_CTRL.fb_packmode;
-                        verify(fb_packmode == 0x1); // 565 RGB16
+        // Copy to vram
+        if (!entry.control.no_writeout)
+        {
+            auto copy = new u8[32 * 32 * 4];
+            memcpy(copy, backend->GetColorOutputBuffer(), 32 * 32 * 4);
 
-                        auto src = copy;
-                        auto bpp = 2;
-                        auto offset_bytes = entry.control.tilex * 32 * bpp + entry.control.tiley * 32 * FB_W_LINESTRIDE.stride * 8;
+            EnqueueWriteout([=](){
+                double writeout_start = RefTimeMs();
 
-                        for (int y = 0; y < 32; y++)
-                        {
-                            //auto base = (y&1) ? FB_W_SOF2 : FB_W_SOF1;
-                            auto dst = base + offset_bytes + (y)*FB_W_LINESTRIDE.stride * 8;
+                auto field = SCALER_CTL.fieldselect;
+                auto interlace = SCALER_CTL.interlace;
 
-                            for (int x = 0; x < 32; x++)
-                            {
-                                auto pixel = (((src[0] >> 3) & 0x1F) << 0) | (((src[1] >> 2) & 0x3F) << 5) | (((src[2] >> 3) & 0x1F) << 11);
-                                pvr_write_area1_16(vram, dst, pixel);
+                auto base = (interlace && field) ? FB_W_SOF2 : FB_W_SOF1;
 
-                                dst += bpp;
-                                src += 4; // skip alpha
-                            }
-                        }
+                // very few configurations supported here
+                verify(SCALER_CTL.hscale == 0);
+                verify(SCALER_CTL.interlace == 0); // write both SOFs
+                auto vscale = SCALER_CTL.vscalefactor;
+                verify(vscale == 0x401 || vscale == 0x400 || vscale == 0x800);
+
+                auto fb_packmode = FB_W_CTRL.fb_packmode;
+                verify(fb_packmode == 0x1); // 565 RGB16
 
-                        delete[] copy;
-                    });
+                auto src = copy;
+                auto bpp = 2;
+                auto offset_bytes = entry.control.tilex * 32 * bpp + entry.control.tiley * 32 * FB_W_LINESTRIDE.stride * 8;
+
+                for (int y = 0; y < 32; y++)
+                {
+                    //auto base = (y&1) ? FB_W_SOF2 : FB_W_SOF1;
+                    auto dst = base + offset_bytes + (y)*FB_W_LINESTRIDE.stride * 8;
+
+                    for (int x = 0; x < 32; x++)
+                    {
+                        auto pixel = (((src[0] >> 3) & 0x1F) << 0) | (((src[1] >> 2) & 0x3F) << 5) | (((src[2] >> 3) & 0x1F) << 11);
+                        pvr_write_area1_16(vram, dst, pixel);
+
+                        dst += bpp;
+                        src += 4; // skip alpha
+                    }
                 }
 
-                // clear the tsp cache
-                backend->ClearFpuEntries();
-            });
-        } while (!entry.control.last_region);
+                delete[] copy;
 
-        pool.pumpMainThread();
-        pool.waitWorkThreads();
-        pool.pumpMainThread();
+                writeout_ms += RefTimeMs() - writeout_start;
+            });
+        }
 
-        return false;
+        // clear the tsp cache
+        backend->ClearFpuEntries();
     }
 
 #if HOST_OS == OS_WINDOWS
@@ -947,9 +1242,7 @@ struct refrend : Renderer
         }
         
 #if defined(REFSW_OFFLINE)
-    char sname[256];
-	sprintf(sname, "FB_W_SOF1.png");
-	FILE *fp = fopen(sname, "wb");
+	FILE *fp = fopen(refrend_png_path.c_str(), "wb");
     if (fp == NULL)
     	return;
 
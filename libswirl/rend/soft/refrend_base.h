@@ -94,6 +94,31 @@ struct RefRendInterface
     virtual void DebugOnTileStart(int x, int y) { }
 };
 
+// Timing of the last rendered frame
+struct RefRendFrameStats {
+    int threads;
+    u32 tiles;                  // tile jobs (a tile with several region array entries counts once)
+    u32 steals;                 // tile jobs run by a worker other than the one they were queued on
+    double frame_ms;            // wall time of RenderPVR, excluding region array parsing
+    double parse_ms;            // region array parsing and binning into tile jobs
+    double tile_ms;             // sum of all tile render times
+    double isp_ms;              // sum of the ISP stages (triangle setup, rasterization, depth/stencil) over all workers
+    double tsp_ms;              // sum of the TSP stages (texture, shading, blending) over all workers
+    double isp_max_ms;          // ISP time of the worker that spent the most in it, comparable to frame_ms
+    double tsp_max_ms;          // TSP time of the worker that spent the most in it, comparable to frame_ms
+    double writeout_ms;         // tile writeout to the VRAM framebuffer
+    double busiest_thread_ms;   // tile render time of the most loaded worker
+    double slowest_tile_ms;
+    u32 slowest_tile_x, slowest_tile_y;
+};
+
+extern RefRendFrameStats refrend_stats;
+
+#if defined(REFSW_OFFLINE)
+// Where Present() writes the framebuffer
+extern string refrend_png_path;
+#endif
+
 Renderer* rend_refred_base(u8* vram, function<RefRendInterface*()> createBackend);
 
 RefRendInterface*  rend_refred_debug(RefRendInterface* backend);
@@ -43,6 +43,82 @@ static float mmax(float a, float b, float c, float d)
 
 static cMutex texture_lock;
 
+bool refsw_simd = true;
+bool refsw_fused = true;
+
+#if (HOST_CPU == CPU_X86 || HOST_CPU == CPU_X64) && BUILD_COMPILER != COMPILER_VC
+#include <immintrin.h>
+#define REFSW_HAS_AVX 1
+
+static bool refsw_avx_supported()
+{
+    static bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx"));
+    return supported;
+}
+
+/*
+    8-wide version of the edge test loop in RasterizeTriangle
+
+    Evaluates the half-edge functions for 8 pixels at a time, then flushes the covered
+    pixels in left to right order. The arithmetic is the same as the scalar path (no fma
+    contraction under this target) so the output is bit identical.
+*/
+__attribute__((target("avx")))
+static void RasterizeEdges_avx(refsw* backend, PixelPipeline::IspFn pixelFlush, parameter_tag_t tag, const PlaneStepper3& Z,
+                               const float C[4], const float DX[4], const float DY[4],
+                               u8* cb_y, int stride_bytes, int spanx, int spany, float minx_ps, float y_ps)
+{
+    const __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 zero = _mm256_setzero_ps();
+
+    const __m256 DY1 = _mm256_set1_ps(DY[0]);
+    const __m256 DY2 = _mm256_set1_ps(DY[1]);
+    const __m256 DY3 = _mm256_set1_ps(DY[2]);
+    const __m256 DY4 = _mm256_set1_ps(DY[3]);
+
+    for (int y = spany; y > 0; y -= 1)
+    {
+        // per row part of the half-edge functions
+        const __m256 R1 = _mm256_set1_ps(C[0] + DX[0] * y_ps);
+        const __m256 R2 = _mm256_set1_ps(C[1] + DX[1] * y_ps);
+        const __m256 R3 = _mm256_set1_ps(C[2] + DX[2] * y_ps);
+        const __m256 R4 = _mm256_set1_ps(C[3] + DX[3] * y_ps);
+
+        u8* cb_x = cb_y;
+        float x_ps = minx_ps;
+        for (int x = spanx; x > 0; x -= 8)
+        {
+            __m256 xs = _mm256_add_ps(_mm256_set1_ps(x_ps), lane);
+
+            __m256 in = _mm256_cmp_ps(_mm256_sub_ps(R1, _mm256_mul_ps(DY1, xs)), zero, _CMP_GE_OQ);
+            in = _mm256_and_ps(in, _mm256_cmp_ps(_mm256_sub_ps(R2, _mm256_mul_ps(DY2, xs)), zero, _CMP_GE_OQ));
+            in = _mm256_and_ps(in, _mm256_cmp_ps(_mm256_sub_ps(R3, _mm256_mul_ps(DY3, xs)), zero, _CMP_GE_OQ));
+            in = _mm256_and_ps(in, _mm256_cmp_ps(_mm256_sub_ps(R4, _mm256_mul_ps(DY4, xs)), zero, _CMP_GE_OQ));
+
+            u32 mask = _mm256_movemask_ps(in);
+            if (x < 8)
+                mask &= (1 << x) - 1;
+
+            while (mask)
+            {
+                int i = __builtin_ctz(mask);
+                mask &= mask - 1;
+
+                float px = x_ps + i;
+                float invW = Z.Ip(px, y_ps);
+                pixelFlush(backend, px, y_ps, invW, cb_x + i * 4, tag);
+            }
+
+            cb_x += 8 * 4;
+            x_ps = x_ps + 8;
+        }
+
+        cb_y += stride_bytes;
+        y_ps = y_ps + 1;
+    }
+}
+#endif
+
 struct refsw_impl : refsw
 {
     DECL_ALIGN(32) u32 render_buffer[MAX_RENDER_PIXELS * 6]; //param pointers + depth1 + depth2 + stencil + acum 1 + acum 2
@@ -153,7 +229,9 @@ struct refsw_impl : refsw
 
         entry.ips.Setup(params, &entry.texture, vtx[0], vtx[1], vtx[2]);
 
-        entry.tsp = pixelPipeline->GetTsp(entry.params.isp, entry.params.tsp);
+        entry.tsp = refsw_fused ? pixelPipeline->GetFusedTsp(render_mode, entry.params.isp, entry.params.tsp) : nullptr;
+        if (!entry.tsp)
+            entry.tsp = pixelPipeline->GetTsp(entry.params.isp, entry.params.tsp);
         entry.textureFetch = pixelPipeline->GetTextureFetch(entry.params.tsp);
         entry.colorCombiner = pixelPipeline->GetColorCombiner(entry.params.isp, entry.params.tsp);
         entry.blendingUnit = pixelPipeline->GetBlendingUnit(render_mode, entry.params.tsp);
@@ -269,6 +347,18 @@ struct refsw_impl : refsw
 
         auto pixelFlush = pixelPipeline->GetIsp(render_mode, params->isp);
 
+#if defined(REFSW_HAS_AVX)
+        if (refsw_simd && refsw_avx_supported())
+        {
+            const float C[4] = { C1, C2, C3, C4 };
+            const float DX[4] = { DX12, DX23, DX31, DX41 };
+            const float DY[4] = { DY12, DY23, DY31, DY41 };
+
+            RasterizeEdges_avx(this, pixelFlush, tag, Z, C, DX, DY, cb_y, stride_bytes, spanx, spany, minx_ps, y_ps);
+            return;
+        }
+#endif
+
         // Loop through pixels
         for (int y = spany; y > 0; y -= 1)
         {
@@ -17,6 +17,12 @@
 
 #define STRIDE_PIXEL_OFFSET MAX_RENDER_WIDTH
 
+// Use the wide edge test path when the host supports it (set to false to compare against the scalar path)
+extern bool refsw_simd;
+
+// Use the fused per-state TSP kernels when available (set to false to compare against the generic path)
+extern bool refsw_fused;
+
 #define PARAM_BUFFER_PIXEL_OFFSET   0
 #define DEPTH1_BUFFER_PIXEL_OFFSET  (MAX_RENDER_PIXELS*1)
 #define DEPTH2_BUFFER_PIXEL_OFFSET  (MAX_RENDER_PIXELS*2)
@@ -116,6 +122,8 @@ struct PixelPipeline {
 
     virtual IspFn GetIsp(RenderMode render_mode, ISP_TSP isp)= 0;
     virtual TspFn GetTsp(ISP_TSP isp, TSP tsp)= 0;
+    // Single routine for the whole TSP stage of a known state, or nullptr if there is none
+    virtual TspFn GetFusedTsp(RenderMode render_mode, ISP_TSP isp, TSP tsp) = 0;
     virtual TextureFetchFn GetTextureFetch(TSP tsp)= 0;
     virtual ColorCombinerFn GetColorCombiner(ISP_TSP isp, TSP tsp)= 0;
     virtual BlendingUnitFn GetBlendingUnit(RenderMode render_mode, TSP tsp) = 0;
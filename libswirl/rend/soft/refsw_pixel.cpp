@@ -29,6 +29,9 @@ struct RefPixelPipeline : PixelPipeline {
 
     TspFn PixelFlush_tspFns[2][2][2][2][4];
 
+    // UseAlpha, Texture, Offset, FogCtrl, ShadInstr, blend pair (see FusedBlendPair)
+    TspFn PixelFlush_fusedFns[2][2][2][4][4][4];
+
     TextureFetchFn PixelFlush_textureFns[2][2][2][2][2][4];
     ColorCombinerFn PixelFlush_combinerFns[2][2][4];
     BlendingUnitFn PixelFlush_alphaFns[2][2][2][8][8];
@@ -45,6 +48,28 @@ struct RefPixelPipeline : PixelPipeline {
         return PixelFlush_tspFns[tsp.UseAlpha][isp.Texture][isp.Offset][tsp.ColorClamp][tsp.FogCtrl];
     }
 
+    // Blend instruction pairs that get a fused kernel, or -1
+    static int FusedBlendPair(TSP tsp) {
+        if (tsp.SrcInstr == 1 && tsp.DstInstr == 0) return 0; // one, zero
+        if (tsp.SrcInstr == 4 && tsp.DstInstr == 5) return 1; // src alpha, inverse src alpha
+        if (tsp.SrcInstr == 1 && tsp.DstInstr == 1) return 2; // one, one
+        if (tsp.SrcInstr == 4 && tsp.DstInstr == 1) return 3; // src alpha, one
+        return -1;
+    }
+
+    virtual TspFn GetFusedTsp(RenderMode render_mode, ISP_TSP isp, TSP tsp) {
+        // punch through runs the blending unit with alpha test, clamping and the secondary accumulators are rare
+        if (render_mode == RM_PUNCHTHROUGH || tsp.ColorClamp || tsp.SrcSelect || tsp.DstSelect)
+            return nullptr;
+
+        int blend = FusedBlendPair(tsp);
+
+        if (blend < 0)
+            return nullptr;
+
+        return PixelFlush_fusedFns[tsp.UseAlpha][isp.Texture][isp.Offset][tsp.FogCtrl][tsp.ShadInstr][blend];
+    }
+
     virtual TextureFetchFn GetTextureFetch(TSP tsp) {
         return PixelFlush_textureFns[tsp.IgnoreTexA][tsp.ClampU][tsp.ClampV][tsp.FlipU][tsp.FlipV][tsp.FilterMode];
     }
@@ -407,7 +432,10 @@ struct RefPixelPipeline : PixelPipeline {
     }
 
     // Implement the full texture/shade pipeline for a pixel
-    template<bool pp_UseAlpha, bool pp_Texture, bool pp_Offset, bool pp_ColorClamp, u32 pp_FogCtrl>
+    // pp_Fused inlines the color combiner and blending unit for a known ShadInstr/SrcInstr/DstInstr,
+    // otherwise they are called through the FpuEntry
+    template<bool pp_UseAlpha, bool pp_Texture, bool pp_Offset, bool pp_ColorClamp, u32 pp_FogCtrl,
+             bool pp_Fused = false, u32 pp_ShadInstr = 0, u32 pp_SrcInst = 0, u32 pp_DstInst = 0>
     static bool PixelFlush_tsp(const FpuEntry *entry, float x, float y, float W, u8 *rb)
     {
         //auto zb = (float *)&rb[DEPTH1_BUFFER_PIXEL_OFFSET * 4];
@@ -431,11 +459,14 @@ struct RefPixelPipeline : PixelPipeline {
             }
         }
 
-        Color col = entry->colorCombiner(base, textel, offs);
+        Color col = pp_Fused ? ColorCombiner<pp_Texture, pp_Offset, pp_ShadInstr>(base, textel, offs) : entry->colorCombiner(base, textel, offs);
         
         col = FogUnit<pp_Offset, pp_ColorClamp, pp_FogCtrl>(col, 1/W, offs.a);
 
-        return entry->blendingUnit(cb, col);
+        if (pp_Fused)
+            return BlendingUnit<false, 0, 0, pp_SrcInst, pp_DstInst>(cb, col);
+        else
+            return entry->blendingUnit(cb, col);
     }
     // Lookup/create cached TSP parameters, and call PixelFlush_tsp
     static bool AlphaTest_tsp(refsw* backend, float x, float y, u8 *rb, float invW, parameter_tag_t tag)
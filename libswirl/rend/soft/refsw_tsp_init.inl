@@ -39,6 +39,33 @@
     PIXEL_FNS(1, 2)
     PIXEL_FNS(1, 3)
 
+#define FUSED_FNS(ua, tx, of, fc, sh) \
+    PixelFlush_fusedFns[ua][tx][of][fc][sh][0] = &PixelFlush_tsp<ua, tx, of, 0, fc, true, sh, 1, 0>; \
+    PixelFlush_fusedFns[ua][tx][of][fc][sh][1] = &PixelFlush_tsp<ua, tx, of, 0, fc, true, sh, 4, 5>; \
+    PixelFlush_fusedFns[ua][tx][of][fc][sh][2] = &PixelFlush_tsp<ua, tx, of, 0, fc, true, sh, 1, 1>; \
+    PixelFlush_fusedFns[ua][tx][of][fc][sh][3] = &PixelFlush_tsp<ua, tx, of, 0, fc, true, sh, 4, 1>;
+
+#define FUSED_FNS_sh(ua, tx, of, fc) \
+    FUSED_FNS(ua, tx, of, fc, 0) \
+    FUSED_FNS(ua, tx, of, fc, 1) \
+    FUSED_FNS(ua, tx, of, fc, 2) \
+    FUSED_FNS(ua, tx, of, fc, 3)
+
+#define FUSED_FNS_fc(ua, tx, of) \
+    FUSED_FNS_sh(ua, tx, of, 0) \
+    FUSED_FNS_sh(ua, tx, of, 1) \
+    FUSED_FNS_sh(ua, tx, of, 2) \
+    FUSED_FNS_sh(ua, tx, of, 3)
+
+    FUSED_FNS_fc(0, 0, 0)
+    FUSED_FNS_fc(0, 0, 1)
+    FUSED_FNS_fc(0, 1, 0)
+    FUSED_FNS_fc(0, 1, 1)
+    FUSED_FNS_fc(1, 0, 0)
+    FUSED_FNS_fc(1, 0, 1)
+    FUSED_FNS_fc(1, 1, 0)
+    FUSED_FNS_fc(1, 1, 1)
+
 #define TEXTURE_FNS(fu, fv, fm) \
     PixelFlush_textureFns[0][0][0][fu][fv][fm] = &TextureFetch<0, 0, 0, fu, fv, fm>; \
     PixelFlush_textureFns[0][0][1][fu][fv][fm] = &TextureFetch<0, 0, 1, fu, fv, fm>; \
@@ -0,0 +1,318 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#include <deque>
+#include <zlib.h>
+
+#include "rewind.h"
+#include "libswirl.h"
+#include "serialize.h"
+#include "stdclass.h"
+#include "oslib/oslib.h"
+#include "hw/sh4/sh4_if.h"
+#include "hw/sh4/sh4_sched.h"
+#include "hw/sh4/modules/mmu.h"
+#include "hw/pvr/spg.h"
+#include "hw/pvr/Renderer_if.h"
+#include "gui/gui_renderer.h"
+#include "hw/arm7/SoundCPU.h"
+
+struct RewindRegion
+{
+	VLockedMemory* mem;
+	u8* shadow;			// contents as of the newest snapshot
+};
+
+struct RewindSnapshot
+{
+	vector<u8> state;			// dc_serialize without the ram, compressed
+	u32 state_size;
+
+	// Pages written between the previous snapshot and this one, with the contents they had
+	// at the previous snapshot. Used to step back past this snapshot
+	vector<u32> undo_pages;		// region << 24 | page
+	vector<u8> undo_data;		// compressed
+};
+
+RewindStats rewind_stats;
+bool rewind_held;
+
+static RewindRegion regions[3];
+static deque<RewindSnapshot> snapshots;
+static bool rewind_active;
+static u32 frames;
+
+// reused between snapshots, these only grow
+static vector<u8> page_buf;
+static vector<u8> state_buf;
+static vector<u8> pack_buf;
+
+static void pack(vector<u8>& dst, const u8* src, u32 size)
+{
+	uLongf len = compressBound(size);
+
+	if (pack_buf.size() < len)
+		pack_buf.resize(len);
+
+	verify(compress2(pack_buf.data(), &len, src, size, Z_BEST_SPEED) == Z_OK);
+
+	dst.assign(pack_buf.begin(), pack_buf.begin() + len);
+}
+
+static void unpack(vector<u8>& dst, const vector<u8>& src, u32 size)
+{
+	uLongf len = size;
+
+	dst.resize(size);
+
+	verify(uncompress(dst.data(), &len, src.data(), src.size()) == Z_OK && len == size);
+}
+
+static u32 snapshot_bytes(const RewindSnapshot& snap)
+{
+	return snap.state.size() + snap.undo_data.size() + snap.undo_pages.size() * sizeof(u32);
+}
+
+static void rewind_snapshot()
+{
+	RewindSnapshot snap;
+
+	// The render thread only writes to vram for render to texture, the other queued frames can go on
+	rend_wait_rtt();
+
+	page_buf.clear();
+
+	for (u32 r = 0; r < ARRAY_SIZE(regions); r++)
+	{
+		VLockedMemory* mem = regions[r].mem;
+		u8* shadow = regions[r].shadow;
+
+		for (u32 i = 0; i < mem->PageCount(); i++)
+		{
+			if (!mem->dirty_pages[i])
+				continue;
+
+			u32 offset = i * REI_PAGE_SIZE;
+
+			snap.undo_pages.push_back((r << 24) | i);
+			page_buf.insert(page_buf.end(), shadow + offset, shadow + offset + REI_PAGE_SIZE);
+			memcpy(shadow + offset, mem->data + offset, REI_PAGE_SIZE);
+		}
+
+		mem->ResetDirty();
+	}
+
+	if (!page_buf.empty())
+		pack(snap.undo_data, page_buf.data(), page_buf.size());
+
+	unsigned int total_size = 0;
+	void* data = NULL;
+
+	dc_serialize(&data, &total_size, SER_NVMEM);
+
+	state_buf.resize(total_size);
+	data = state_buf.data();
+
+	dc_serialize(&data, &total_size, SER_NVMEM);
+
+	snap.state_size = total_size;
+	pack(snap.state, state_buf.data(), total_size);
+
+	rewind_stats.last_pages = snap.undo_pages.size();
+	rewind_stats.bytes += snapshot_bytes(snap);
+
+	snapshots.push_back(std::move(snap));
+
+	while (snapshots.size() > std::max(1u, settings.rewind.MaxSnapshots))
+	{
+		rewind_stats.bytes -= snapshot_bytes(snapshots.front());
+		snapshots.pop_front();
+
+		// nothing older to step back to
+		RewindSnapshot& oldest = snapshots.front();
+		rewind_stats.bytes -= snapshot_bytes(oldest);
+		vector<u32>().swap(oldest.undo_pages);
+		vector<u8>().swap(oldest.undo_data);
+		rewind_stats.bytes += snapshot_bytes(oldest);
+	}
+
+	rewind_stats.snapshots = snapshots.size();
+}
+
+// The arm7 blocks compiled from a sound ram page that is put back
+static void invalidate_arm7_page(VLockedMemory* mem, u32 offset)
+{
+	if (mem == &sh4_cpu->aica_ram)
+		sh4_cpu->GetA0H<SoundCPU>(A0H_SCPU)->InvalidateJitPages(offset, REI_PAGE_SIZE);
+}
+
+static void rewind_step()
+{
+	// nothing rendered from the frames being undone may land in vram after it is restored
+	g_GUIRenderer->WaitQueueEmpty();
+
+	sh4_cpu->ResetCache();
+
+	// Back to the newest snapshot, the pages written since then come from the shadow copies
+	for (u32 r = 0; r < ARRAY_SIZE(regions); r++)
+	{
+		VLockedMemory* mem = regions[r].mem;
+
+		for (u32 i = 0; i < mem->PageCount(); i++)
+		{
+			if (mem->dirty_pages[i])
+			{
+				memcpy(mem->data + i * REI_PAGE_SIZE, regions[r].shadow + i * REI_PAGE_SIZE, REI_PAGE_SIZE);
+				invalidate_arm7_page(mem, i * REI_PAGE_SIZE);
+			}
+		}
+	}
+
+	// And one more snapshot back, if there is one
+	if (snapshots.size() > 1)
+	{
+		RewindSnapshot& newest = snapshots.back();
+
+		if (!newest.undo_pages.empty())
+		{
+			unpack(page_buf, newest.undo_data, newest.undo_pages.size() * REI_PAGE_SIZE);
+
+			for (u32 k = 0; k < newest.undo_pages.size(); k++)
+			{
+				RewindRegion& region = regions[newest.undo_pages[k] >> 24];
+				u32 offset = (newest.undo_pages[k] & 0xFFFFFF) * REI_PAGE_SIZE;
+
+				memcpy(region.mem->data + offset, &page_buf[k * REI_PAGE_SIZE], REI_PAGE_SIZE);
+				memcpy(region.shadow + offset, &page_buf[k * REI_PAGE_SIZE], REI_PAGE_SIZE);
+				invalidate_arm7_page(region.mem, offset);
+			}
+		}
+
+		rewind_stats.bytes -= snapshot_bytes(newest);
+		snapshots.pop_back();
+	}
+
+	for (u32 r = 0; r < ARRAY_SIZE(regions); r++)
+		regions[r].mem->ResetDirty();
+
+	RewindSnapshot& snap = snapshots.back();
+
+	unpack(state_buf, snap.state, snap.state_size);
+
+	unsigned int total_size = 0;
+	void* data = state_buf.data();
+
+	verify(dc_unserialize(&data, &total_size, SER_NVMEM));
+
+	mmu_set_state();
+	sh4_sched_ffts();
+
+	dynamic_cast<SPG*>(sh4_cpu->GetA0Handler(A0H_SPG))->CalculateSync();
+
+	rewind_stats.last_pages = 0;
+	rewind_stats.snapshots = snapshots.size();
+}
+
+static bool rewind_start()
+{
+	regions[0].mem = &sh4_cpu->mram;
+	regions[1].mem = &sh4_cpu->vram;
+	regions[2].mem = &sh4_cpu->aica_ram;
+
+	rend_wait_rtt();
+
+	for (u32 r = 0; r < ARRAY_SIZE(regions); r++)
+	{
+		VLockedMemory* mem = regions[r].mem;
+
+		verify(mem->size % REI_PAGE_SIZE == 0);
+
+		if (!mem->StartDirtyTracking())
+		{
+			while (r-- > 0)
+				regions[r].mem->StopDirtyTracking();
+			return false;
+		}
+
+		regions[r].shadow = (u8*)malloc(mem->size);
+		memcpy(regions[r].shadow, mem->data, mem->size);
+	}
+
+	rewind_active = true;
+
+	rewind_snapshot();
+
+	printf("Rewind: %d snapshots, one every %d frames\n", settings.rewind.MaxSnapshots, settings.rewind.Interval);
+
+	return true;
+}
+
+// Run-ahead restores a state every frame and uses the same dirty page tracking
+static bool rewind_enabled()
+{
+	return settings.rewind.Enable && !settings.runahead.Enable;
+}
+
+void rewind_vblank()
+{
+	if (!rewind_active && !rewind_enabled())
+		return;
+
+	frames++;
+
+	if (!rewind_active || !rewind_enabled() || rewind_held || frames >= settings.rewind.Interval)
+		virtualDreamcast->RequestCheckpoint();
+}
+
+void rewind_checkpoint()
+{
+	if (!rewind_enabled())
+	{
+		rewind_reset();
+		return;
+	}
+
+	double start = os_GetSeconds();
+
+	if (!rewind_active)
+	{
+		// run-ahead was just turned off and still holds the dirty page tracking, next frame then
+		if (sh4_cpu->mram.dirty_pages)
+			return;
+
+		if (!rewind_start())
+		{
+			printf("Rewind: dirty page tracking isn't available, disabled\n");
+			settings.rewind.Enable = false;
+			return;
+		}
+	}
+	else if (rewind_held)
+		rewind_step();
+	else
+		rewind_snapshot();
+
+	frames = 0;
+	rewind_stats.last_ms = (os_GetSeconds() - start) * 1000;
+}
+
+void rewind_reset()
+{
+	if (!rewind_active)
+		return;
+
+	for (u32 r = 0; r < ARRAY_SIZE(regions); r++)
+	{
+		regions[r].mem->StopDirtyTracking();
+		free(regions[r].shadow);
+		regions[r].shadow = nullptr;
+	}
+
+	snapshots.clear();
+	rewind_stats = RewindStats();
+	rewind_active = false;
+	frames = 0;
+}
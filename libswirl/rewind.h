@@ -0,0 +1,36 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#pragma once
+#include "types.h"
+
+/*
+	Rewind keeps a ring of in-memory snapshots, one every settings.rewind.Interval frames.
+
+	Main RAM, VRAM and AICA RAM are not copied whole. They are write protected after every
+	snapshot, and only the pages written to since the previous one are stored (zlib compressed),
+	as the contents they had before. Everything else goes through dc_serialize.
+*/
+
+struct RewindStats
+{
+	u32 snapshots;		// in the ring
+	u32 bytes;			// compressed size of the whole ring
+	u32 last_pages;		// dirty pages stored by the newest snapshot
+	double last_ms;		// time taken by the newest snapshot or rewind step
+};
+
+extern RewindStats rewind_stats;
+extern bool rewind_held;	// rewind button, steps back one snapshot per frame while held
+
+// Every vblank, asks the emulator thread for a checkpoint when a snapshot or rewind step is due
+void rewind_vblank();
+
+// Emulator thread, with the cpu stopped
+void rewind_checkpoint();
+
+// Drops all snapshots and stops tracking, on reset, state load and shutdown
+void rewind_reset();
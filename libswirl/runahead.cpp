@@ -0,0 +1,314 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#include "runahead.h"
+#include "libswirl.h"
+#include "serialize.h"
+#include "stdclass.h"
+#include "oslib/oslib.h"
+#include "oslib/audiostream.h"
+#include "hw/sh4/sh4_if.h"
+#include "hw/sh4/sh4_sched.h"
+#include "hw/sh4/modules/mmu.h"
+#include "hw/sh4/dyna/blockmanager.h"
+#include "hw/holly/sh4_mem_area0.h"
+#include "hw/flashrom/flashrom.h"
+#include "hw/pvr/spg.h"
+#include "hw/pvr/Renderer_if.h"
+#include "gui/gui_renderer.h"
+#include "hw/arm7/SoundCPU.h"
+#include "hw/arm7/arm7_context.h"
+
+#ifdef FLASH_SIZE
+extern DCFlashChip sys_nvmem;
+#endif
+
+#ifdef BBSRAM_SIZE
+extern SRamChip sys_nvmem;
+#endif
+
+// frames between two printed reports
+#define RUNAHEAD_REPORT_FRAMES 600
+
+struct RunAheadRegion
+{
+	VLockedMemory* mem;
+	u8* shadow;			// contents as of the saved state
+};
+
+RunAheadStats runahead_stats;
+
+static RunAheadRegion regions[3];
+static vector<u8> state;		// dc_serialize without ram, tables, input and nvmem
+static vector<u8> nvmem_copy;
+
+static bool active;		// tracking, with a saved state
+static bool ahead;		// emulating past the saved state
+static bool pending;	// checkpoint asked for by runahead_vblank
+static u32 frame;		// ahead frames emulated so far
+
+static u32 ahead_frames()
+{
+	return std::max(1u, settings.runahead.Frames);
+}
+
+static SoundCPU* scpu()
+{
+	return sh4_cpu->GetA0H<SoundCPU>(A0H_SCPU);
+}
+
+// The arm7 blocks compiled from the lines of a sound ram page that a restore changes. The
+// sound driver's data is often in the pages of its code, and most lines put back are the same
+static void invalidate_arm7_lines(u32 offset, const u8* now, const u8* restored)
+{
+	const u32 line = 1 << ARM7_CODE_LINE_SHIFT;
+
+	for (u32 i = 0; i < REI_PAGE_SIZE; i += line)
+	{
+		if (memcmp(now + i, restored + i, line) != 0)
+			scpu()->InvalidateJitPages(offset + i, line);
+	}
+}
+
+static u32 copy_dirty_pages(bool restore)
+{
+	u32 pages = 0;
+
+	for (u32 r = 0; r < ARRAY_SIZE(regions); r++)
+	{
+		VLockedMemory* mem = regions[r].mem;
+		u8* shadow = regions[r].shadow;
+
+		for (u32 i = 0; i < mem->PageCount(); i++)
+		{
+			if (!mem->dirty_pages[i])
+				continue;
+
+			u32 offset = i * REI_PAGE_SIZE;
+
+			if (restore)
+			{
+#if FEAT_SHREC != DYNAREC_NONE
+				// blocks compiled from the page while ahead, texture cache pages fault in VramLockedWrite
+				if (mem == &sh4_cpu->mram && settings.dynarec.Enable)
+					bm_DiscardRamPage(i);
+#endif
+				// and the arm7 ones, code uploaded while ahead may be compiled
+				if (mem == &sh4_cpu->aica_ram)
+					invalidate_arm7_lines(offset, mem->data + offset, shadow + offset);
+				memcpy(mem->data + offset, shadow + offset, REI_PAGE_SIZE);
+			}
+			else
+				memcpy(shadow + offset, mem->data + offset, REI_PAGE_SIZE);
+
+			pages++;
+		}
+
+		mem->ResetDirty();
+	}
+
+	return pages;
+}
+
+static void runahead_report()
+{
+	RunAheadStats& s = runahead_stats;
+
+	if (++s.frames < RUNAHEAD_REPORT_FRAMES)
+		return;
+
+	printf("Run-ahead: %d frames ahead, save %.3f ms, restore %.3f ms, %.1f pages per frame\n",
+		ahead_frames(), s.save_ms / s.frames, s.restore_ms / s.frames, (double)s.pages / s.frames);
+
+	s = RunAheadStats();
+}
+
+static void runahead_save()
+{
+	double start = os_GetSeconds();
+
+	// The render thread writes to vram only for render to texture. The frames queued before aren't
+	// waited for, the kept frames are skipped and the last ahead one was drained by the restore
+	rend_wait_rtt();
+
+	runahead_stats.pages += copy_dirty_pages(false);
+
+	// almost never written to, and the compare is cheaper than the copy
+	if (memcmp(nvmem_copy.data(), sys_nvmem.data, sys_nvmem.size) != 0)
+		memcpy(nvmem_copy.data(), sys_nvmem.data, sys_nvmem.size);
+
+	unsigned int total_size = 0;
+	void* data = NULL;
+
+	dc_serialize(&data, &total_size, 0);
+
+	state.resize(total_size);
+	data = state.data();
+
+	dc_serialize(&data, &total_size, 0);
+
+	runahead_stats.save_ms += (os_GetSeconds() - start) * 1000;
+}
+
+static void runahead_restore()
+{
+	double start = os_GetSeconds();
+
+	// nothing rendered from the ahead frames may land in vram after it is restored
+	g_GUIRenderer->WaitQueueEmpty();
+
+	runahead_stats.pages += copy_dirty_pages(true);
+
+	if (memcmp(nvmem_copy.data(), sys_nvmem.data, sys_nvmem.size) != 0)
+		memcpy(sys_nvmem.data, nvmem_copy.data(), sys_nvmem.size);
+
+	unsigned int total_size = 0;
+	void* data = state.data();
+
+	verify(dc_unserialize(&data, &total_size, 0));
+
+	mmu_set_state();
+	sh4_sched_ffts();
+
+	dynamic_cast<SPG*>(sh4_cpu->GetA0Handler(A0H_SPG))->CalculateSync();
+
+	runahead_stats.restore_ms += (os_GetSeconds() - start) * 1000;
+}
+
+static bool runahead_start()
+{
+	regions[0].mem = &sh4_cpu->mram;
+	regions[1].mem = &sh4_cpu->vram;
+	regions[2].mem = &sh4_cpu->aica_ram;
+
+	rend_wait_rtt();
+
+	for (u32 r = 0; r < ARRAY_SIZE(regions); r++)
+	{
+		VLockedMemory* mem = regions[r].mem;
+
+		verify(mem->size % REI_PAGE_SIZE == 0);
+
+		if (!mem->StartDirtyTracking())
+		{
+			while (r-- > 0)
+				regions[r].mem->StopDirtyTracking();
+			return false;
+		}
+
+		regions[r].shadow = (u8*)malloc(mem->size);
+		memcpy(regions[r].shadow, mem->data, mem->size);
+	}
+
+	nvmem_copy.assign(sys_nvmem.data, sys_nvmem.data + sys_nvmem.size);
+
+	active = true;
+	runahead_stats = RunAheadStats();
+
+	printf("Run-ahead: %d frames\n", ahead_frames());
+
+	return true;
+}
+
+void runahead_vblank()
+{
+	if (!active)
+	{
+		pending = settings.runahead.Enable;
+	}
+	else if (!settings.runahead.Enable || !ahead)
+	{
+		// disabled, or a frame that is kept just ended
+		pending = true;
+	}
+	else
+	{
+		frame++;
+
+		// only the last ahead frame is shown, and the kept frame after the restore is not
+		rend_skip_frames = frame + 1 != ahead_frames();
+
+		pending = frame >= ahead_frames();
+	}
+
+	if (pending)
+		virtualDreamcast->RequestCheckpoint();
+}
+
+bool runahead_ahead()
+{
+	return active && ahead;
+}
+
+void runahead_checkpoint()
+{
+	if (!pending)
+		return;
+
+	pending = false;
+
+	if (!settings.runahead.Enable)
+	{
+		runahead_stop();
+		return;
+	}
+
+	if (!active)
+	{
+		// rewind was just turned off and still holds the dirty page tracking, next frame then
+		if (sh4_cpu->mram.dirty_pages)
+			return;
+
+		if (!runahead_start())
+		{
+			printf("Run-ahead: dirty page tracking isn't available, disabled\n");
+			settings.runahead.Enable = false;
+			return;
+		}
+	}
+	else if (ahead)
+	{
+		runahead_restore();
+
+		ahead = false;
+		audio_skip_samples = false;
+
+		runahead_report();
+		return;
+	}
+
+	runahead_save();
+
+	ahead = true;
+	frame = 0;
+	audio_skip_samples = true;
+	rend_skip_frames = ahead_frames() > 1;
+}
+
+void runahead_stop()
+{
+	if (!active)
+		return;
+
+	if (ahead)
+		runahead_restore();
+
+	for (u32 r = 0; r < ARRAY_SIZE(regions); r++)
+	{
+		regions[r].mem->StopDirtyTracking();
+		free(regions[r].shadow);
+		regions[r].shadow = nullptr;
+	}
+
+	vector<u8>().swap(state);
+	vector<u8>().swap(nvmem_copy);
+
+	active = false;
+	ahead = false;
+	pending = false;
+	audio_skip_samples = false;
+	rend_skip_frames = false;
+}
@@ -0,0 +1,42 @@
+/*
+	This file is part of libswirl
+*/
+#include "license/bsd"
+
+
+#pragma once
+#include "types.h"
+
+/*
+	Run-ahead hides the input lag games have on their own. After every frame the state is saved
+	in memory, settings.runahead.Frames more frames are emulated with the same input, audio and
+	video off except for the last frame which is shown, and the state is restored.
+
+	Saving and restoring only copies what changed. Main RAM, VRAM and AICA RAM are dirty page
+	tracked against a shadow copy, the flash is compared, and dc_serialize leaves out the RAM,
+	the lookup tables and the input. Code compiled from pages that get restored is dropped through
+	the usual write faults, the rest of the dynarec cache stays.
+*/
+
+struct RunAheadStats
+{
+	u32 frames;			// since the last report
+	u32 pages;			// dirty pages copied, save and restore
+	double save_ms;
+	double restore_ms;
+};
+
+extern RunAheadStats runahead_stats;
+
+// Every vblank, asks the emulator thread for a checkpoint when a save or restore is due
+void runahead_vblank();
+
+// Emulator thread, with the cpu stopped
+void runahead_checkpoint();
+
+// Emulating the frames past the saved state, they are undone by the restore
+bool runahead_ahead();
+
+// Back to the last saved state if running ahead, and stops tracking. When the emulator stops
+// for the gui, resets or shuts down
+void runahead_stop();
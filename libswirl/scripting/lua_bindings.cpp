@@ -9,6 +9,7 @@
 #include "gui/gui.h"
 #include "hw/sh4/sh4_mem.h"
 #include "libswirl.h"
+#include "stdclass.h"
 
 extern u32 vblank_count_monotonic;
 
@@ -116,7 +117,7 @@ static int emu_read_main(lua_State* L) {
 	luaL_argcheck(L, n >= 1 && n <= 2, 1, "An address argument and an optional count argument expected");
 	luaL_checkinteger(L, 1);
 	if (n==2)
-		luaL_checkinteger(L, 1);
+		luaL_checkinteger(L, 2);
 	u32 addr = (u32)lua_tointeger(L, 1);
 	if (n == 1) {
 		T mem = _read_main<T>(addr);
@@ -160,7 +161,9 @@ static int emu_write_main(lua_State* L) {
 	{
 		size_t num_results = lua_rawlen(L, 2);
 		for (size_t i = 0; i < num_results; i++) {
-			T value = (T)lua_rawgeti(L, 2, (lua_Integer)i + 1); /* In lua indices start at 1 */
+			lua_rawgeti(L, 2, (lua_Integer)i + 1); /* In lua indices start at 1 */
+			T value = (T)lua_tointeger(L, -1);
+			lua_pop(L, 1);
 			_write_main<T>(addr, value);
 			addr += sizeof(T);
 		}
@@ -177,6 +180,337 @@ template int emu_write_main<s16>(lua_State* L);
 template int emu_write_main<s32>(lua_State* L);
 template int emu_write_main<s64>(lua_State* L);
 
+// Offset in main ram of an sh4 address range in area 3, the mirrors included
+static bool main_ram_range(u32 addr, u32 size, u32* offset)
+{
+	if (sh4_cpu == nullptr || (addr >> 29) == 7 || ((addr >> 26) & 7) != 3)
+		return false;
+
+	*offset = addr & RAM_MASK;
+
+	return size <= RAM_SIZE - *offset;
+}
+
+static u32 read_sized(u32 addr, int size)
+{
+	u32 offset;
+
+	if (main_ram_range(addr, size, &offset))
+	{
+		u32 value = 0;
+		memcpy(&value, &sh4_cpu->mram[offset], size);
+		return value;
+	}
+
+	if (size == 1) return _read_main<u8>(addr);
+	else if (size == 2) return _read_main<u16>(addr);
+	else return _read_main<u32>(addr);
+}
+
+static void write_sized(u32 addr, int size, u32 value)
+{
+	if (size == 1) _write_main<u8>(addr, value);
+	else if (size == 2) _write_main<u16>(addr, value);
+	else _write_main<u32>(addr, value);
+}
+
+// readMemBlock(addr, length), the bytes as a string
+static int emu_read_block(lua_State* L) {
+	u32 addr = (u32)luaL_checkinteger(L, 1);
+	lua_Integer len = luaL_checkinteger(L, 2);
+	luaL_argcheck(L, len >= 0 && len <= RAM_SIZE, 2, "invalid length");
+
+	u32 offset;
+
+	if (main_ram_range(addr, (u32)len, &offset))
+	{
+		lua_pushlstring(L, (const char*)&sh4_cpu->mram[offset], (size_t)len);
+		return 1;
+	}
+
+	luaL_Buffer b;
+	u8* dst = (u8*)luaL_buffinitsize(L, &b, (size_t)len);
+
+	for (lua_Integer i = 0; i < len; i++)
+		dst[i] = _read_main<u8>(addr + (u32)i);
+
+	luaL_pushresultsize(&b, (size_t)len);
+	return 1;
+}
+
+// writeMemBlock(addr, string), through the memory handlers so cached code and textures see it
+static int emu_write_block(lua_State* L) {
+	u32 addr = (u32)luaL_checkinteger(L, 1);
+	size_t len;
+	const char* src = luaL_checklstring(L, 2, &len);
+
+	size_t i = 0;
+
+	for (; i < len && ((addr + i) & 3); i++)
+		_write_main<u8>(addr + (u32)i, (u8)src[i]);
+
+	for (; i + 4 <= len; i += 4)
+	{
+		u32 value;
+		memcpy(&value, src + i, 4);
+		_write_main<u32>(addr + (u32)i, value);
+	}
+
+	for (; i < len; i++)
+		_write_main<u8>(addr + (u32)i, (u8)src[i]);
+
+	return 0;
+}
+
+// readMemGather({ addr, ... } [, size]), unsigned values of 1, 2 or 4 bytes
+static int emu_read_gather(lua_State* L) {
+	luaL_checktype(L, 1, LUA_TTABLE);
+	int size = (int)luaL_optinteger(L, 2, 4);
+	luaL_argcheck(L, size == 1 || size == 2 || size == 4, 2, "size must be 1, 2 or 4");
+
+	size_t count = lua_rawlen(L, 1);
+	lua_createtable(L, (int)count, 0);
+
+	for (size_t i = 0; i < count; i++) {
+		lua_rawgeti(L, 1, (lua_Integer)i + 1);
+		u32 addr = (u32)lua_tointeger(L, -1);
+		lua_pop(L, 1);
+
+		lua_pushinteger(L, read_sized(addr, size));
+		lua_rawseti(L, -2, (lua_Integer)i + 1);
+	}
+
+	return 1;
+}
+
+// writeMemScatter({ addr, ... }, { value, ... } [, size])
+static int emu_write_scatter(lua_State* L) {
+	luaL_checktype(L, 1, LUA_TTABLE);
+	luaL_checktype(L, 2, LUA_TTABLE);
+	int size = (int)luaL_optinteger(L, 3, 4);
+	luaL_argcheck(L, size == 1 || size == 2 || size == 4, 3, "size must be 1, 2 or 4");
+
+	size_t count = lua_rawlen(L, 1);
+	luaL_argcheck(L, lua_rawlen(L, 2) == count, 2, "as many values as addresses expected");
+
+	for (size_t i = 0; i < count; i++) {
+		lua_rawgeti(L, 1, (lua_Integer)i + 1);
+		lua_rawgeti(L, 2, (lua_Integer)i + 1);
+		write_sized((u32)lua_tointeger(L, -2), size, (u32)lua_tointeger(L, -1));
+		lua_pop(L, 2);
+	}
+
+	return 0;
+}
+
+/*
+	Write watchpoints. The pages of the watched ranges are write protected, the first write to one
+	in a frame goes through the fault handler and leaves it writable. At the end of the frame only
+	the ranges on pages that were written are compared with their copy, the callbacks get the
+	ones that changed and the pages are protected again. Without fault handling every range is
+	compared every frame.
+*/
+struct WriteWatch
+{
+	lua_State* L;
+	int id;
+	int callback;		// registry reference
+	u32 addr;
+	u32 offset;			// in main ram
+	vector<u8> shadow;
+};
+
+static vector<WriteWatch> watches;
+static int next_watch_id = 1;
+static VLockedMemory* watched_mem;		// the pages are protected on this one
+static bool watch_faults;				// by page protection, otherwise polled
+
+// Protects the pages of every watch, for a machine that has none of them protected yet
+static void arm_watches()
+{
+	// the memory of a machine that was shut down is gone
+	if (watched_mem != nullptr && sh4_cpu != nullptr && watched_mem == &sh4_cpu->mram)
+		watched_mem->ClearWatches();
+
+	watched_mem = nullptr;
+
+	if (sh4_cpu == nullptr || watches.empty())
+		return;
+
+	watched_mem = &sh4_cpu->mram;
+	watch_faults = true;
+
+	for (const WriteWatch& w : watches)
+		watch_faults = watched_mem->WatchRegion(w.offset, (u32)w.shadow.size()) && watch_faults;
+}
+
+// The watches are protected on the current machine, ranges can be added and removed one at a time
+static bool watches_armed()
+{
+	return sh4_cpu != nullptr && watched_mem == &sh4_cpu->mram && (!watch_faults || watched_mem->watched_pages != nullptr);
+}
+
+// Only the new range, the pages watched already keep what was written to them this frame
+static void watch_range(u32 offset, u32 size)
+{
+	if (watches_armed())
+		watch_faults = watched_mem->WatchRegion(offset, size) && watch_faults;
+	else
+		arm_watches();
+}
+
+// After a watch was removed, its pages that no other watch is on are given back
+static void unwatch_range(u32 offset, u32 size)
+{
+	if (!watches_armed())
+		return;
+
+	u32 end = (offset + size + REI_PAGE_SIZE - 1) / REI_PAGE_SIZE;
+
+	for (u32 page = offset / REI_PAGE_SIZE; page < end; page++)
+	{
+		bool covered = false;
+
+		for (const WriteWatch& w : watches)
+		{
+			if (w.offset < (page + 1) * REI_PAGE_SIZE && w.offset + w.shadow.size() > page * REI_PAGE_SIZE)
+				covered = true;
+		}
+
+		if (!covered)
+			watched_mem->UnwatchRegion(page * REI_PAGE_SIZE, REI_PAGE_SIZE);
+	}
+}
+
+// watchWrite(addr, length, function(addr, old, new)), old and new are strings, returns an id
+static int emu_watch_write(lua_State* L) {
+	u32 addr = (u32)luaL_checkinteger(L, 1);
+	lua_Integer len = luaL_checkinteger(L, 2);
+	luaL_checktype(L, 3, LUA_TFUNCTION);
+
+	WriteWatch w;
+	luaL_argcheck(L, len > 0 && main_ram_range(addr, (u32)len, &w.offset), 1, "main ram range expected");
+
+	w.L = L;
+	w.id = next_watch_id++;
+	w.addr = addr;
+	w.shadow.assign(&sh4_cpu->mram[w.offset], &sh4_cpu->mram[w.offset] + len);
+
+	lua_pushvalue(L, 3);
+	w.callback = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	watches.push_back(w);
+	watch_range(w.offset, (u32)len);
+
+	lua_pushinteger(L, w.id);
+	return 1;
+}
+
+// unwatch(id)
+static int emu_unwatch(lua_State* L) {
+	int id = (int)luaL_checkinteger(L, 1);
+
+	for (size_t i = 0; i < watches.size(); i++)
+	{
+		if (watches[i].id == id && watches[i].L == L)
+		{
+			u32 offset = watches[i].offset;
+			u32 size = (u32)watches[i].shadow.size();
+
+			luaL_unref(L, LUA_REGISTRYINDEX, watches[i].callback);
+			watches.erase(watches.begin() + i);
+			unwatch_range(offset, size);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+void emulib_onframe()
+{
+	if (watches.empty() || sh4_cpu == nullptr)
+		return;
+
+	// a new machine, nothing is protected on it yet
+	if (!watches_armed())
+		arm_watches();
+
+	struct Change
+	{
+		int id;
+		string old_data;
+	};
+
+	vector<Change> changes;
+
+	for (WriteWatch& w : watches)
+	{
+		u32 size = (u32)w.shadow.size();
+		u32 first = w.offset / REI_PAGE_SIZE;
+		u32 end = (w.offset + size + REI_PAGE_SIZE - 1) / REI_PAGE_SIZE;
+
+		bool written = !watch_faults;
+
+		for (u32 page = first; page < end && !written; page++)
+			written = watched_mem->WatchHit(page);
+
+		if (!written || memcmp(w.shadow.data(), &sh4_cpu->mram[w.offset], size) == 0)
+			continue;
+
+		changes.push_back({ w.id, string((const char*)w.shadow.data(), size) });
+		memcpy(w.shadow.data(), &sh4_cpu->mram[w.offset], size);
+	}
+
+	if (watch_faults)
+	{
+		for (const WriteWatch& w : watches)
+		{
+			u32 end = (w.offset + (u32)w.shadow.size() + REI_PAGE_SIZE - 1) / REI_PAGE_SIZE;
+
+			for (u32 page = w.offset / REI_PAGE_SIZE; page < end; page++)
+			{
+				if (watched_mem->WatchHit(page))
+					watched_mem->RearmWatch(page);
+			}
+		}
+	}
+
+	// the callbacks may add or remove watches
+	for (const Change& c : changes)
+	{
+		for (const WriteWatch& w : watches)
+		{
+			if (w.id != c.id)
+				continue;
+
+			lua_State* L = w.L;
+			lua_rawgeti(L, LUA_REGISTRYINDEX, w.callback);
+			lua_pushinteger(L, w.addr);
+			lua_pushlstring(L, c.old_data.data(), c.old_data.size());
+			lua_pushlstring(L, (const char*)w.shadow.data(), w.shadow.size());
+
+			if (lua_pcall(L, 3, 0, 0) != 0)
+			{
+				printf("error running watchpoint callback: %s\n", lua_tostring(L, -1));
+				lua_pop(L, 1);
+			}
+			break;
+		}
+	}
+}
+
+void emulib_close(lua_State* L)
+{
+	auto closed = std::stable_partition(watches.begin(), watches.end(), [=](const WriteWatch& w) { return w.L != L; });
+	vector<WriteWatch> removed(closed, watches.end());
+
+	watches.erase(closed, watches.end());
+
+	for (const WriteWatch& w : removed)
+		unwatch_range(w.offset, (u32)w.shadow.size());
+}
+
 template<class T>
 static int emu_read_sound(lua_State* L) {
 	int n = lua_gettop(L);
@@ -272,6 +606,16 @@ static const luaL_Reg emulib[] = {
 	{"writeMem32", emu_write_main<s32> },
 	{"writeMem64", emu_write_main<s64> },
 
+	// bulk main cpu access
+	{"readMemBlock", emu_read_block },			// (addr, length) -> string
+	{"writeMemBlock", emu_write_block },		// (addr, string)
+	{"readMemGather", emu_read_gather },		// ({ addr, ... } [, size]) -> { value, ... }
+	{"writeMemScatter", emu_write_scatter },	// ({ addr, ... }, { value, ... } [, size])
+
+	// write watchpoints, checked at the end of every frame
+	{"watchWrite", emu_watch_write },			// (addr, length, function(addr, old, new)) -> id
+	{"unwatch", emu_unwatch },					// (id)
+
 	// sound cpu access
 	{"readSoundMemS8",  emu_read_sound<s8> },
 	{"readSoundMemS16", emu_read_sound<s16> },
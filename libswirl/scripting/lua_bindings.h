@@ -10,10 +10,17 @@
 #include <string>
 
 void emulib_expose(lua_State* L);
+// Emulation thread, every frame before the scripts' onFrame, runs the watchpoints that fired
+void emulib_onframe();
+// Drops what the script registered, before its state is closed
+void emulib_close(lua_State* L);
 
 void luabindings_findscripts(std::string path);
+// Queue a script to load or all of them to close, from any thread
 void luabindings_run(const char* fn);
 void luabindings_close();
+// Loads and closes the queued scripts, on the emulation thread or while it is stopped
+void luabindings_sync();
 void luabindings_onframe();
 void luabindings_onstart();
 void luabindings_onstop();
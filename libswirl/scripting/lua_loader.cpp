@@ -11,6 +11,8 @@
 
 #include "types.h"
 #include "stdclass.h"
+#include "runahead.h"
+#include "oslib/threading.h"
 
 #ifdef SCRIPTING
 // TODO: Allow more than one script
@@ -36,6 +38,7 @@ public:
 
 	~LuaScript()
 	{
+		emulib_close(L);
 		lua_close(L);
 	}
 
@@ -101,6 +104,11 @@ public:
 };
 
 std::vector<LuaScript*> loaded_scripts;
+
+// The renderer finds and drops the scripts, they are only loaded and closed by luabindings_sync
+static cMutex queue_lock;
+static std::vector<std::string> queued_scripts;
+static bool close_queued;
 #endif
 
 void luabindings_findscripts(std::string path)
@@ -115,24 +123,63 @@ void luabindings_findscripts(std::string path)
 void luabindings_run(const char* fn)
 {
 #ifdef SCRIPTING
-	loaded_scripts.push_back(new LuaScript(fn));
+	queue_lock.Lock();
+	queued_scripts.push_back(fn);
+	queue_lock.Unlock();
 #endif
 }
 
 void luabindings_close()
 {
 #ifdef SCRIPTING
-	for (auto script : loaded_scripts)
+	queue_lock.Lock();
+	queued_scripts.clear();
+	close_queued = true;
+	queue_lock.Unlock();
+#endif
+}
+
+void luabindings_sync()
+{
+#ifdef SCRIPTING
+	std::vector<std::string> scripts;
+
+	queue_lock.Lock();
+	bool close = close_queued;
+	close_queued = false;
+	scripts.swap(queued_scripts);
+	queue_lock.Unlock();
+
+	if (close)
 	{
-		delete script;
+		for (auto script : loaded_scripts)
+		{
+			delete script;
+		}
+		loaded_scripts.clear();
+	}
+
+	for (auto& fn : scripts)
+	{
+		loaded_scripts.push_back(new LuaScript(fn.c_str()));
 	}
-	loaded_scripts.clear();
 #endif
 }
 
 void luabindings_onframe()
 {
 #ifdef SCRIPTING
+	// the frames run ahead are undone, scripts only see the ones that are kept
+	if (runahead_ahead())
+		return;
+
+	luabindings_sync();
+
+	if (loaded_scripts.empty())
+		return;
+
+	emulib_onframe();
+
 	for (auto script : loaded_scripts)
 	{
 		script->onframe();
@@ -143,6 +190,8 @@ void luabindings_onframe()
 void luabindings_onstart()
 {
 #ifdef SCRIPTING
+	luabindings_sync();
+
 	for (auto script : loaded_scripts)
 	{
 		script->onstart();
@@ -163,6 +212,8 @@ void luabindings_onstop()
 void luabindings_onreset()
 {
 #ifdef SCRIPTING
+	luabindings_sync();
+
 	for (auto script : loaded_scripts)
 	{
 		script->onreset();
@@ -17,6 +17,7 @@
 #include "hw/gdrom/gdromv3.h"
 #include "hw/maple/maple_cfg.h"
 #include "hw/pvr/Renderer_if.h"
+#include "rend/TexCache.h"
 #include "hw/pvr/ta_structs.h"
 #include "hw/sh4/sh4_interrupts.h"
 #include "hw/sh4/sh4_sched.h"
@@ -682,7 +683,7 @@ bool register_unserialize(RegisterStruct* regs, size_t size,void **data, unsigne
 	return true ;
 }
 
-bool dc_serialize(void **data, unsigned int *total_size)
+bool dc_serialize(void **data, unsigned int *total_size, u32 flags)
 {
 	int i = 0;
 	serialize_version_enum version = V4 ;
@@ -697,14 +698,18 @@ bool dc_serialize(void **data, unsigned int *total_size)
 
 	sh4_cpu->serialize(data, total_size);
 
-	REICAST_SA(sh4_cpu->aica_ram.data, sh4_cpu->aica_ram.size);
+	if (flags & SER_RAM)
+		REICAST_SA(sh4_cpu->aica_ram.data, sh4_cpu->aica_ram.size);
 
 
 
-	REICAST_SA(volume_lut,16);
-	REICAST_SA(tl_lut,256 + 768);
-	REICAST_SA(AEG_ATT_SPS,64);
-	REICAST_SA(AEG_DSR_SPS,64);
+	if (flags & SER_TABLES)
+	{
+		REICAST_SA(volume_lut,16);
+		REICAST_SA(tl_lut,256 + 768);
+		REICAST_SA(AEG_ATT_SPS,64);
+		REICAST_SA(AEG_DSR_SPS,64);
+	}
 	REICAST_S(pl);
 	REICAST_S(pr);
 
@@ -715,7 +720,8 @@ bool dc_serialize(void **data, unsigned int *total_size)
 #ifdef FLASH_SIZE
 	REICAST_S(sys_nvmem.state);
 #endif
-	REICAST_SA(sys_nvmem.data,sys_nvmem.size);
+	if (flags & SER_NVMEM)
+		REICAST_SA(sys_nvmem.data,sys_nvmem.size);
 
 	//this is one-time init, no updates - don't need to serialize
 	//extern _vmem_handler area0_handler;
@@ -761,20 +767,28 @@ bool dc_serialize(void **data, unsigned int *total_size)
 
 
 
-	REICAST_SA(ta_type_lut,256);
-	REICAST_SA(ta_fsm,2049);
+	if (flags & SER_TABLES)
+	{
+		REICAST_SA(ta_type_lut,256);
+		REICAST_SA(ta_fsm,2049);
+	}
+	else
+		REICAST_S(ta_fsm[2048]);	// the current state, the rest is a table
 	REICAST_S(ta_fsm_cl);
 
 	REICAST_S(tileclip_val);
-	REICAST_SA(f32_su8_tbl,65536);
+	if (flags & SER_TABLES)
+		REICAST_SA(f32_su8_tbl,65536);
 	REICAST_SA(FaceBaseColor,4);
 	REICAST_SA(FaceOffsColor,4);
 	REICAST_S(SFaceBaseColor);
 	REICAST_S(SFaceOffsColor);
 
-	REICAST_SA(sh4_cpu->vram.data, sh4_cpu->vram.size);
+	if (flags & SER_RAM)
+		REICAST_SA(sh4_cpu->vram.data, sh4_cpu->vram.size);
 
-	REICAST_SA(sh4_cpu->mram.data, sh4_cpu->mram.size);
+	if (flags & SER_RAM)
+		REICAST_SA(sh4_cpu->mram.data, sh4_cpu->mram.size);
 
 
 
@@ -871,12 +885,15 @@ bool dc_serialize(void **data, unsigned int *total_size)
 	REICAST_S(total_blocks);
 	REICAST_S(REMOVED_OPS);
 
-	REICAST_SA(kcode,4);
-	REICAST_SA(rt,4);
-	REICAST_SA(lt,4);
-	REICAST_SA(vks,4);
-	REICAST_SA(joyx,4);
-	REICAST_SA(joyy,4);
+	if (flags & SER_INPUT)
+	{
+		REICAST_SA(kcode,4);
+		REICAST_SA(rt,4);
+		REICAST_SA(lt,4);
+		REICAST_SA(vks,4);
+		REICAST_SA(joyx,4);
+		REICAST_SA(joyy,4);
+	}
 
 	REICAST_S(settings.dreamcast.broadcast);
 	REICAST_S(settings.dreamcast.cable);
@@ -888,13 +905,16 @@ bool dc_serialize(void **data, unsigned int *total_size)
 	return true ;
 }
 
-bool dc_unserialize(void **data, unsigned int *total_size)
+bool dc_unserialize(void **data, unsigned int *total_size, u32 flags)
 {
 	int i = 0;
 	serialize_version_enum version = V1 ;
 
 	*total_size = 0 ;
 
+	// render to texture results still on their way belong to the state that is replaced
+	vramwb_Drop();
+
 	REICAST_US(version) ;
 
 	if (version != V4)
@@ -905,12 +925,16 @@ bool dc_unserialize(void **data, unsigned int *total_size)
 
 	sh4_cpu->unserialize(data, total_size);
 
-	REICAST_USA(sh4_cpu->aica_ram.data, sh4_cpu->aica_ram.size);
+	if (flags & SER_RAM)
+		REICAST_USA(sh4_cpu->aica_ram.data, sh4_cpu->aica_ram.size);
 	
-	REICAST_USA(volume_lut,16);
-	REICAST_USA(tl_lut,256 + 768);
-	REICAST_USA(AEG_ATT_SPS,64);
-	REICAST_USA(AEG_DSR_SPS,64);
+	if (flags & SER_TABLES)
+	{
+		REICAST_USA(volume_lut,16);
+		REICAST_USA(tl_lut,256 + 768);
+		REICAST_USA(AEG_ATT_SPS,64);
+		REICAST_USA(AEG_DSR_SPS,64);
+	}
 	REICAST_US(pl);
 	REICAST_US(pr);
 
@@ -921,7 +945,8 @@ bool dc_unserialize(void **data, unsigned int *total_size)
 #ifdef FLASH_SIZE
 	REICAST_US(sys_nvmem.state);
 #endif
-	REICAST_USA(sys_nvmem.data,sys_nvmem.size);
+	if (flags & SER_NVMEM)
+		REICAST_USA(sys_nvmem.data,sys_nvmem.size);
 
 
 	//this is one-time init, no updates - don't need to serialize
@@ -966,12 +991,18 @@ bool dc_unserialize(void **data, unsigned int *total_size)
 	REICAST_US(full_rps);
 	REICAST_US(fskip);
 
-	REICAST_USA(ta_type_lut,256);
-	REICAST_USA(ta_fsm,2049);
+	if (flags & SER_TABLES)
+	{
+		REICAST_USA(ta_type_lut,256);
+		REICAST_USA(ta_fsm,2049);
+	}
+	else
+		REICAST_US(ta_fsm[2048]);	// the current state, the rest is a table
 	REICAST_US(ta_fsm_cl);
 
 	REICAST_US(tileclip_val);
-	REICAST_USA(f32_su8_tbl,65536);
+	if (flags & SER_TABLES)
+		REICAST_USA(f32_su8_tbl,65536);
 	REICAST_USA(FaceBaseColor,4);
 	REICAST_USA(FaceOffsColor,4);
 	REICAST_US(SFaceBaseColor);
@@ -979,9 +1010,11 @@ bool dc_unserialize(void **data, unsigned int *total_size)
 
 	pal_needs_update = true;
 
-	REICAST_USA(sh4_cpu->vram.data, sh4_cpu->vram.size);
+	if (flags & SER_RAM)
+		REICAST_USA(sh4_cpu->vram.data, sh4_cpu->vram.size);
 
-	REICAST_USA(sh4_cpu->mram.data, sh4_cpu->mram.size);
+	if (flags & SER_RAM)
+		REICAST_USA(sh4_cpu->mram.data, sh4_cpu->mram.size);
 
 	REICAST_US(IRLPriority);
 	REICAST_USA(InterruptEnvId,32);
@@ -1098,12 +1131,15 @@ bool dc_unserialize(void **data, unsigned int *total_size)
 	REICAST_US(total_blocks);
 	REICAST_US(REMOVED_OPS);
 
-	REICAST_USA(kcode,4);
-	REICAST_USA(rt,4);
-	REICAST_USA(lt,4);
-	REICAST_USA(vks,4);
-	REICAST_USA(joyx,4);
-	REICAST_USA(joyy,4);
+	if (flags & SER_INPUT)
+	{
+		REICAST_USA(kcode,4);
+		REICAST_USA(rt,4);
+		REICAST_USA(lt,4);
+		REICAST_USA(vks,4);
+		REICAST_USA(joyx,4);
+		REICAST_USA(joyy,4);
+	}
 
 
 	REICAST_US(settings.dreamcast.broadcast);
@@ -9,8 +9,19 @@
 
 bool rc_serialize(void* src, unsigned int src_size, void** dest, unsigned int* total_size);
 bool rc_unserialize(void* src, unsigned int src_size, void** dest, unsigned int* total_size);
-bool dc_serialize(void** data, unsigned int* total_size);
-bool dc_unserialize(void** data, unsigned int* total_size);
+// Sections of dc_serialize/dc_unserialize, state files have all of them. In-memory states
+// (rewind, run-ahead) leave out what they handle themselves or what can't change
+enum SerializeFlags
+{
+	SER_RAM = 1,		// main RAM, VRAM and AICA RAM
+	SER_NVMEM = 2,		// flash or battery backed SRAM contents
+	SER_TABLES = 4,		// lookup tables built at init
+	SER_INPUT = 8,		// controller state, left out so that live input survives a restore
+	SER_ALL = 15
+};
+
+bool dc_serialize(void** data, unsigned int* total_size, u32 flags = SER_ALL);
+bool dc_unserialize(void** data, unsigned int* total_size, u32 flags = SER_ALL);
 
 #define REICAST_S(v) rc_serialize(&(v), sizeof(v), data, total_size)
 #define REICAST_US(v) rc_unserialize(&(v), sizeof(v), data, total_size)
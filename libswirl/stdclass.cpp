@@ -6,6 +6,7 @@
 
 #include <string.h>
 #include <vector>
+#include <algorithm>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "types.h"
@@ -173,3 +174,287 @@ bool make_directory(const string& path)
 }
 
 
+void VLockedMemory::LockRegion(unsigned offset, unsigned size_bytes)
+{
+	unsigned pages = PageCount();
+	unsigned first = offset / REI_PAGE_SIZE;
+	unsigned end = std::min(pages, (offset + size_bytes + REI_PAGE_SIZE - 1) / REI_PAGE_SIZE);
+
+	// Always kept up to date, so that dirty tracking can start at any time
+	if (locked_pages == nullptr)
+		locked_pages = (u8*)calloc(pages, 1);
+
+	for (unsigned i = first; i < end; i++)
+		locked_pages[i] = 1;
+
+	SetProtection(offset, size_bytes, false);
+}
+
+void VLockedMemory::UnLockRegion(unsigned offset, unsigned size_bytes)
+{
+	unsigned pages = PageCount();
+	unsigned first = offset / REI_PAGE_SIZE;
+	unsigned end = (offset + size_bytes + REI_PAGE_SIZE - 1) / REI_PAGE_SIZE;
+
+	if (locked_pages != nullptr)
+	{
+		for (unsigned i = first; i < std::min(pages, end); i++)
+			locked_pages[i] = 0;
+	}
+
+	if (dirty_pages == nullptr && watched_pages == nullptr)
+	{
+		SetProtection(offset, size_bytes, true);
+		return;
+	}
+
+	// Pages past the end are the vram wrap the texture cache locks along with data. It is a locked
+	// mirror, given back with the same pages of data
+	if (first >= pages)
+		return;
+
+	// Clean and watched pages stay protected so that their first write is still seen
+	UnprotectPages(first, std::min(pages, end));
+}
+
+void VLockedMemory::AddMirror(u8* view, bool locked)
+{
+	verify(mirror_count < MAX_MIRRORS);
+	mirrors[mirror_count] = view;
+	mirror_locked[mirror_count] = locked;
+	mirror_count++;
+}
+
+void VLockedMemory::SetMirrorProtection(unsigned offset, unsigned size_bytes, bool writable, int which)
+{
+	for (unsigned i = 0; i < mirror_count; i++)
+	{
+		if (which & (mirror_locked[i] ? MIRRORS_LOCKED : MIRRORS_UNLOCKED))
+			SetViewProtection(mirrors[i], offset, size_bytes, writable);
+	}
+}
+
+bool VLockedMemory::PageTracked(unsigned page) const
+{
+	return (dirty_pages != nullptr && !dirty_pages[page])
+		|| (watched_pages != nullptr && watched_pages[page] == WATCH_ARMED);
+}
+
+bool VLockedMemory::PageWritable(unsigned page) const
+{
+	return !(locked_pages != nullptr && locked_pages[page])
+		&& !(dirty_pages != nullptr && !dirty_pages[page])
+		&& !(watched_pages != nullptr && watched_pages[page] == WATCH_ARMED);
+}
+
+void VLockedMemory::UnprotectPages(unsigned first, unsigned end)
+{
+	unsigned run = first;
+	for (unsigned i = first; i <= end; i++)
+	{
+		if (i == end || !PageWritable(i))
+		{
+			if (i > run)
+			{
+				SetProtection(run * REI_PAGE_SIZE, (i - run) * REI_PAGE_SIZE, true);
+				SetMirrorProtection(run * REI_PAGE_SIZE, (i - run) * REI_PAGE_SIZE, true, MIRRORS_LOCKED);
+			}
+			run = i + 1;
+		}
+	}
+}
+
+void VLockedMemory::UnprotectMirrors(unsigned first, unsigned end)
+{
+	if (mirror_count == 0)
+		return;
+
+	unsigned run = first;
+	for (unsigned i = first; i <= end; i++)
+	{
+		if (i == end || PageTracked(i))
+		{
+			if (i > run)
+				SetMirrorProtection(run * REI_PAGE_SIZE, (i - run) * REI_PAGE_SIZE, true, MIRRORS_UNLOCKED);
+			run = i + 1;
+		}
+	}
+}
+
+bool VLockedMemory::ViewOffset(u8* address, size_t* offset, bool* unlocked_mirror) const
+{
+	*offset = address - data;
+	*unlocked_mirror = false;
+
+	for (unsigned i = 0; i < mirror_count && *offset >= size; i++)
+	{
+		*offset = address - mirrors[i];
+		*unlocked_mirror = !mirror_locked[i];
+	}
+
+	return *offset < size;
+}
+
+bool VLockedMemory::TrackedWrite(unsigned page, bool unlocked_mirror)
+{
+	bool tracked = PageTracked(page);
+	bool writable = PageWritable(page);
+
+	if (!tracked)
+		SetMirrorProtection(page * REI_PAGE_SIZE, REI_PAGE_SIZE, true, MIRRORS_UNLOCKED);
+
+	if (writable)
+	{
+		SetProtection(page * REI_PAGE_SIZE, REI_PAGE_SIZE, true);
+		SetMirrorProtection(page * REI_PAGE_SIZE, REI_PAGE_SIZE, true, MIRRORS_LOCKED);
+	}
+
+	// the locks don't cover these, a write through one is never for their owners
+	if (unlocked_mirror)
+		return !tracked;
+
+	// still locked by the dynarec or the texture cache, or watched, their handler unlocks the page
+	return writable;
+}
+
+bool VLockedMemory::StartDirtyTracking()
+{
+#if defined(TARGET_NO_EXCEPTIONS)
+	return false;
+#else
+	verify(dirty_pages == nullptr);
+
+	if (locked_pages == nullptr)
+		locked_pages = (u8*)calloc(PageCount(), 1);
+
+	dirty_pages = (u8*)malloc(PageCount());
+	ResetDirty();
+
+	return true;
+#endif
+}
+
+void VLockedMemory::StopDirtyTracking()
+{
+	if (dirty_pages == nullptr)
+		return;
+
+	free(dirty_pages);
+	dirty_pages = nullptr;
+
+	// Give write access back to everything but the pages locked by their owners or watched
+	UnprotectPages(0, PageCount());
+	UnprotectMirrors(0, PageCount());
+}
+
+// Clears the dirty map, and protects the whole region again
+void VLockedMemory::ResetDirty()
+{
+	memset(dirty_pages, 0, PageCount());
+	SetProtection(0, size, false);
+	SetMirrorProtection(0, size, false);
+}
+
+// Called from the fault handler before the owners of the locks get to see the fault
+bool VLockedMemory::DirtyWrite(u8* address)
+{
+	size_t offset;
+	bool unlocked_mirror;
+
+	if (dirty_pages == nullptr || !ViewOffset(address, &offset, &unlocked_mirror))
+		return false;
+
+	unsigned page = offset / REI_PAGE_SIZE;
+
+	if (dirty_pages[page])
+		return false;
+
+	dirty_pages[page] = 1;
+
+	return TrackedWrite(page, unlocked_mirror);
+}
+
+bool VLockedMemory::WatchRegion(unsigned offset, unsigned size_bytes)
+{
+#if defined(TARGET_NO_EXCEPTIONS)
+	return false;
+#else
+	unsigned first = offset / REI_PAGE_SIZE;
+	unsigned end = std::min(PageCount(), (offset + size_bytes + REI_PAGE_SIZE - 1) / REI_PAGE_SIZE);
+
+	if (watched_pages == nullptr)
+		watched_pages = (u8*)calloc(PageCount(), 1);
+
+	unsigned run = first;
+	for (unsigned i = first; i <= end; i++)
+	{
+		// the pages watched already are protected, or were written this frame
+		if (i == end || watched_pages[i] != 0)
+		{
+			if (i > run)
+			{
+				SetProtection(run * REI_PAGE_SIZE, (i - run) * REI_PAGE_SIZE, false);
+				SetMirrorProtection(run * REI_PAGE_SIZE, (i - run) * REI_PAGE_SIZE, false);
+			}
+			run = i + 1;
+		}
+		else
+			watched_pages[i] = WATCH_ARMED;
+	}
+
+	return true;
+#endif
+}
+
+void VLockedMemory::UnwatchRegion(unsigned offset, unsigned size_bytes)
+{
+	if (watched_pages == nullptr)
+		return;
+
+	unsigned first = offset / REI_PAGE_SIZE;
+	unsigned end = std::min(PageCount(), (offset + size_bytes + REI_PAGE_SIZE - 1) / REI_PAGE_SIZE);
+
+	for (unsigned i = first; i < end; i++)
+		watched_pages[i] = 0;
+
+	UnprotectPages(first, end);
+	UnprotectMirrors(first, end);
+}
+
+void VLockedMemory::ClearWatches()
+{
+	if (watched_pages == nullptr)
+		return;
+
+	free(watched_pages);
+	watched_pages = nullptr;
+
+	UnprotectPages(0, PageCount());
+	UnprotectMirrors(0, PageCount());
+}
+
+// Called from the fault handler after DirtyWrite
+bool VLockedMemory::WatchWrite(u8* address)
+{
+	size_t offset;
+	bool unlocked_mirror;
+
+	if (watched_pages == nullptr || !ViewOffset(address, &offset, &unlocked_mirror))
+		return false;
+
+	unsigned page = offset / REI_PAGE_SIZE;
+
+	if (watched_pages[page] != WATCH_ARMED)
+		return false;
+
+	watched_pages[page] = WATCH_HIT;
+
+	return TrackedWrite(page, unlocked_mirror);
+}
+
+void VLockedMemory::RearmWatch(unsigned page)
+{
+	watched_pages[page] = WATCH_ARMED;
+	SetProtection(page * REI_PAGE_SIZE, REI_PAGE_SIZE, false);
+	SetMirrorProtection(page * REI_PAGE_SIZE, REI_PAGE_SIZE, false);
+}
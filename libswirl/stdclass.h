@@ -211,9 +211,66 @@ public:
 	void *getPtr() const { return data; }
 	unsigned getSize() const { return size; }
 
+	// Write protection, used by the dynarec and the texture cache to catch writes
 	void LockRegion(unsigned offset, unsigned size_bytes);
 	void UnLockRegion(unsigned offset, unsigned size_bytes);
 
+	// Other views of the same memory (see _vmem_reserve). Writes through them don't fault on data,
+	// so dirty tracking and watches protect them too. A locked mirror is one the owner of the locks
+	// protects along with data (the texture cache's vram wrap), the others are never locked
+	enum { MAX_MIRRORS = 4 };
+	enum { MIRRORS_UNLOCKED = 1, MIRRORS_LOCKED = 2, MIRRORS_ALL = 3 };
+	u8* mirrors[MAX_MIRRORS];
+	bool mirror_locked[MAX_MIRRORS];
+	unsigned mirror_count = 0;
+
+	void AddMirror(u8* view, bool locked);
+
+	// Dirty page tracking for incremental savestates (see rewind.cpp)
+	// While tracking, every page stays write protected until it is written to. Pages locked
+	// via LockRegion keep their owner, the fault is passed on after the page is marked dirty
+	u8* dirty_pages = nullptr;		// one byte per REI_PAGE_SIZE page, set on the first write
+	u8* locked_pages = nullptr;		// pages currently locked via LockRegion
+
+	bool StartDirtyTracking();
+	void StopDirtyTracking();
+	void ResetDirty();
+	bool DirtyWrite(u8* address);
+	unsigned PageCount() const { return (size + REI_PAGE_SIZE - 1) / REI_PAGE_SIZE; }
+
+	// Write watchpoints for scripts (see scripting/lua_bindings.cpp)
+	// A watched page is protected until it is written to, then it is writable and reported as hit
+	// until RearmWatch. Like the dirty pages, the fault is passed on if the page is locked.
+	// Pages that are already watched keep their state, hit or not, when a region is added
+	enum { WATCH_ARMED = 1, WATCH_HIT = 2 };
+	u8* watched_pages = nullptr;
+
+	bool WatchRegion(unsigned offset, unsigned size_bytes);
+	void UnwatchRegion(unsigned offset, unsigned size_bytes);
+	void ClearWatches();
+	bool WatchWrite(u8* address);
+	bool WatchHit(unsigned page) const { return watched_pages != nullptr && watched_pages[page] == WATCH_HIT; }
+	void RearmWatch(unsigned page);
+
+	// Platform specific, changes the protection of a range of a view without any bookkeeping
+	void SetViewProtection(u8* view, unsigned offset, unsigned size_bytes, bool writable);
+	void SetProtection(unsigned offset, unsigned size_bytes, bool writable) { SetViewProtection(data, offset, size_bytes, writable); }
+	void SetMirrorProtection(unsigned offset, unsigned size_bytes, bool writable, int which = MIRRORS_ALL);
+
+	// Nothing wants to see the next write to the page
+	bool PageWritable(unsigned page) const;
+	// Dirty tracking or a watch wants to see the next write to the page, through any view
+	bool PageTracked(unsigned page) const;
+	// Gives write access back to the pages of [first, end) that are writable, in data and the locked
+	// mirrors
+	void UnprotectPages(unsigned first, unsigned end);
+	// The same for the unlocked mirrors, where only the tracked pages stay protected
+	void UnprotectMirrors(unsigned first, unsigned end);
+	// Offset of an address in data or one of the mirrors, false if it is in neither
+	bool ViewOffset(u8* address, size_t* offset, bool* unlocked_mirror) const;
+	// Called after a tracked write to the page, true if the faulting access can be retried
+	bool TrackedWrite(unsigned page, bool unlocked_mirror);
+
 	void Zero() {
 		UnLockRegion(0, size);
 		memset(data, 0, size);
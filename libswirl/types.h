@@ -465,12 +465,26 @@ struct settings_t
 		bool isShown;
 	} savepopup;
 
+	struct {
+		bool Enable;
+		u32 Interval;		// frames between two snapshots
+		u32 MaxSnapshots;	// snapshots kept, older ones are dropped
+	} rewind;
+
+	struct {
+		bool Enable;
+		u32 Frames;			// frames emulated ahead of the one shown
+	} runahead;
+
 	struct
 	{
 		bool UseMipmaps;
 		bool WideScreen;
 		bool ShowFPS;
 		bool RenderToTextureBuffer;
+		bool RenderToTextureDeferred;	// Copy to VRAM asynchronously, one frame late
+		bool ShaderCache;			// Save linked shader programs to disk
+		bool ShaderCacheWarmup;		// Link all the cached programs at renderer init
 		int RenderToTextureUpscale;
 		bool TranslucentPolygonDepthMask;
 		bool ModifierVolumes;
@@ -529,10 +543,12 @@ struct settings_t
 		bool OldSyncronousDma;		// 1 -> sync dma (old behavior), 0 -> async dma (fixes some games, partial implementation)
 		bool NoBatch;
 		bool NoSound;
+		bool VectorMixer;	// batch mixer: steps the channels, then mixes the 32 samples in one loop
 	} aica;
 
 	struct{
 		std::string backend;
+		bool RateControl;	// pull backends resample a little faster or slower to keep the buffer at its target
 
 		// slug<<key, value>>
 		std::map<std::string, std::map<std::string, std::string>> options;
@@ -560,10 +576,18 @@ struct settings_t
 	{
 		bool PatchRegion;
 		bool LoadDefaultImage;
+		u32 ChdCacheHunks;		// decompressed hunks kept per chd image
+		bool ChdReadAhead;
+		bool AsyncRead;			// next sectors of a read command on the io thread
 		char DefaultImage[512];
 		char LastImage[512];
 	} imgread;
 
+	struct
+	{
+		bool DecryptCache;		// keep decrypted gd-rom dimm images on disk
+	} naomi;
+
 	struct
 	{
 		u32 ta_skip;
@@ -672,6 +696,7 @@ struct GDRomDisc {
 
 	//IO
 	virtual void ReadSector(u8* buff, u32 StartSector, u32 SectorCount, u32 secsz) = 0;
+	virtual void ReadAhead(u32 StartSector, u32 SectorCount, u32 secsz) { }	// hint, for the sectors of a read command
 	virtual void ReadSubChannel(u8* buff, u32 format, u32 len) = 0;
 	virtual void GetToc(u32* toc, u32 area) = 0;
 	virtual u32 GetDiscType() = 0;
@@ -15,19 +15,11 @@
 // This implements the VLockedMemory interface, as defined in _vmem.h
 // The implementation allows it to be empty (that is, to not lock memory).
 
-void VLockedMemory::LockRegion(unsigned offset, unsigned size) {
-	#ifndef TARGET_NO_EXCEPTIONS
-	//verify(offset + size < this->size && size != 0);
-	DWORD old;
-	VirtualProtect(&data[offset], size, PAGE_READONLY, &old);
-	#endif
-}
-
-void VLockedMemory::UnLockRegion(unsigned offset, unsigned size) {
+void VLockedMemory::SetViewProtection(u8* view, unsigned offset, unsigned size, bool writable) {
 	#ifndef TARGET_NO_EXCEPTIONS
 	//verify(offset + size <= this->size && size != 0);
 	DWORD old;
-	VirtualProtect(&data[offset], size, PAGE_READWRITE, &old);
+	VirtualProtect(&view[offset], size, writable ? PAGE_READWRITE : PAGE_READONLY, &old);
 	#endif
 }
 
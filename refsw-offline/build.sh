@@ -1,6 +1,6 @@
 #!/bin/env bash
 g++ \
-    -I.. -I../libswirl \
+    -I.. -I../libswirl -I../libswirl/deps \
         main.cpp \
         ../libswirl/rend/soft/refrend_base.cpp \
         ../libswirl/rend/soft/refrend_debug.cpp \
@@ -3,13 +3,32 @@
 */
 #include <license/bsd>
 
+/*
+    refsw-offline: renders PVR dumps (as written by refsw_dump) through refsw
+
+    Each folder argument is either a dump (vram0.bin, vram1.bin, pvr_regs) or a corpus folder whose
+    subfolders are dumps. The framebuffer of each dump is written to <output>/<dump name>.png, and can
+    be compared against <dump>/golden.png. <output> is set with --output, and defaults to
+    refsw-offline-output in the system temp folder; only --update-golden writes to the dumps.
+
+    --bench N renders every dump N more times and reports min/median/p99 frame times with a per-stage
+    breakdown. Stage times are those of the worker that spent the most time in the stage, so they
+    compare with the frame time. The exit code is non-zero if any dump fails to load or to match its
+    golden image.
+*/
+
 #include <cstdio>
 #include <stdarg.h>
+#include <cstring>
+#include <cmath>
 
+#include <algorithm>
 #include <filesystem>
 
 #include "libswirl/hw/pvr/Renderer_if.h"
 #include "libswirl/hw/pvr/pvr_mem.h"
+#include "libswirl/rend/soft/refrend_base.h"
+#include "libswirl/deps/libpng/png.h"
 
 using namespace std;
 using namespace std::filesystem;
@@ -18,47 +37,109 @@ settings_t settings;
 
 Renderer* rend_refsw(u8* vram);
 Renderer* rend_refsw_debug(u8* vram);
+extern bool refsw_simd;
+extern bool refsw_fused;
 
 u8 vram[VRAM_SIZE];
 
-int main(int argc, char **argv)
+struct Options
 {
-    if (argc != 2)
-    {
-        printf("expected %s <pvr_dump_folder>\n", argv[0]);
-        return -1;
-    }
+    int bench_frames = 0;
+    bool golden = false;
+    bool update_golden = false;
+    path output = temp_directory_path() / "refsw-offline-output";
+};
 
-    path base_path(argv[1]);
+static bool is_dump(const path& p)
+{
+    return exists(p / "pvr_regs") && exists(p / "vram0.bin") && exists(p / "vram1.bin");
+}
 
-    printf("loading dump from '%s'... likely to not work for 16mb vram ...\n", base_path.c_str());
+static bool load_dump(const path& base_path)
+{
+    FILE* v0 = fopen((base_path / "vram0.bin").c_str(), "rb");
+    FILE* v1 = fopen((base_path / "vram1.bin").c_str(), "rb");
+    FILE* regs = fopen((base_path / "pvr_regs").c_str(), "rb");
+
+    bool rv = v0 && v1 && regs;
+
+    if (rv)
     {
-        FILE* v0 = fopen((base_path / "vram0.bin").c_str(), "rb");
         for (size_t i = 0; i < VRAM_SIZE/2; i+= 4)
         {
             auto v = vrp(vram, i);
-            fread(v, sizeof(*v), 1, v0);
+            rv &= fread(v, sizeof(*v), 1, v0) == 1;
         }
-        fclose(v0);
-    }
 
-    {
-        FILE* v1 = fopen((base_path / "vram1.bin").c_str(), "rb");
         for (size_t i = VRAM_SIZE/2; i < VRAM_SIZE; i+= 4)
         {
             auto v = vrp(vram, i);
-            fread(v, sizeof(*v), 1, v1);
+            rv &= fread(v, sizeof(*v), 1, v1) == 1;
         }
-        fclose(v1);
+
+        rv &= fread(pvr_regs, sizeof(pvr_regs), 1, regs) == 1;
     }
-    
+
+    if (v0) fclose(v0);
+    if (v1) fclose(v1);
+    if (regs) fclose(regs);
+
+    return rv;
+}
+
+static bool read_png(const path& file, png_image* image, vector<u8>* pixels)
+{
+    memset(image, 0, sizeof(*image));
+    image->version = PNG_IMAGE_VERSION;
+
+    if (!png_image_begin_read_from_file(image, file.c_str()))
+        return false;
+
+    image->format = PNG_FORMAT_RGBA;
+    pixels->resize(PNG_IMAGE_SIZE(*image));
+
+    return png_image_finish_read(image, NULL, pixels->data(), 0, NULL) != 0;
+}
+
+// Returns the number of differing pixels, or -1 if the images can't be compared
+static int diff_png(const path& a, const path& b)
+{
+    png_image ia, ib;
+    vector<u8> pa, pb;
+
+    if (!read_png(a, &ia, &pa) || !read_png(b, &ib, &pb))
+        return -1;
+
+    if (ia.width != ib.width || ia.height != ib.height)
+        return -1;
+
+    int rv = 0;
+    for (size_t i = 0; i < pa.size(); i += 4)
     {
-        FILE* regs = fopen((base_path / "pvr_regs").c_str(), "rb");
-        fread(pvr_regs, sizeof(pvr_regs), 1, regs);
-        fclose(regs);
+        if (memcmp(&pa[i], &pb[i], 4) != 0)
+            rv++;
     }
 
-    printf("Rendering ...\n");
+    return rv;
+}
+
+// nearest-rank percentile of a sorted list
+static double percentile(const vector<double>& sorted, double p)
+{
+    size_t idx = (size_t)ceil(p * sorted.size());
+    return sorted[idx ? idx - 1 : 0];
+}
+
+// Render a dump, returns false on load failure or golden mismatch
+static bool run_dump(const path& dump, const Options& opts)
+{
+    auto name = dump.filename().string();
+
+    if (!load_dump(dump))
+    {
+        printf("%s: failed to load dump\n", name.c_str());
+        return false;
+    }
 
     auto rend = rend_refsw(vram);
 
@@ -66,11 +147,142 @@ int main(int argc, char **argv)
 
     rend->RenderPVR();
 
-    printf("Hackpresenting ...\n");
+    auto output = opts.output / (name + ".png");
 
+    refrend_png_path = output.string();
     rend->RenderFramebuffer();
 
-    return 0;
+    printf("%s: %u tiles, %.2f ms (%d threads, %u steals, slowest tile %.2f ms at %u,%u)\n", name.c_str(),
+        refrend_stats.tiles, refrend_stats.frame_ms, refrend_stats.threads, refrend_stats.steals,
+        refrend_stats.slowest_tile_ms, refrend_stats.slowest_tile_x, refrend_stats.slowest_tile_y);
+
+    bool rv = true;
+
+    if (opts.update_golden)
+    {
+        copy_file(output, dump / "golden.png", copy_options::overwrite_existing);
+        printf("%s: golden image updated\n", name.c_str());
+    }
+    else if (opts.golden)
+    {
+        int diff = diff_png(output, dump / "golden.png");
+
+        if (diff == 0)
+            printf("%s: golden OK\n", name.c_str());
+        else if (diff < 0)
+            printf("%s: golden FAILED, golden.png missing or of a different size\n", name.c_str());
+        else
+            printf("%s: golden FAILED, %d pixels differ\n", name.c_str(), diff);
+
+        rv = diff == 0;
+    }
+
+    if (opts.bench_frames > 0)
+    {
+        // the dump is rendered again and again, the framebuffer writeout doesn't touch the inputs
+        vector<double> frame_ms;
+        RefRendFrameStats sum = { };
+
+        for (int i = 0; i < opts.bench_frames; i++)
+        {
+            rend->RenderPVR();
+
+            frame_ms.push_back(refrend_stats.parse_ms + refrend_stats.frame_ms);
+            sum.parse_ms += refrend_stats.parse_ms;
+            sum.isp_max_ms += refrend_stats.isp_max_ms;
+            sum.tsp_max_ms += refrend_stats.tsp_max_ms;
+            sum.writeout_ms += refrend_stats.writeout_ms;
+        }
+
+        sort(frame_ms.begin(), frame_ms.end());
+
+        int n = opts.bench_frames;
+        printf("%s: %d frames, min %.2f ms, median %.2f ms, p99 %.2f ms | parse %.2f ms, isp %.2f ms, tsp %.2f ms (busiest worker), writeout %.2f ms\n",
+            name.c_str(), n, frame_ms[0], percentile(frame_ms, 0.5), percentile(frame_ms, 0.99),
+            sum.parse_ms / n, sum.isp_max_ms / n, sum.tsp_max_ms / n, sum.writeout_ms / n);
+    }
+
+    delete rend;
+
+    return rv;
+}
+
+int main(int argc, char **argv)
+{
+    Options opts;
+    vector<path> dumps;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--scalar") == 0)
+            refsw_simd = false;
+        else if (strcmp(argv[i], "--no-fused") == 0)
+            refsw_fused = false;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            settings.pvr.MaxThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+            opts.bench_frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--golden") == 0)
+            opts.golden = true;
+        else if (strcmp(argv[i], "--update-golden") == 0)
+            opts.update_golden = true;
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            opts.output = argv[++i];
+        else if (argv[i][0] == '-')
+        {
+            printf("unknown option '%s'\n", argv[i]);
+            return -1;
+        }
+        else if (is_dump(argv[i]))
+        {
+            dumps.push_back(argv[i]);
+        }
+        else if (is_directory(argv[i]))
+        {
+            vector<path> corpus;
+            for (auto& entry : directory_iterator(argv[i]))
+            {
+                if (is_dump(entry.path()))
+                    corpus.push_back(entry.path());
+            }
+
+            sort(corpus.begin(), corpus.end());
+            dumps.insert(dumps.end(), corpus.begin(), corpus.end());
+        }
+        else
+        {
+            printf("'%s' is not a dump or corpus folder\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if (dumps.empty())
+    {
+        printf("expected %s [--scalar] [--no-fused] [--threads N] [--bench N] [--golden | --update-golden] [--output folder] <dump or corpus folder>...\n", argv[0]);
+        return -1;
+    }
+
+    error_code ec;
+    create_directories(opts.output, ec);
+
+    if (!is_directory(opts.output))
+    {
+        printf("can't create the output folder '%s'\n", opts.output.c_str());
+        return -1;
+    }
+
+    int failed = 0;
+
+    for (auto& dump : dumps)
+    {
+        if (!run_dump(dump, opts))
+            failed++;
+    }
+
+    if (opts.golden)
+        printf("%d/%d dumps match their golden image\n", (int)dumps.size() - failed, (int)dumps.size());
+
+    return failed == 0 ? 0 : 1;
 }
 
 int msgboxf(const wchar* text, unsigned int type, ...) {
@@ -93,11 +305,10 @@ void os_DebugBreak()
 
 bool RegisterRendererBackend(const rendererbackend_t& backend)
 {
-    printf("Backend: %s (%s) registered\n", backend.slug.c_str(), backend.desc.c_str());
     return true;
 }
 
 
 vram_block* libCore_vramlock_Lock(u32 start_offset64,u32 end_offset64,void* userdata) { return 0; }
 void libCore_vramlock_Unlock_block(vram_block* block) { }
-void libCore_vramlock_Unlock_block_wb(vram_block* block) { }
\ No newline at end of file
+void libCore_vramlock_Unlock_block_wb(vram_block* block) { }
@@ -81,6 +81,13 @@ else()
   set(FEAT_TA ${TA_HLE})
 endif()
 
+# off by default, the broadband adapter on the network:VirtualSwitch segment
+option(ENABLE_BBA "Broadband adapter on the virtual switch" OFF)
+
+if(ENABLE_BBA)
+  add_definitions(-DENABLE_BBA)
+endif()
+
 
 ## These default to host, but are used for cross so make sure not to contaminate
 #
@@ -214,7 +221,7 @@ else()
 endif()
 
 # Sound DSP dynarec
-if((${HOST_CPU} EQUAL ${CPU_X86}) OR (${HOST_CPU} EQUAL ${CPU_A64}))
+if((${HOST_CPU} EQUAL ${CPU_X86}) OR (${HOST_CPU} EQUAL ${CPU_X64}) OR (${HOST_CPU} EQUAL ${CPU_A64}))
   message("DSP Dynarec Features Available")
   set(FEAT_DSPREC  ${DYNAREC_JIT})
 #
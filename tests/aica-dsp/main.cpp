@@ -0,0 +1,202 @@
+/*
+    This is part of libswirl
+*/
+#include <license/bsd>
+
+/*
+    aica-dsp: runs random MPRO programs through the dsp interpreter and the x86-64 recompiler
+
+    Each program gets random COEF, MADRS, ring buffer (RBL, RBP), TEMP and MEMS, the same for
+    both backends, and starts from the aica ram the interpreter left. Every step feeds both the
+    same random MIXS and EXTS, and compares EFREG, TEMP, MEMS and MDEC_CT. The ring buffer in aica ram is compared after the last step.
+
+    aica-dsp [--programs N] [--steps N] [--seed N]. The exit code is non-zero on the first mismatch.
+*/
+
+#include <cstdio>
+#include <stdarg.h>
+#include <cstring>
+#include <random>
+#include <memory>
+#include <algorithm>
+
+#include "libswirl/hw/aica/dsp_backend.h"
+
+using namespace std;
+
+#define ARAM_SIZE (2 * 1024 * 1024)
+
+struct Dsp
+{
+    // the recompiler mprotects DynCode, it has to start a page
+    DECL_ALIGN(4096) dsp_context_t ctx;
+    DSPData_struct data;
+    vector<u8> ram;
+    unique_ptr<DSPBackend> backend;
+};
+
+static Dsp interp, jit;
+
+static s32 sign_extend(u32 value, int bits)
+{
+    return (s32)(value << (32 - bits)) >> (32 - bits);
+}
+
+// A random instruction the hardware would run: IRA below 0x38, and NOFL clear as the
+// backends don't implement it. One in eight is a NOP, that takes the empty instruction path
+static void random_inst(mt19937& rng, u32* IPtr)
+{
+    if (rng() % 8 == 0)
+    {
+        IPtr[0] = IPtr[1] = IPtr[2] = IPtr[3] = 0;
+        return;
+    }
+
+    for (int i = 0; i < 4; i++)
+        IPtr[i] = rng() & 0xFFFF;
+
+    u32 IRA = (IPtr[1] >> 7) & 0x3F;
+    if (IRA >= 0x38)
+        IPtr[1] &= ~(0x20 << 7);
+
+    IPtr[3] &= ~0x8000;
+}
+
+static void load_program(mt19937& rng)
+{
+    auto& ctx = interp.ctx;
+    auto& data = interp.data;
+
+    memset(&ctx, 0, sizeof(ctx));
+    memset(&data, 0, sizeof(data));
+
+    u32 length = 1 + rng() % 128;
+    for (u32 i = 0; i < length; i++)
+        random_inst(rng, &data.MPRO[i * 4]);
+
+    for (auto& coef : data.COEF)
+        coef = rng() & 0xFFF8;
+    for (auto& madrs : data.MADRS)
+        madrs = rng() & 0xFFFF;
+
+    ctx.RBL = (8192 << (rng() % 4)) - 1;
+    ctx.RBP = (rng() % 256) * 2048 * 4 & (ARAM_SIZE - 1);
+    ctx.regs.MDEC_CT = 1 + rng() % (ctx.RBL + 1);
+
+    for (auto& temp : ctx.TEMP)
+        temp = sign_extend(rng(), 24);
+    for (auto& mems : ctx.MEMS)
+        mems = sign_extend(rng(), 24);
+
+    // DynCode isn't copied over, it's compiled on the jit side below
+    memcpy(&jit.ctx.TEMP, &ctx.TEMP, sizeof(ctx) - offsetof(dsp_context_t, TEMP));
+    jit.data = data;
+    // not assigned, the recompiler has the address of the ram baked in
+    copy(interp.ram.begin(), interp.ram.end(), jit.ram.begin());
+
+    interp.backend->Recompile();
+    jit.backend->Recompile();
+}
+
+static bool compare(u32 seed, int program, int step)
+{
+    const char* what = nullptr;
+
+    if (memcmp(interp.data.EFREG, jit.data.EFREG, sizeof(interp.data.EFREG)) != 0)
+        what = "EFREG";
+    else if (memcmp(interp.ctx.TEMP, jit.ctx.TEMP, sizeof(interp.ctx.TEMP)) != 0)
+        what = "TEMP";
+    else if (memcmp(interp.ctx.MEMS, jit.ctx.MEMS, sizeof(interp.ctx.MEMS)) != 0)
+        what = "MEMS";
+    else if (interp.ctx.regs.MDEC_CT != jit.ctx.regs.MDEC_CT)
+        what = "MDEC_CT";
+    else if (step < 0 && interp.ram != jit.ram)
+        what = "aica ram";
+
+    if (what)
+        printf("seed %u, program %d, step %d: %s differs\n", seed, program, step, what);
+
+    return what == nullptr;
+}
+
+int main(int argc, char **argv)
+{
+    int programs = 2000;
+    int steps = 64;
+    u32 seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--programs") == 0 && i + 1 < argc)
+            programs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+            steps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = atoi(argv[++i]);
+        else
+        {
+            printf("expected %s [--programs N] [--steps N] [--seed N]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    mt19937 rng(seed);
+
+    interp.ram.resize(ARAM_SIZE);
+    for (auto& b : interp.ram)
+        b = rng();
+    jit.ram = interp.ram;
+
+    interp.backend.reset(DSPBackend::CreateInterpreter(&interp.data, &interp.ctx, interp.ram.data(), ARAM_SIZE));
+    jit.backend.reset(DSPBackend::CreateJIT(&jit.data, &jit.ctx, jit.ram.data(), ARAM_SIZE));
+
+    u64 stepped = 0, running = 0;
+
+    for (int p = 0; p < programs; p++)
+    {
+        load_program(rng);
+
+        for (int s = 0; s < steps; s++)
+        {
+            for (int i = 0; i < 16; i++)
+                interp.ctx.MIXS[i] = jit.ctx.MIXS[i] = sign_extend(rng(), 20);
+            for (int i = 0; i < 2; i++)
+                interp.data.EXTS[i] = jit.data.EXTS[i] = rng() & 0xFFFF;
+
+            interp.backend->Step();
+            jit.backend->Step();
+
+            if (!compare(seed, p, s))
+                return 1;
+        }
+
+        if (!compare(seed, p, -1))
+            return 1;
+
+        stepped += steps;
+        running += !interp.ctx.Stopped;
+    }
+
+    printf("OK, %d programs (%llu not stopped), %llu steps\n", programs, (unsigned long long)running,
+        (unsigned long long)stepped);
+
+    return 0;
+}
+
+int msgboxf(const wchar* text, unsigned int type, ...) {
+    va_list args;
+
+    wchar temp[2048];
+    va_start(args, type);
+    vsnprintf(temp, sizeof(temp), text, args);
+    va_end(args);
+    printf("%s\n", temp);
+
+    return MBX_OK;
+}
+
+void os_DebugBreak()
+{
+    printf("DEBUGBREAK!\n");
+    exit(-1);
+}
@@ -0,0 +1,246 @@
+/*
+    This is part of libswirl
+*/
+#include <license/bsd>
+
+/*
+    aica-mixer: checks the batched vector mixer (settings.aica.VectorMixer) against StepChannels32
+
+    Two SGC instances get the same aica ram and the same random register trace: pitch, loop, format,
+    envelope, lfo, volume and pan writes, and key ons and offs of random channel sets. One mixes with
+    the per sample path, the other with MixChannels32 and each mix kernel the host supports in turn.
+    The pcm they output has to be the same to the bit.
+
+    aica-mixer [--batches N] [--seed N] [--kernel name]. The exit code is non-zero on the first mismatch.
+*/
+
+#include <cstdio>
+#include <stdarg.h>
+#include <cstring>
+#include <random>
+
+#include "libswirl/hw/aica/sgc_if.h"
+#include "libswirl/hw/aica/dsp_backend.h"
+#include "libswirl/oslib/audiostream.h"
+#include "libswirl/benchmark.h"
+
+using namespace std;
+
+settings_t settings;
+
+#define ARAM_SIZE (8 * 1024 * 1024)
+
+struct CaptureStream : AudioStream
+{
+    vector<s16> pcm;
+
+    void InitAudio() { }
+    void TermAudio() { }
+
+    void WriteSample(s16 right, s16 left)
+    {
+        pcm.push_back(left);
+        pcm.push_back(right);
+    }
+};
+
+struct Aica
+{
+    u8 regs[0x8000];
+    vector<u8> ram;
+    dsp_context_t dsp;
+    CaptureStream stream;
+    SGC* sgc;
+
+    Aica(const vector<u8>& ram_image) : ram(ram_image)
+    {
+        memset(regs, 0, sizeof(regs));
+        memset(&dsp, 0, sizeof(dsp));
+
+        sgc = SGC::Create(&stream, regs, &dsp, ram.data(), ARAM_SIZE);
+
+        auto common = (CommonData_struct*)&regs[0x2800];
+        common->MVOL = 15;
+    }
+
+    ~Aica() { delete sgc; }
+
+    void Write16(u32 chan, u32 reg, u16 value)
+    {
+        *(u16*)&regs[chan * 0x80 + reg] = value;
+
+        sgc->WriteChannelReg8(chan, reg);
+        sgc->WriteChannelReg8(chan, reg + 1);
+    }
+};
+
+// Channel registers that change the sound, KYONEX (bit 15 of reg 0) is written on its own
+static const u32 channel_regs[] = { 0x00, 0x04, 0x08, 0x0C, 0x10, 0x14, 0x18, 0x1C, 0x20, 0x24, 0x28 };
+
+// samples compared, and how many of those weren't silent
+static u64 compared, audible;
+
+// Runs one trace through both paths, returns false on a mismatch
+static bool run_trace(AicaMixKernel kernel, u32 seed, int batches)
+{
+    mt19937 rng(seed);
+
+    // the sample data, ram is read past the 16 bit SA by up to a loop of 64k samples
+    vector<u8> ram_image(ARAM_SIZE + 256 * 1024);
+    for (auto& b : ram_image)
+        b = rng();
+
+    Aica ref(ram_image), vec(ram_image);
+
+    aica_mix_kernel = kernel;
+
+    for (int batch = 0; batch < batches; batch++)
+    {
+        int writes = rng() % 8;
+
+        for (int w = 0; w < writes; w++)
+        {
+            u32 chan = rng() % 64;
+            u32 reg = channel_regs[rng() % ARRAY_SIZE(channel_regs)];
+            u16 value = rng();
+
+            if (reg == 0x00)
+                value &= ~0x8000;	// no KYONEX
+            else if (reg == 0x28)
+                value &= 0x3FFF;	// TL, mostly audible
+
+            ref.Write16(chan, reg, value);
+            vec.Write16(chan, reg, value);
+        }
+
+        // key on or off a random set
+        if (rng() % 16 == 0)
+        {
+            u32 chan = rng() % 64;
+            u16 reg0 = *(u16*)&ref.regs[chan * 0x80];
+
+            ref.Write16(chan, 0, reg0 | 0x8000);
+            vec.Write16(chan, 0, reg0 | 0x8000);
+        }
+
+        settings.aica.VectorMixer = false;
+        ref.sgc->AICA_Sample32();
+
+        settings.aica.VectorMixer = true;
+        vec.sgc->AICA_Sample32();
+
+        if (ref.stream.pcm != vec.stream.pcm)
+        {
+            for (size_t i = 0; i < ref.stream.pcm.size(); i++)
+            {
+                if (ref.stream.pcm[i] != vec.stream.pcm[i])
+                {
+                    printf("%s: seed %u, batch %d, sample %d %s: %d != %d\n", aica_mix_kernel_name(kernel), seed, batch,
+                        (int)i / 2, i & 1 ? "right" : "left", ref.stream.pcm[i], vec.stream.pcm[i]);
+                    break;
+                }
+            }
+
+            return false;
+        }
+
+        for (s16 sample : ref.stream.pcm)
+            audible += sample != 0;
+        compared += ref.stream.pcm.size();
+
+        ref.stream.pcm.clear();
+        vec.stream.pcm.clear();
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int batches = 5000;
+    u32 seed = 1;
+    const char* only = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--batches") == 0 && i + 1 < argc)
+            batches = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc)
+            only = argv[++i];
+        else
+        {
+            printf("expected %s [--batches N] [--seed N] [--kernel scalar|sse4.1|avx2|neon]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    settings.aica.NoBatch = false;
+    settings.aica.CDDAMute = 1;
+
+    int failed = 0;
+
+    for (int k = AMK_Scalar; k < AMK_Count; k++)
+    {
+        auto kernel = (AicaMixKernel)k;
+
+        if (only && strcmp(only, aica_mix_kernel_name(kernel)) != 0)
+            continue;
+
+        if (!aica_mix_kernel_supported(kernel))
+        {
+            printf("%s: not supported on this host, skipped\n", aica_mix_kernel_name(kernel));
+            continue;
+        }
+
+        bool ok = true;
+        compared = audible = 0;
+
+        for (u32 s = seed; s < seed + 4 && ok; s++)
+            ok = run_trace(kernel, s, batches);
+
+        printf("%s: %s, %llu samples, %llu not silent\n", aica_mix_kernel_name(kernel), ok ? "OK" : "FAILED",
+            (unsigned long long)compared, (unsigned long long)audible);
+
+        failed += !ok;
+    }
+
+    return failed == 0 ? 0 : 1;
+}
+
+void libCore_CDDA_Sector(s16* sector)
+{
+    memset(sector, 0, 2352);
+}
+
+// AICA_Sample32 doesn't step the dsp, or time it
+bool bench_active;
+BenchTimes bench_times;
+SuperH4* sh4_cpu;
+
+bool rc_serialize(void* src, unsigned int src_size, void** dest, unsigned int* total_size) { return false; }
+bool rc_unserialize(void* src, unsigned int src_size, void** dest, unsigned int* total_size) { return false; }
+
+int msgboxf(const wchar* text, unsigned int type, ...) {
+    va_list args;
+
+    wchar temp[2048];
+    va_start(args, type);
+    vsnprintf(temp, sizeof(temp), text, args);
+    va_end(args);
+    printf("%s\n", temp);
+
+    return MBX_OK;
+}
+
+void os_DebugBreak()
+{
+    printf("DEBUGBREAK!\n");
+    exit(-1);
+}
+
+double os_GetSeconds()
+{
+    return 0;
+}